@@ -12,6 +12,7 @@
 #include "game_aux.h"
 #include "game_ext.h"
 #include "game_private.h"
+#include "game_rng.h"
 #include "game_struct.h"
 
 /* ************************************************************************** */
@@ -37,6 +38,7 @@ game game_copy(cgame g) {
       // Copy the orientation and shape of piece (i,j) in game g to piece (i,j) in game new_game
       game_set_piece_orientation(game_c, i, j, game_get_piece_orientation(g, i, j));
       game_set_piece_shape(game_c, i, j, game_get_piece_shape(g, i, j));
+      game_set_piece_locked(game_c, i, j, game_is_piece_locked(g, i, j));
     }
   }
   return game_c;
@@ -66,8 +68,15 @@ void game_delete(game g) {
     // If memory is allocated, we free
     if (g->tab_shape != NULL) free(g->tab_shape);
     if (g->tab_direction != NULL) free(g->tab_direction);
+    if (g->tab_locked != NULL) free(g->tab_locked);
     if (g->undo_mooves != NULL) queue_free_full(g->undo_mooves, free);
     if (g->redo_mooves != NULL) queue_free_full(g->redo_mooves, free);
+    if (g->warm != NULL) {
+      free(g->warm->forced[0]);
+      free(g->warm->forced[1]);
+      free(g->warm->solution);
+      free(g->warm);
+    }
 
     free(g);
   }
@@ -112,6 +121,9 @@ void game_play_move(game g, uint i, uint j, int nb_quarter_turns) {
   assert(g);
   assert(i < game_nb_rows(g) && j < game_nb_cols(g));
 
+  // A locked piece cannot be rotated
+  if (game_is_piece_locked(g, i, j)) return;
+
   direction old = game_get_piece_orientation(g, i, j);
   direction new = (old + nb_quarter_turns + NB_DIRS) % NB_DIRS;
   game_set_piece_orientation(g, i, j, new);
@@ -132,10 +144,10 @@ bool game_won(cgame g) {
 void game_reset_orientation(game g) {
   assert(g);
 
-  // Set all piece to NORTH
+  // Set all piece to NORTH (the locked pieces keep their orientation)
   for (uint i = 0; i < game_nb_rows(g); i++) {
     for (uint j = 0; j < game_nb_cols(g); j++) {
-      game_set_piece_orientation(g, i, j, NORTH);
+      if (!game_is_piece_locked(g, i, j)) game_set_piece_orientation(g, i, j, NORTH);
     }
   }
 
@@ -145,18 +157,4 @@ void game_reset_orientation(game g) {
 }
 
 /* ************************ GAME SHUFFLE ORIENTATION ************************ */
-void game_shuffle_orientation(game g) {
-  assert(g);
-
-  // Set all piece to random direction
-  for (uint i = 0; i < game_nb_rows(g); i++) {
-    for (uint j = 0; j < game_nb_cols(g); j++) {
-      direction o = rand() % NB_DIRS;
-      game_set_piece_orientation(g, i, j, o);
-    }
-  }
-
-  // reset history
-  _stack_clear(g->undo_mooves);
-  _stack_clear(g->redo_mooves);
-}
+void game_shuffle_orientation(game g) { game_shuffle_orientation_ext(g, rng_default()); }
@@ -160,7 +160,9 @@ direction game_get_piece_orientation(cgame g, uint i, uint j);
 /**
  * @brief Plays a move in a given square.
  * @details Rotate a piece clockwise by some quarter turns. If
- * @p nb_quarter_turns is negative, the piece is rotated anti-clockwise.
+ * @p nb_quarter_turns is negative, the piece is rotated anti-clockwise. A
+ * locked piece (see @ref game_set_piece_locked) is not rotated and the move is
+ * not saved in the history.
  * @param g the game
  * @param i row index
  * @param j column index
@@ -184,6 +186,7 @@ bool game_won(cgame g);
 
 /**
  * @brief Resets all the piece orientations to the north.
+ * @details The locked pieces keep their orientation.
  * @param g the game
  * @pre @p g must be a valid pointer toward a game structure.
  **/
@@ -191,6 +194,7 @@ void game_reset_orientation(game g);
 
 /**
  * @brief Shuffles all the piece orientations.
+ * @details The locked pieces keep their orientation.
  * @param g the game
  * @pre @p g must be a valid pointer toward a game structure.
  */
@@ -11,6 +11,7 @@
 
 #include "game.h"
 #include "game_private.h"
+#include "game_rng.h"
 #include "game_struct.h"
 #include "queue.h"
 
@@ -57,11 +58,14 @@ game game_new_empty_ext(uint nb_rows, uint nb_cols, bool wrapping) {
   // Shapes and orientations
   g->tab_shape = (shape *)calloc(size, sizeof(shape));
   g->tab_direction = (direction *)calloc(size, sizeof(direction));
+  g->tab_locked = (bool *)calloc(size, sizeof(bool));
   // History
   g->undo_mooves = queue_new();
   g->redo_mooves = queue_new();
+  // Solver state
+  g->warm = (struct warm_s *)calloc(1, sizeof(struct warm_s));
 
-  assert(g->tab_shape && g->tab_direction && g->undo_mooves && g->redo_mooves);
+  assert(g->tab_shape && g->tab_direction && g->tab_locked && g->undo_mooves && g->redo_mooves && g->warm);
 
   return g;
 }
@@ -113,3 +117,41 @@ void game_redo(game g) {
   game_set_piece_orientation(g, m.i, m.j, m.new);
   _stack_push_move(g->undo_mooves, m);
 }
+
+/* ********************** GAME SHUFFLE ORIENTATION EXT ********************** */
+void game_shuffle_orientation_ext(game g, rng* r) {
+  assert(g && r);
+
+  // Set all piece to random direction (the locked pieces keep theirs)
+  uint size = g->HEIGHT * g->WIDTH;
+  for (uint k = 0; k < size; k++) {
+    direction o = rng_bounded(r, NB_DIRS);
+    if (!g->tab_locked[k]) g->tab_direction[k] = o;
+  }
+
+  // reset history
+  _stack_clear(g->undo_mooves);
+  _stack_clear(g->redo_mooves);
+}
+
+/* ************************* GAME SET PIECE LOCKED ************************** */
+void game_set_piece_locked(game g, uint i, uint j, bool locked) {
+  assert(g && g->tab_locked);
+  assert(i < game_nb_rows(g) && j < game_nb_cols(g));
+
+  g->tab_locked[game_nb_cols(g) * i + j] = locked;
+
+  // The history only holds moves of unlocked pieces
+  if (locked) {
+    _stack_remove_piece(g->undo_mooves, i, j);
+    _stack_remove_piece(g->redo_mooves, i, j);
+  }
+}
+
+/* ************************** GAME IS PIECE LOCKED ************************** */
+bool game_is_piece_locked(cgame g, uint i, uint j) {
+  assert(g && g->tab_locked);
+  assert(i < game_nb_rows(g) && j < game_nb_cols(g));
+
+  return g->tab_locked[game_nb_cols(g) * i + j];
+}
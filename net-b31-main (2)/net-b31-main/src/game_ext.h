@@ -11,6 +11,7 @@
 #include <stdbool.h>
 
 #include "game.h"
+#include "game_rng.h"
 
 /**
  * @name Extended Functions
@@ -92,6 +93,47 @@ void game_undo(game g);
  **/
 void game_redo(game g);
 
+/**
+ * @brief Shuffles the orientation of all pieces using a given generator.
+ * @details Same as @ref game_shuffle_orientation, but the random orientations
+ * are drawn from @p r, so the result only depends on the state of @p r.
+ * @param g the game
+ * @param r the random generator
+ * @pre @p g is a valid pointer toward a game structure
+ * @pre @p r is a valid pointer toward a seeded rng structure
+ **/
+void game_shuffle_orientation_ext(game g, rng* r);
+
+/**
+ * @brief Locks or unlocks a piece.
+ * @details A locked piece keeps its orientation: @ref game_play_move, @ref
+ * game_undo, @ref game_redo and the shuffle and reset functions leave it as
+ * it is, and the solvers only look for solutions where it has its current
+ * orientation. @ref game_set_piece_orientation still changes it. Locking a
+ * piece removes its moves from the history, the other moves can still be
+ * undone and redone. All pieces of a new game are unlocked.
+ * @param g the game
+ * @param i row index
+ * @param j column index
+ * @param locked true to lock the piece, false to unlock it
+ * @pre @p g is a valid pointer toward a game structure
+ * @pre @p i < game height
+ * @pre @p j < game width
+ **/
+void game_set_piece_locked(game g, uint i, uint j, bool locked);
+
+/**
+ * @brief Checks if a piece is locked.
+ * @param g the game
+ * @param i row index
+ * @param j column index
+ * @return true if the piece (i,j) is locked
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @pre @p i < game height
+ * @pre @p j < game width
+ **/
+bool game_is_piece_locked(cgame g, uint i, uint j);
+
 /**
  * @}
  */
@@ -51,6 +51,20 @@ void _stack_clear(queue* q) {
   assert(queue_is_empty(q));
 }
 
+/* ************************** STACK REMOVE PIECE **************************** */
+void _stack_remove_piece(queue* q, uint i, uint j) {
+  assert(q);
+  // Move each move, oldest first, from the bottom to the top of the stack
+  int len = queue_length(q);
+  for (int k = 0; k < len; k++) {
+    move* pm = queue_pop_tail(q);
+    if (pm->i == i && pm->j == j)
+      free(pm);
+    else
+      queue_push_head(q, pm);
+  }
+}
+
 /* ************************************************************************** */
 /*                                  MISC                                      */
 /* ************************************************************************** */
@@ -71,6 +85,11 @@ char* _square2str(shape s, direction d) {
   return square2str[s][d];
 }
 
+uint _shape_period(shape s) {
+  assert(s < NB_SHAPES);
+  return (s == EMPTY || s == CROSS) ? 1 : s == SEGMENT ? 2 : NB_DIRS;
+}
+
 /* ************************************************************************** */
 /*                                 ADD_EDGE                                   */
 /* ************************************************************************** */
@@ -150,4 +169,43 @@ bool _add_edge(game g, uint i, uint j, direction d) {
   _add_half_edge(g, nexti, nextj, OPPOSITE_DIR(d));
 
   return true;
-}
\ No newline at end of file
+}
+/* **************************** REMOVE HALF EDGE **************************** */
+void _remove_half_edge(game g, uint i, uint j, direction d) {
+  assert(g);
+  assert(i < game_nb_rows(g));
+  assert(j < game_nb_cols(g));
+  assert(d < NB_DIRS);
+
+  shape s = game_get_piece_shape(g, i, j);
+  direction o = game_get_piece_orientation(g, i, j);
+  uint code = _encode_shape(s, o);
+  uint mask = 0b1000 >> d;     // mask with half-edge in the direction d
+  assert((code & mask) != 0);  // check there is an half-edge in the direction d
+  uint newcode = code & ~mask;  // remove the half-edge in the direction d
+  shape news = EMPTY;
+  direction newo = NORTH;
+  if (!_decode_shape(newcode, &news, &newo)) {
+    assert(false);
+  }
+  game_set_piece_shape(g, i, j, news);
+  game_set_piece_orientation(g, i, j, newo);
+}
+
+/* ****************************** REMOVE EDGE ******************************* */
+bool _remove_edge(game g, uint i, uint j, direction d) {
+  assert(g);
+  assert(i < game_nb_rows(g));
+  assert(j < game_nb_cols(g));
+  assert(d < NB_DIRS);
+
+  uint nexti, nextj;
+  bool next = game_get_ajacent_square(g, i, j, d, &nexti, &nextj);
+  if (!next) return false;
+  if (game_check_edge(g, i, j, d) != MATCH) return false;
+
+  _remove_half_edge(g, i, j, d);
+  _remove_half_edge(g, nexti, nextj, OPPOSITE_DIR(d));
+
+  return true;
+}
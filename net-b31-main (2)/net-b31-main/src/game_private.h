@@ -52,6 +52,9 @@ bool _stack_is_empty(queue* q);
 /** clear all the stack */
 void _stack_clear(queue* q);
 
+/** remove the moves of the piece (i,j) from the stack, the others keep their order */
+void _stack_remove_piece(queue* q, uint i, uint j);
+
 /* ************************************************************************** */
 /*                                MISC                                        */
 /* ************************************************************************** */
@@ -61,6 +64,10 @@ void _stack_clear(queue* q);
  */
 char* _square2str(shape s, direction d);
 
+/** number of quarter turns after which a shape looks the same: 1 for an empty
+ * square or a cross, 2 for a segment, 4 for the others */
+uint _shape_period(shape s);
+
 #endif  // __GAME_PRIVATE_H__
 
 /* ************************************************************************** */
@@ -91,3 +98,21 @@ void _add_half_edge(game g, uint i, uint j, direction d);
  * @return true if an edge can be added, false otherwise
  */
 bool _add_edge(game g, uint i, uint j, direction d);
+
+/** remove an half-edge in the direction d */
+void _remove_half_edge(game g, uint i, uint j, direction d);
+
+/**
+ * @brief Remove the edge between two adjacent squares.
+ * @details This is the reverse of @ref _add_edge: the half-edges of both
+ * squares are removed, which changes their shapes.
+ * @param g the game
+ * @param i row index
+ * @param j column index
+ * @param d the direction of the adjacent square
+ * @pre @p g must be a valid pointer toward a game structure.
+ * @pre @p i < game height
+ * @pre @p j < game width
+ * @return true if the edge was removed, false if there was no such edge
+ */
+bool _remove_edge(game g, uint i, uint j, direction d);
@@ -4,12 +4,17 @@
  * @details This program generates a random game based on few arguments.
  * @copyright University of Bordeaux. All rights reserved, 2024.
  **/
+#include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "game_aux.h"
+#include "game_rng.h"
+#include "game_solver.h"
 #include "game_tools.h"
 
 /* ************************************************************************** */
@@ -17,37 +22,92 @@
 /* ************************************************************************** */
 
 void usage(const char* prog_name) {
-  fprintf(stderr, "Usage: %s <nb_rows> <nb_cols> <wrapping> <nb_empty> <nb_extra> <shuffle> [<filename>]\n", prog_name);
-  fprintf(stderr, "Example: %s 4 4 0 0 0 0 random.sol\n", prog_name);
+  fprintf(stderr, "Usage: %s <nb_rows> <nb_cols> <wrapping> <nb_empty> <nb_extra> <shuffle> [<filename>] [<options>]\n",
+          prog_name);
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  --seed <n>    seed of the random generator (default: current time)\n");
+  fprintf(stderr, "  --stream <k>  use the k-th independent stream of the seed (for parallel runs, k <= 1000000)\n");
+  fprintf(stderr, "  --unique      generate a game with exactly one solution\n");
+  fprintf(stderr, "Example: %s 4 4 0 0 0 0 random.sol --seed 42\n", prog_name);
   exit(EXIT_FAILURE);
 }
 
+/* largest stream index: each one costs a jump of the generator */
+#define MAX_STREAM 1000000
+
+/* parse the index of a stream, a decimal number up to MAX_STREAM (usage otherwise) */
+uint parse_stream(const char* arg, const char* prog_name) {
+  char* end;
+  errno = 0;
+  unsigned long stream = strtoul(arg, &end, 10);
+  if (arg[0] < '0' || arg[0] > '9' || *end != '\0' || errno == ERANGE || stream > MAX_STREAM) usage(prog_name);
+  return (uint)stream;
+}
+
 /* ************************************************************************** */
 /*                             MAIN FUNCTION                                  */
 /* ************************************************************************** */
 
 int main(int argc, char* argv[]) {
+  // Split positional arguments and options
+  char* args[7] = {NULL};
+  uint nb_args = 0;
+  uint64_t seed = (uint64_t)time(NULL);
+  uint stream = 0;
+  bool unique = false;
+  for (int k = 1; k < argc; k++) {
+    if (strcmp(argv[k], "--seed") == 0 && k + 1 < argc)
+      seed = strtoull(argv[++k], NULL, 10);
+    else if (strcmp(argv[k], "--stream") == 0 && k + 1 < argc)
+      stream = parse_stream(argv[++k], argv[0]);
+    else if (strcmp(argv[k], "--unique") == 0)
+      unique = true;
+    else if (argv[k][0] == '-' && argv[k][1] == '-')
+      usage(argv[0]);
+    else if (nb_args < 7)
+      args[nb_args++] = argv[k];
+    else
+      usage(argv[0]);
+  }
+
   // Ensure at least 6 arguments are provided (7th is facultative)
-  if (argc < 7) usage(argv[0]);
+  if (nb_args < 6) usage(argv[0]);
 
-  srand(time(NULL));
+  rng r;
+  rng_seed(&r, seed);
+  for (uint k = 0; k < stream; k++) rng_jump(&r);
 
-  uint nb_rows = atoi(argv[1]);
-  uint nb_cols = atoi(argv[2]);
-  uint wrapping = atoi(argv[3]);
-  uint nb_empty = atoi(argv[4]);
-  uint nb_extra = atoi(argv[5]);
-  uint shuffle = atoi(argv[6]);
+  uint nb_rows = atoi(args[0]);
+  uint nb_cols = atoi(args[1]);
+  uint wrapping = atoi(args[2]);
+  uint nb_empty = atoi(args[3]);
+  uint nb_extra = atoi(args[4]);
+  uint shuffle = atoi(args[5]);
 
-  game g = game_random(nb_rows, nb_cols, wrapping, nb_empty, nb_extra);
-  if (shuffle) game_shuffle_orientation(g);
+  game g = unique ? game_random_unique(nb_rows, nb_cols, wrapping, nb_empty, nb_extra, &r)
+                  : game_random_ext(nb_rows, nb_cols, wrapping, nb_empty, nb_extra, &r);
+  if (!g) {
+    fprintf(stderr, "Error: no game with a single solution was found with these parameters\n");
+    return EXIT_FAILURE;
+  }
+  if (shuffle) game_shuffle_orientation_ext(g, &r);
 
   printf("> nb_rows = %u nb_cols = %u wrapping = %u\n", nb_rows, nb_cols, wrapping);
   printf("> nb_empty = %u nb_extra = %u shuffle = %u\n", nb_empty, nb_extra, shuffle);
+  printf("> seed = %llu stream = %u\n", (unsigned long long)seed, stream);
+
+  // Rating of the game by the rules needed to solve it
+  static const char* grades[NB_GRADES] = {"easy", "medium", "hard"};
+  solver_rating rating;
+  if (solver_rate(g, &rating) == SOLVER_SOLVED)
+    printf("> difficulty = %.2f (%s): %u by edges, %u by closed components, %u by lookahead, %u to guess\n",
+           rating.difficulty, grades[rating.grade], rating.histogram[SOLVER_LEVEL_EDGES],
+           rating.histogram[SOLVER_LEVEL_CLOSED], rating.histogram[SOLVER_LEVEL_LOOKAHEAD], rating.nb_guesses);
   game_print(g);
 
   // Save the game if filename is given
-  if (argc > 7) game_save(g, argv[7]);
+  if (args[6]) game_save(g, args[6]);
 
+  game_delete(g);
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,107 @@
+/**
+ * @file game_rng.c
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+#include "game_rng.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/* ************************************************************************** */
+/*                                  HELPERS                                   */
+/* ************************************************************************** */
+
+static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+/* splitmix64, used to expand a single seed into a full state */
+static uint64_t splitmix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* ************************************************************************** */
+/*                               RNG FUNCTIONS                                */
+/* ************************************************************************** */
+
+/* ********************************* SEED *********************************** */
+void rng_seed(rng* r, uint64_t seed) {
+  assert(r);
+  for (int k = 0; k < 4; k++) r->s[k] = splitmix64(&seed);
+}
+
+/* ********************************* NEXT *********************************** */
+uint64_t rng_next(rng* r) {
+  uint64_t* s = r->s;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return result;
+}
+
+/* ******************************** BOUNDED ********************************* */
+uint rng_bounded(rng* r, uint n) {
+  assert(r && n > 0);
+
+  // Lemire's method: the high 32 bits of a 32x32 product are uniform in [0, n)
+  // once the few low values that would over-represent some results are rejected
+  uint64_t m = (rng_next(r) >> 32) * n;
+  uint32_t low = (uint32_t)m;
+  if (low < n) {
+    uint32_t threshold = (uint32_t)(-n) % n;
+    while (low < threshold) {
+      m = (rng_next(r) >> 32) * n;
+      low = (uint32_t)m;
+    }
+  }
+  return m >> 32;
+}
+
+/* ******************************** DOUBLE ********************************** */
+double rng_double(rng* r) { return (rng_next(r) >> 11) * 0x1.0p-53; }
+
+/* ********************************* JUMP *********************************** */
+void rng_jump(rng* r) {
+  static const uint64_t JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL,
+                                  0x39abdc4529b1661cULL};
+  uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+  for (int i = 0; i < 4; i++) {
+    for (int b = 0; b < 64; b++) {
+      if (JUMP[i] & (UINT64_C(1) << b)) {
+        s0 ^= r->s[0];
+        s1 ^= r->s[1];
+        s2 ^= r->s[2];
+        s3 ^= r->s[3];
+      }
+      rng_next(r);
+    }
+  }
+
+  r->s[0] = s0;
+  r->s[1] = s1;
+  r->s[2] = s2;
+  r->s[3] = s3;
+}
+
+/* ******************************** DEFAULT ********************************* */
+rng* rng_default(void) {
+  static rng default_rng;
+  static bool seeded = false;
+
+  if (!seeded) {
+    rng_seed(&default_rng, (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32));
+    seeded = true;
+  }
+  return &default_rng;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file game_rng.h
+ * @brief Pseudo-Random Number Generator.
+ * @details A small xoshiro256** generator with explicit state, used by the
+ * random game generator and the shuffle functions. Each @ref rng is an
+ * independent stream: two generators seeded with the same value produce the
+ * same sequence, and @ref rng_jump can be used to derive non-overlapping
+ * streams for parallel generation.
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+
+#ifndef __GAME_RNG_H__
+#define __GAME_RNG_H__
+
+#include <stdint.h>
+
+#include "game.h"
+
+/**
+ * @brief The generator state.
+ * @details The state must be initialized with @ref rng_seed before use.
+ **/
+typedef struct rng_s {
+  uint64_t s[4]; /**< xoshiro256** internal state */
+} rng;
+
+/**
+ * @name Generator Functions
+ * @{
+ */
+
+/**
+ * @brief Initializes a generator from a 64-bit seed.
+ * @details The seed is expanded with splitmix64, so any value (including 0)
+ * gives a valid state.
+ * @param r the generator
+ * @param seed the seed
+ * @pre @p r is a valid pointer toward a rng structure
+ **/
+void rng_seed(rng* r, uint64_t seed);
+
+/**
+ * @brief Returns the next 64 random bits.
+ * @param r the generator
+ * @pre @p r is a valid pointer toward a seeded rng structure
+ * @return a uniformly distributed 64-bit value
+ **/
+uint64_t rng_next(rng* r);
+
+/**
+ * @brief Returns a uniformly distributed integer in [0, n).
+ * @details Uses Lemire's multiply-and-reject method, so the result is not
+ * biased towards small values whatever the value of @p n.
+ * @param r the generator
+ * @param n the upper bound (exclusive)
+ * @pre @p n > 0
+ * @return a random integer in [0, n)
+ **/
+uint rng_bounded(rng* r, uint n);
+
+/**
+ * @brief Returns a uniformly distributed double in [0, 1).
+ * @param r the generator
+ * @return a random double in [0, 1)
+ **/
+double rng_double(rng* r);
+
+/**
+ * @brief Advances the generator by 2^128 steps.
+ * @details This is equivalent to 2^128 calls to @ref rng_next. Calling it k
+ * times on a copy of a seeded generator gives the k-th independent stream,
+ * which is the way to feed several threads from a single seed.
+ * @param r the generator
+ **/
+void rng_jump(rng* r);
+
+/**
+ * @brief Returns the process-wide generator.
+ * @details It is used by the functions that do not take an explicit
+ * generator (e.g. @ref game_shuffle_orientation). It is seeded from the
+ * current time on first use, unless @ref rng_seed has been called on it.
+ * @return a pointer to the default generator
+ **/
+rng* rng_default(void);
+
+/**
+ * @}
+ */
+
+#endif  // __GAME_RNG_H__
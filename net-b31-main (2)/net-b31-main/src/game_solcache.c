@@ -0,0 +1,418 @@
+/**
+ * @file game_solcache.c
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include "game_solcache.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "game_ext.h"
+#include "game_solver.h"
+
+#define SOLCACHE_MAGIC 0x4b54454eu
+#define SOLCACHE_VERSION 1
+
+/* what a record knows of its game */
+#define KNOWN_COUNT 1
+#define KNOWN_SOLUTION 2
+#define KNOWN_UNSOLVABLE 4
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t nb_slots;           // power of 2
+  _Atomic uint64_t nb_games;   // number of used slots
+  _Atomic uint64_t end;        // end of the records
+  uint8_t reserved[32];
+} cache_header;
+
+typedef struct {
+  _Atomic uint64_t hash;
+  _Atomic uint64_t offset;  // 0 for an empty slot, published last
+} cache_slot;
+
+typedef struct {
+  uint64_t hash;
+  uint64_t nb_sols;
+  uint32_t nb_rows, nb_cols;
+  uint8_t wrapping;
+  uint8_t flags;
+  uint8_t reserved[6];
+} cache_record;  // followed by the shapes and the packed solution
+
+struct solcache_s {
+  char *filename;
+  int fd;
+  bool read_only;
+  dev_t dev;              // identity of the opened file, to notice its replacement
+  ino_t ino;
+  uint8_t *map;           // the file mapped in memory
+  size_t size;            // number of bytes mapped
+  pthread_rwlock_t lock;  // readers share the mapping, writers and remappings are alone
+};
+
+/* result of a search in the index */
+typedef enum { FOUND, MISSING, STALE } find_result;
+
+/* ************************************************************************** */
+/*                                  HELPERS                                   */
+/* ************************************************************************** */
+
+static inline cache_header *header(solcache *c) { return (cache_header *)c->map; }
+
+static inline cache_slot *slots(uint8_t *map) { return (cache_slot *)(map + SOLCACHE_HEADER_SIZE); }
+
+static inline size_t index_end(uint64_t nb_slots) { return SOLCACHE_HEADER_SIZE + nb_slots * sizeof(cache_slot); }
+
+static inline size_t record_size(uint size) { return (sizeof(cache_record) + size + (size + 3) / 4 + 7) & ~(size_t)7; }
+
+/* ********************************** MAP *********************************** */
+/* map the whole file, return true if the mapping changed */
+static bool map(solcache *c) {
+  struct stat st;
+  if (fstat(c->fd, &st) != 0 || (size_t)st.st_size == c->size) return false;
+  if (c->map) munmap(c->map, c->size);
+  c->map = NULL;
+  c->size = 0;
+  int prot = c->read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+  void *p = st.st_size > 0 ? mmap(NULL, st.st_size, prot, MAP_SHARED, c->fd, 0) : MAP_FAILED;
+  if (p != MAP_FAILED) {
+    c->map = (uint8_t *)p;
+    c->size = st.st_size;
+  }
+  return true;
+}
+
+/* ********************************* STALE ********************************** */
+/* has the file been replaced by a larger one since it was opened? */
+static bool stale(solcache *c) {
+  struct stat st;
+  return stat(c->filename, &st) == 0 && (st.st_dev != c->dev || st.st_ino != c->ino);
+}
+
+/* ********************************* VALID ********************************** */
+static bool valid(solcache *c) {
+  if (!c->map || c->size < SOLCACHE_HEADER_SIZE) return false;
+  cache_header *h = header(c);
+  uint64_t n = h->nb_slots;
+  return h->magic == SOLCACHE_MAGIC && h->version == SOLCACHE_VERSION && n > 0 && (n & (n - 1)) == 0 &&
+         c->size >= index_end(n);
+}
+
+/* ********************************* ATTACH ********************************* */
+/* open the file, create it if it is empty, and map it */
+static bool attach(solcache *c) {
+  c->read_only = false;
+  c->fd = open(c->filename, O_RDWR | O_CREAT, 0666);
+  if (c->fd < 0) {
+    c->read_only = true;
+    c->fd = open(c->filename, O_RDONLY);
+  }
+  if (c->fd < 0) return false;
+
+  flock(c->fd, c->read_only ? LOCK_SH : LOCK_EX);
+  struct stat st;
+  bool ok = fstat(c->fd, &st) == 0;
+  if (ok && st.st_size == 0 && !c->read_only) {
+    cache_header h = {.magic = SOLCACHE_MAGIC, .version = SOLCACHE_VERSION, .nb_slots = SOLCACHE_INITIAL_SLOTS};
+    atomic_init(&h.nb_games, 0);
+    atomic_init(&h.end, index_end(SOLCACHE_INITIAL_SLOTS));
+    ok = ftruncate(c->fd, index_end(SOLCACHE_INITIAL_SLOTS)) == 0 && pwrite(c->fd, &h, sizeof(h), 0) == sizeof(h);
+  }
+  c->dev = st.st_dev;
+  c->ino = st.st_ino;
+  c->map = NULL;
+  c->size = 0;
+  ok = ok && (map(c), valid(c));
+  flock(c->fd, LOCK_UN);
+  return ok;
+}
+
+/* ********************************* DETACH ********************************* */
+static void detach(solcache *c) {
+  if (c->map) munmap(c->map, c->size);
+  c->map = NULL;
+  c->size = 0;
+  close(c->fd);
+  c->fd = -1;
+}
+
+/* ******************************** REFRESH ********************************* */
+/* catch up with the file, which may have grown or been rewritten (write lock held) */
+static bool refresh(solcache *c) {
+  if (!stale(c)) return map(c) && valid(c);
+  detach(c);
+  return attach(c);
+}
+
+/* ********************************** FIND ********************************** */
+/* search the record of a game, from its slot */
+static find_result find(solcache *c, cgame g, uint64_t hash, uint64_t *slot, cache_record **record) {
+  uint nb_rows = game_nb_rows(g), nb_cols = game_nb_cols(g), size = nb_rows * nb_cols;
+  uint64_t mask = header(c)->nb_slots - 1;
+  cache_slot *index = slots(c->map);
+  for (uint64_t k = hash & mask;; k = (k + 1) & mask) {
+    *slot = k;
+    uint64_t offset = atomic_load_explicit(&index[k].offset, memory_order_acquire);
+    if (offset == 0) return MISSING;
+    if (atomic_load_explicit(&index[k].hash, memory_order_relaxed) != hash) continue;
+    if (offset + sizeof(cache_record) > c->size) return STALE;
+    cache_record *r = (cache_record *)(c->map + offset);
+    if (r->nb_rows != nb_rows || r->nb_cols != nb_cols || r->wrapping != game_is_wrapping(g)) continue;
+    if (offset + record_size(size) > c->size) return STALE;
+    const uint8_t *shapes = (const uint8_t *)(r + 1);
+    bool same = true;
+    for (uint pos = 0; pos < size && same; pos++)
+      same = shapes[pos] == solver_square_key(g, pos / nb_cols, pos % nb_cols);
+    if (same) {
+      *record = r;
+      return FOUND;
+    }
+  }
+}
+
+/* ********************************* LOOKUP ********************************* */
+/* copy the record of a game and its solution, if the cache has one */
+static bool lookup(solcache *c, cgame g, cache_record *out, uint8_t *packed) {
+  uint64_t hash = solver_game_hash(g);
+  uint size = game_nb_rows(g) * game_nb_cols(g);
+  for (uint attempt = 0; attempt < 2; attempt++) {
+    pthread_rwlock_rdlock(&c->lock);
+    uint64_t slot;
+    cache_record *r = NULL;
+    find_result res = c->map ? find(c, g, hash, &slot, &r) : STALE;
+    if (res == FOUND) {
+      *out = *r;
+      if (packed) memcpy(packed, (uint8_t *)(r + 1) + size, (size + 3) / 4);
+    }
+    pthread_rwlock_unlock(&c->lock);
+    if (res == FOUND) return true;
+
+    // On a miss, another process may have grown or rewritten the file
+    pthread_rwlock_wrlock(&c->lock);
+    bool changed = refresh(c);
+    pthread_rwlock_unlock(&c->lock);
+    if (!changed) return false;
+  }
+  return false;
+}
+
+/* ******************************** REBUILD ********************************* */
+/* rewrite the cache with twice as many slots, and lock the new file (both locks held) */
+static bool rebuild(solcache *c) {
+  uint64_t nb_slots = header(c)->nb_slots * 2;
+  uint64_t end = index_end(nb_slots);
+  cache_slot *old = slots(c->map);
+  for (uint64_t k = 0; k < header(c)->nb_slots; k++)
+    if (old[k].offset) {
+      cache_record *r = (cache_record *)(c->map + old[k].offset);
+      end += record_size(r->nb_rows * r->nb_cols);
+    }
+
+  uint8_t *buffer = (uint8_t *)calloc(end, 1);
+  assert(buffer);
+  cache_header *h = (cache_header *)buffer;
+  h->magic = SOLCACHE_MAGIC;
+  h->version = SOLCACHE_VERSION;
+  h->nb_slots = nb_slots;
+  h->nb_games = header(c)->nb_games;
+  h->end = end;
+  uint64_t offset = index_end(nb_slots);
+  for (uint64_t k = 0; k < header(c)->nb_slots; k++)
+    if (old[k].offset) {
+      cache_record *r = (cache_record *)(c->map + old[k].offset);
+      size_t len = record_size(r->nb_rows * r->nb_cols);
+      memcpy(buffer + offset, r, len);
+      uint64_t s = r->hash & (nb_slots - 1);
+      while (slots(buffer)[s].offset) s = (s + 1) & (nb_slots - 1);
+      slots(buffer)[s].hash = r->hash;
+      slots(buffer)[s].offset = offset;
+      offset += len;
+    }
+  assert(offset == end);
+
+  // The new file is locked before it replaces the old one, so that no other writer slips in
+  char *tmp = (char *)malloc(strlen(c->filename) + 5);
+  assert(tmp);
+  sprintf(tmp, "%s.tmp", c->filename);
+  int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  bool ok = fd >= 0 && flock(fd, LOCK_EX) == 0;
+  ok = ok && write(fd, buffer, end) == (ssize_t)end && fsync(fd) == 0 && rename(tmp, c->filename) == 0;
+  struct stat st;
+  ok = ok && fstat(fd, &st) == 0;
+  if (!ok) {
+    if (fd >= 0) close(fd);
+    remove(tmp);
+  }
+  free(tmp);
+  free(buffer);
+  if (!ok) return false;
+
+  detach(c);
+  c->fd = fd;
+  c->dev = st.st_dev;
+  c->ino = st.st_ino;
+  return map(c) && valid(c);
+}
+
+/* ********************************* STORE ********************************** */
+/* append a record with what is known of a game, merged with its previous record */
+static bool store(solcache *c, cgame g, uint8_t flags, uint64_t nb_sols) {
+  if (c->read_only) return false;
+  uint nb_rows = game_nb_rows(g), nb_cols = game_nb_cols(g), size = nb_rows * nb_cols;
+  uint64_t hash = solver_game_hash(g);
+  pthread_rwlock_wrlock(&c->lock);
+
+  // Lock the current file: it may have been replaced while waiting for the lock
+  bool ok = c->fd >= 0;
+  while (ok) {
+    flock(c->fd, LOCK_EX);
+    if (!stale(c)) break;
+    flock(c->fd, LOCK_UN);
+    detach(c);
+    ok = attach(c);
+  }
+  ok = ok && (map(c), valid(c));
+
+  uint64_t slot = 0;
+  cache_record *old = NULL;
+  find_result res = ok ? find(c, g, hash, &slot, &old) : STALE;
+  if (res == MISSING && 2 * (header(c)->nb_games + 1) > header(c)->nb_slots) {
+    ok = rebuild(c);
+    res = ok ? find(c, g, hash, &slot, &old) : STALE;
+  }
+  ok = ok && res != STALE;
+
+  // Keep what the previous record knew and this one does not
+  cache_record r = {.hash = hash, .nb_sols = nb_sols, .nb_rows = nb_rows, .nb_cols = nb_cols};
+  r.wrapping = game_is_wrapping(g);
+  r.flags = flags;
+  if (ok && res == FOUND) {
+    if (!(flags & KNOWN_COUNT) && (old->flags & KNOWN_COUNT)) r.nb_sols = old->nb_sols;
+    r.flags |= old->flags;
+  }
+  if (r.flags & KNOWN_UNSOLVABLE) {
+    r.flags |= KNOWN_COUNT;
+    r.nb_sols = 0;
+  }
+
+  // Append the record, growing the file by doubling
+  size_t len = record_size(size);
+  uint64_t end = ok ? header(c)->end : 0;
+  if (ok && end + len > c->size) {
+    size_t grown = 2 * c->size > end + len ? 2 * c->size : end + len;
+    uint64_t old_offset = res == FOUND ? (uint8_t *)old - c->map : 0;
+    ok = ftruncate(c->fd, grown) == 0 && map(c) && valid(c);
+    if (ok && res == FOUND) old = (cache_record *)(c->map + old_offset);
+  }
+  if (ok) {
+    uint8_t *p = c->map + end;
+    memcpy(p, &r, sizeof(r));
+    uint8_t *shapes = p + sizeof(r);
+    uint8_t *packed = shapes + size;
+    memset(packed, 0, len - sizeof(r) - size);
+    for (uint pos = 0; pos < size; pos++) shapes[pos] = solver_square_key(g, pos / nb_cols, pos % nb_cols);
+    if (flags & KNOWN_SOLUTION)
+      for (uint pos = 0; pos < size; pos++)
+        packed[pos / 4] |= game_get_piece_orientation(g, pos / nb_cols, pos % nb_cols) << (2 * (pos % 4));
+    else if (res == FOUND && (old->flags & KNOWN_SOLUTION))
+      memcpy(packed, (uint8_t *)(old + 1) + size, (size + 3) / 4);
+    atomic_store(&header(c)->end, end + len);
+
+    // Publish the record: the offset is written last
+    cache_slot *s = &slots(c->map)[slot];
+    if (res == MISSING) {
+      atomic_store_explicit(&s->hash, hash, memory_order_relaxed);
+      atomic_fetch_add(&header(c)->nb_games, 1);
+    }
+    atomic_store_explicit(&s->offset, end, memory_order_release);
+  }
+
+  if (c->fd >= 0) flock(c->fd, LOCK_UN);
+  pthread_rwlock_unlock(&c->lock);
+  return ok;
+}
+
+/* ************************************************************************** */
+/*                          SOLUTION CACHE FUNCTIONS                          */
+/* ************************************************************************** */
+
+/* ***************************** SOLCACHE OPEN ****************************** */
+solcache *solcache_open(const char *filename) {
+  assert(filename);
+  solcache *c = (solcache *)malloc(sizeof(solcache));
+  assert(c);
+  c->filename = strdup(filename);
+  assert(c->filename);
+  if (!attach(c)) {
+    if (c->fd >= 0) detach(c);
+    free(c->filename);
+    free(c);
+    return NULL;
+  }
+  pthread_rwlock_init(&c->lock, NULL);
+  return c;
+}
+
+/* ***************************** SOLCACHE COUNT ***************************** */
+bool solcache_count(solcache *c, cgame g, uint64_t *nb_sols) {
+  assert(c && g && nb_sols);
+  cache_record r;
+  if (!lookup(c, g, &r, NULL) || !(r.flags & KNOWN_COUNT)) return false;
+  *nb_sols = r.nb_sols;
+  return true;
+}
+
+/* *************************** SOLCACHE SOLUTION **************************** */
+bool solcache_solution(solcache *c, game g, bool *solvable) {
+  assert(c && g && solvable);
+  uint nb_cols = game_nb_cols(g), size = game_nb_rows(g) * nb_cols;
+  uint8_t *packed = (uint8_t *)malloc((size + 3) / 4 + 1);
+  assert(packed);
+  cache_record r;
+  bool known = lookup(c, g, &r, packed) && (r.flags & (KNOWN_SOLUTION | KNOWN_UNSOLVABLE));
+  if (known) {
+    *solvable = r.flags & KNOWN_SOLUTION;
+    if (*solvable)
+      for (uint pos = 0; pos < size; pos++)
+        game_set_piece_orientation(g, pos / nb_cols, pos % nb_cols, (packed[pos / 4] >> (2 * (pos % 4))) & 3);
+  }
+  free(packed);
+  return known;
+}
+
+/* *************************** SOLCACHE PUT COUNT *************************** */
+bool solcache_put_count(solcache *c, cgame g, uint64_t nb_sols) {
+  assert(c && g);
+  return store(c, g, nb_sols == 0 ? KNOWN_COUNT | KNOWN_UNSOLVABLE : KNOWN_COUNT, nb_sols);
+}
+
+/* ************************* SOLCACHE PUT SOLUTION ************************** */
+bool solcache_put_solution(solcache *c, cgame g, bool solvable) {
+  assert(c && g);
+  return store(c, g, solvable ? KNOWN_SOLUTION : KNOWN_UNSOLVABLE, 0);
+}
+
+/* ***************************** SOLCACHE CLOSE ***************************** */
+void solcache_close(solcache *c) {
+  if (!c) return;
+  if (c->map && !c->read_only) msync(c->map, c->size, MS_ASYNC);
+  detach(c);
+  pthread_rwlock_destroy(&c->lock);
+  free(c->filename);
+  free(c);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file game_solcache.h
+ * @brief Persistent Solution Cache.
+ * @details A solution cache remembers, for each game it has seen, its number
+ * of solutions and one of its solutions (or that it has none). A game is
+ * identified by its size, its wrapping option and its shapes, not by the
+ * orientations of its unlocked pieces: a shuffled game hits the entry of the
+ * solved one.
+ *
+ * The cache is a single file mapped in memory, in the byte order of the
+ * machine. It starts with a 64-byte header:
+ * - bytes 0-3: the magic number 0x4b54454e ("NETK" on little-endian machines)
+ * - bytes 4-7: the format version (1)
+ * - bytes 8-15: the number of slots of the index (a power of 2)
+ * - bytes 16-23: the number of games in the cache
+ * - bytes 24-31: the end of the records, in bytes from the start of the file
+ *
+ * Then comes the index, an open-addressing hash table of 16-byte slots (the
+ * hash of the game, see @ref solver_game_hash, and the offset of its record,
+ * or 0 for an empty slot), followed by the records. A record holds the hash,
+ * the number of solutions, the size, the wrapping option, what is known of the
+ * game, its shapes (one byte per square, with the orientation of the locked
+ * pieces, see @ref solver_square_key) and a solution (2 bits per square),
+ * padded to 8 bytes.
+ *
+ * Records are only appended: an update appends a new record and moves the
+ * offset of the slot, so readers never see a record being written and need no
+ * lock, even in other processes. Writers take a lock on the file. When the
+ * index is half full, the file is rewritten with twice as many slots and
+ * atomically renamed: the other processes switch to the new file on their next
+ * miss or write.
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+
+#ifndef __GAME_SOLCACHE_H__
+#define __GAME_SOLCACHE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/**
+ * @brief Size of the header of a cache file, in bytes.
+ **/
+#define SOLCACHE_HEADER_SIZE 64
+
+/**
+ * @brief Number of slots of the index of a new cache file.
+ **/
+#define SOLCACHE_INITIAL_SLOTS 1024
+
+/**
+ * @brief An opened solution cache.
+ **/
+typedef struct solcache_s solcache;
+
+/**
+ * @name Solution Cache Functions
+ * @{
+ */
+
+/**
+ * @brief Opens a solution cache, and creates it if needed.
+ * @details If the file cannot be written, the cache is opened read-only and
+ * the store functions do nothing. A cache can be shared by the threads of a
+ * process.
+ * @param filename the cache file
+ * @return the opened cache (or NULL if the file cannot be opened or is not a
+ * cache file)
+ **/
+solcache *solcache_open(const char *filename);
+
+/**
+ * @brief Looks up the number of solutions of a game.
+ * @param c the cache
+ * @param g the game
+ * @param nb_sols set to the exact number of solutions of @p g, if known
+ * @return true if the number of solutions of @p g is in the cache
+ **/
+bool solcache_count(solcache *c, cgame g, uint64_t *nb_sols);
+
+/**
+ * @brief Looks up a solution of a game.
+ * @param c the cache
+ * @param g the game, set to the solution in the cache if there is one
+ * @param solvable set to false if @p g is known to have no solution
+ * @return true if the cache knows a solution of @p g or that it has none
+ **/
+bool solcache_solution(solcache *c, game g, bool *solvable);
+
+/**
+ * @brief Stores the exact number of solutions of a game.
+ * @param c the cache
+ * @param g the game
+ * @param nb_sols the number of solutions of @p g
+ * @return true if the number was stored
+ **/
+bool solcache_put_count(solcache *c, cgame g, uint64_t nb_sols);
+
+/**
+ * @brief Stores a solution of a game.
+ * @param c the cache
+ * @param g the game, whose orientations are a solution if @p solvable
+ * @param solvable false if @p g has no solution
+ * @return true if the solution was stored
+ **/
+bool solcache_put_solution(solcache *c, cgame g, bool solvable);
+
+/**
+ * @brief Closes a solution cache.
+ * @details The entries stay in the file.
+ * @param c the cache
+ **/
+void solcache_close(solcache *c);
+
+/**
+ * @}
+ */
+
+#endif  // __GAME_SOLCACHE_H__
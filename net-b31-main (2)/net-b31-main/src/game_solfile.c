@@ -0,0 +1,99 @@
+/**
+ * @file game_solfile.c
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+#include "game_solfile.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game_ext.h"
+
+/* size of the write buffer */
+#define SOLFILE_BUFFER_SIZE (1 << 16)
+
+struct solfile_s {
+  FILE *f;           // output file
+  uint size;         // number of squares of a solution
+  uint record;       // size of a packed solution, in bytes
+  uint8_t *buffer;   // pending solutions
+  uint capacity;     // size of buffer (a whole number of solutions)
+  uint used;         // number of bytes used in buffer
+  uint64_t nb_sols;  // number of solutions written
+  bool error;        // set on the first write error
+};
+
+/* ************************************************************************** */
+/*                                  HELPERS                                   */
+/* ************************************************************************** */
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  for (int k = 0; k < 4; k++) p[k] = (v >> (8 * k)) & 0xFF;
+}
+
+static void flush(solfile *f) {
+  if (f->used > 0 && fwrite(f->buffer, 1, f->used, f->f) != f->used) f->error = true;
+  f->used = 0;
+}
+
+/* ************************************************************************** */
+/*                           SOLUTION FILE FUNCTIONS                          */
+/* ************************************************************************** */
+
+/* ****************************** SOLFILE OPEN ****************************** */
+solfile *solfile_open(char *filename, cgame g) {
+  assert(filename && g);
+
+  FILE *out = fopen(filename, "wb");
+  if (!out) return NULL;
+
+  solfile *f = (solfile *)malloc(sizeof(solfile));
+  assert(f);
+  f->f = out;
+  f->size = game_nb_rows(g) * game_nb_cols(g);
+  f->record = (f->size + 3) / 4;
+  f->used = 0;
+  f->nb_sols = 0;
+  f->error = false;
+
+  // The buffer holds a whole number of solutions (at least one)
+  f->capacity = f->record > SOLFILE_BUFFER_SIZE ? f->record : SOLFILE_BUFFER_SIZE - SOLFILE_BUFFER_SIZE % f->record;
+  f->buffer = (uint8_t *)malloc(f->capacity);
+  assert(f->buffer);
+
+  uint8_t header[SOLFILE_HEADER_SIZE] = {'N', 'E', 'T', 'S', 1, game_is_wrapping(g), 0, 0};
+  put_u32(header + 8, game_nb_rows(g));
+  put_u32(header + 12, game_nb_cols(g));
+  if (fwrite(header, 1, SOLFILE_HEADER_SIZE, out) != SOLFILE_HEADER_SIZE) f->error = true;
+
+  return f;
+}
+
+/* ***************************** SOLFILE WRITE ****************************** */
+bool solfile_write(const uint8_t *packed, uint size, void *file) {
+  solfile *f = (solfile *)file;
+  assert(f && packed && size == f->size);
+
+  if (f->used + f->record > f->capacity) flush(f);
+  memcpy(f->buffer + f->used, packed, f->record);
+  f->used += f->record;
+  f->nb_sols++;
+
+  return !f->error;
+}
+
+/* ***************************** SOLFILE CLOSE ****************************** */
+bool solfile_close(solfile *f, uint64_t *nb_sols) {
+  assert(f);
+  flush(f);
+  if (fclose(f->f) != 0) f->error = true;
+  if (nb_sols) *nb_sols = f->nb_sols;
+  bool ok = !f->error;
+  free(f->buffer);
+  free(f);
+  return ok;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file game_solfile.h
+ * @brief Binary Solution Files.
+ * @details A solution file stores many solutions of the same game in a compact
+ * form. It starts with a 16-byte header:
+ * - bytes 0-3: the magic string "NETS"
+ * - byte 4: the format version (1)
+ * - byte 5: the wrapping option (0 or 1)
+ * - bytes 6-7: reserved (0)
+ * - bytes 8-11: the number of rows (little-endian)
+ * - bytes 12-15: the number of columns (little-endian)
+ *
+ * Then each solution is stored as a packed orientation vector of
+ * (nb_rows * nb_cols + 3) / 4 bytes, as given by @ref solver_enumerate (2 bits
+ * per square). The number of solutions is deduced from the file size.
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+
+#ifndef __GAME_SOLFILE_H__
+#define __GAME_SOLFILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/**
+ * @brief Size of the header of a solution file, in bytes.
+ **/
+#define SOLFILE_HEADER_SIZE 16
+
+/**
+ * @brief A solution file opened for writing.
+ **/
+typedef struct solfile_s solfile;
+
+/**
+ * @name Solution File Functions
+ * @{
+ */
+
+/**
+ * @brief Creates a solution file for the solutions of a game.
+ * @details The header is written immediately. Solutions are buffered in
+ * memory and written by large blocks.
+ * @param filename output file
+ * @param g the game whose solutions will be written
+ * @return the opened file (or NULL in case of error)
+ **/
+solfile *solfile_open(char *filename, cgame g);
+
+/**
+ * @brief Appends a solution to a solution file.
+ * @details This function has the signature of a @ref solver_callback, so it
+ * can be given directly to @ref solver_enumerate with the file as user data.
+ * @param packed the packed orientations of the solution
+ * @param size the number of squares
+ * @param file the solution file (a solfile pointer)
+ * @return true if the solution was written, false in case of error
+ **/
+bool solfile_write(const uint8_t *packed, uint size, void *file);
+
+/**
+ * @brief Flushes and closes a solution file.
+ * @param f the solution file
+ * @param nb_sols set to the number of solutions given to the file (or NULL)
+ * @return true if the file was completely written, false if a write, the
+ * last flush or the closing failed (the file is then truncated)
+ **/
+bool solfile_close(solfile *f, uint64_t *nb_sols);
+
+/**
+ * @}
+ */
+
+#endif  // __GAME_SOLFILE_H__
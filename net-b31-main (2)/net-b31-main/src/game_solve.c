@@ -5,37 +5,380 @@
  * @copyright University of Bordeaux. All rights reserved, 2024.
  **/
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "game_aux.h"
+#include "game_solcache.h"
+#include "game_solfile.h"
+#include "game_solver.h"
 #include "game_tools.h"
 
+/* ****************************** PARSE ORDER ******************************* */
+static const char* order_names[NB_ORDERS] = {"dynamic", "row", "spiral", "bfs"};
+
+bool parse_order(const char* name, solver_order* order) {
+  for (uint k = 0; k < NB_ORDERS; k++)
+    if (strcmp(name, order_names[k]) == 0) {
+      *order = k;
+      return true;
+    }
+  return false;
+}
+
+/* ***************************** PARSE RESTART ****************************** */
+static const char* restart_names[NB_RESTARTS] = {"none", "luby", "geometric"};
+
+bool parse_restart(const char* name, solver_restart* restart) {
+  for (uint k = 0; k < NB_RESTARTS; k++)
+    if (strcmp(name, restart_names[k]) == 0) {
+      *restart = k;
+      return true;
+    }
+  return false;
+}
+
+/* ******************************* PORTFOLIO ******************************** */
+/* configurations raced by --portfolio, the first ones are used when fewer are asked */
+static const solver_options portfolio[] = {
+    {.order = SOLVER_ORDER_DYNAMIC},
+    {.order = SOLVER_ORDER_DYNAMIC,
+     .restart = SOLVER_RESTART_LUBY,
+     .seed = 1,
+     .max_nogoods = 10000,
+     .keep_learned = true},
+    {.order = SOLVER_ORDER_DYNAMIC, .max_nogoods = 10000},
+    {.order = SOLVER_ORDER_DYNAMIC, .restart = SOLVER_RESTART_GEOMETRIC, .seed = 2, .max_nogoods = 10000},
+    {.order = SOLVER_ORDER_DYNAMIC, .restart = SOLVER_RESTART_LUBY, .seed = 3},
+    {.order = SOLVER_ORDER_DYNAMIC, .randomize = true, .seed = 4},
+    {.order = SOLVER_ORDER_BFS, .max_nogoods = 10000},
+    {.order = SOLVER_ORDER_SPIRAL},
+};
+#define PORTFOLIO_SIZE (sizeof(portfolio) / sizeof(portfolio[0]))
+
+/* largest number of jobs of a partitioned count */
+#define MAX_JOBS 4096
+
+/* ***************************** PRINT CONFIG ******************************* */
+void print_config(const solver_options* config) {
+  printf("order %s", order_names[config->order]);
+  if (config->randomize || config->restart != SOLVER_RESTART_NONE)
+    printf(", seed %llu", (unsigned long long)config->seed);
+  if (config->restart != SOLVER_RESTART_NONE) printf(", %s restarts", restart_names[config->restart]);
+  if (config->max_nogoods > 0) printf(", %u nogoods%s", config->max_nogoods, config->keep_learned ? " kept" : "");
+}
+
+/* ****************************** PRINT STATS ******************************* */
+void print_stats(const solver_stats* st) {
+  static const char* rule_names[NB_RULES] = {"", "border", "neighbour", "endpoint", "closed", "nogood"};
+  printf("> Statistics:\n");
+  printf("  time        %.3f s\n", st->time);
+  printf("  nodes       %llu (%.0f nodes/s)\n", (unsigned long long)st->nodes,
+         st->time > 0 ? st->nodes / st->time : 0.0);
+  printf("  leaves      %llu, %llu solutions\n", (unsigned long long)st->leaves, (unsigned long long)st->solutions);
+  printf("  tries       %llu\n", (unsigned long long)st->tries);
+  for (uint r = RULE_NONE + 1; r < NB_RULES; r++)
+    printf("  pruned      %-10s %llu (%.1f%% of the tries)\n", rule_names[r], (unsigned long long)st->prunes[r],
+           st->tries > 0 ? 100.0 * st->prunes[r] / st->tries : 0.0);
+  printf("  max depth   %u\n", st->max_depth);
+  if (st->nogoods > 0 || st->backjumps > 0)
+    printf("  learning    %llu backjumps, %llu nogoods\n", (unsigned long long)st->backjumps,
+           (unsigned long long)st->nogoods);
+  if (st->restarts > 0) printf("  restarts    %llu\n", (unsigned long long)st->restarts);
+
+  // Effective branching factor: nodes at depth d+1 per node at depth d
+  printf("  branching  ");
+  for (uint d = 0; d < st->max_depth && d + 1 < st->depth_size; d++) {
+    if (d > 0 && d % 8 == 0) printf("\n             ");
+    double b = st->nodes_at_depth[d] > 0 ? (double)st->nodes_at_depth[d + 1] / st->nodes_at_depth[d] : 0.0;
+    printf(" %3u:%.2f", d, b);
+  }
+  printf("\n");
+}
+
+/* ***************************** PRINT ESTIMATE ***************************** */
+void print_estimate(const solver_estimate* est, uint nb_threads) {
+  if (est->exact) {
+    printf("> Search tree: %.0f nodes, %.0f solutions (counted in %.3f s)\n", est->nodes, est->solutions, est->seconds);
+    return;
+  }
+  printf("> Estimated search tree: %.3g nodes (95%% interval %.3g - %.3g, %u probes)\n", est->nodes, est->nodes_low,
+         est->nodes_high, est->probes);
+  printf("> Estimated solutions: %.3g (95%% interval %.3g - %.3g)\n", est->solutions, est->solutions_low,
+         est->solutions_high);
+  printf("> Estimated time to count them: %.3g s on one thread", est->seconds);
+  if (nb_threads > 1) printf(", %.3g s on %u threads", est->seconds / nb_threads, nb_threads);
+  printf(" (%.0f nodes/s, without splitting the board)\n", est->nodes_per_second);
+}
+
+/* ******************************* WRITE JOB ******************************** */
+/* one line for the merge: jobs, job, order, hash of the game, count, complete (1) or not (0);
+ * return false if the file cannot be written */
+static bool write_job(cgame g, const char* output, const solver_options* opts, uint nb_sols, bool complete) {
+  FILE* f = fopen(output, "w");
+  if (!f) return false;
+  bool ok = fprintf(f, "net-job %u %u %s %016llx %u %d\n", opts->nb_jobs, opts->job, order_names[opts->order],
+                    (unsigned long long)solver_game_hash(g), nb_sols, complete) > 0;
+  return fclose(f) == 0 && ok;
+}
+
+/* ******************************* MERGE JOBS ******************************* */
+/* add up the counts of the jobs of a partitioned count, check that each job is there once */
+static int merge_jobs(game g, char** files, uint nb_files) {
+  unsigned long long hash = solver_game_hash(g), total = 0;
+  uint nb_jobs = 0, nb_found = 0;
+  bool* found = NULL;
+  char first_order[16] = "";
+  bool ok = true;
+  for (uint k = 0; k < nb_files && ok; k++) {
+    FILE* f = fopen(files[k], "r");
+    uint jobs, job, count;
+    int complete;
+    char order[16];
+    unsigned long long h;
+    ok = f && fscanf(f, "net-job %u %u %15s %llx %u %d", &jobs, &job, order, &h, &count, &complete) == 6;
+    if (f) fclose(f);
+    if (!ok) {
+      fprintf(stderr, "Error: '%s' is not a job result\n", files[k]);
+    } else if (h != hash || (nb_jobs > 0 && (jobs != nb_jobs || strcmp(order, first_order) != 0)) || job >= jobs) {
+      fprintf(stderr, "Error: '%s' is a job of another count\n", files[k]);
+      ok = false;
+    } else if (!complete) {
+      fprintf(stderr, "Error: job %u of '%s' is incomplete\n", job, files[k]);
+      ok = false;
+    } else {
+      if (nb_jobs == 0) {
+        nb_jobs = jobs;
+        strcpy(first_order, order);
+        found = (bool*)calloc(nb_jobs, sizeof(bool));
+        assert(found);
+      }
+      if (found[job]) {
+        fprintf(stderr, "Error: job %u is given twice ('%s')\n", job, files[k]);
+        ok = false;
+      }
+      found[job] = true;
+      nb_found++;
+      total += count;
+    }
+  }
+  for (uint job = 0; ok && job < nb_jobs; job++)
+    if (!found[job]) fprintf(stderr, "Error: job %u of %u is missing\n", job, nb_jobs);
+  ok = ok && nb_found == nb_jobs;
+  if (ok) printf("> The game has %llu solutions (%u jobs merged)\n", total, nb_jobs);
+  free(found);
+  game_delete(g);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 /* **************************** COMPUTE SOLUTION **************************** */
-int compute_solution(game g, char* option, char* output) {
-  if (strcmp(option, "-s") == 0) {
-    if (game_solve(g)) {
+int compute_solution(game g, char* option, char* output, uint limit, uint nb_configs, uint nb_probes,
+                     uint nb_samples, bool approximate, bool min_turns, bool anneal, bool strips,
+                     const solver_options* opts, solcache* cache) {
+  if (strcmp(option, "-a") == 0) {
+    solfile* f = solfile_open(output, g);
+    if (!f) {
+      fprintf(stderr, "Error: cannot create '%s'\n", output);
+      game_delete(g);
+      return EXIT_FAILURE;
+    }
+    uint count;
+    solver_result res = solver_enumerate(g, solfile_write, f, opts, &count);
+    uint64_t nb_sols;
+    bool written = solfile_close(f, &nb_sols);
+    game_delete(g);
+    if (!written) {
+      fprintf(stderr, "Error: cannot write '%s', it holds only part of the %llu solutions found\n", output,
+              (unsigned long long)nb_sols);
+      return EXIT_FAILURE;
+    }
+    if (res == SOLVER_ABORTED) {
+      printf("> The enumeration was aborted: only %u solutions were written in '%s'\n", count, output);
+      return EXIT_FAILURE;
+    }
+    printf("> %u solutions were written in '%s'\n", count, output);
+    return EXIT_SUCCESS;
+  } else if (strcmp(option, "-r") == 0) {
+    solfile* f = solfile_open(output, g);
+    if (!f) {
+      fprintf(stderr, "Error: cannot create '%s'\n", output);
+      game_delete(g);
+      return EXIT_FAILURE;
+    }
+    // Draw the samples with the seed of the command line (or a random one)
+    rng seeded, *r = rng_default();
+    if (opts->randomize) {
+      rng_seed(&seeded, opts->seed);
+      r = &seeded;
+    }
+    uint size = game_nb_rows(g) * game_nb_cols(g);
+    direction* sol = (direction*)malloc(size * sizeof(direction));
+    uint8_t* packed = (uint8_t*)calloc((size + 3) / 4, 1);
+    assert(sol && packed);
+    solver_sampler* sampler = solver_sampler_new(g, approximate, opts);
+    solver_result res = SOLVER_SOLVED;
+    for (uint k = 0; k < nb_samples && res == SOLVER_SOLVED; k++) {
+      res = solver_sample(sampler, r, sol);
+      if (res != SOLVER_SOLVED) break;
+      memset(packed, 0, (size + 3) / 4);
+      for (uint pos = 0; pos < size; pos++) packed[pos / 4] |= sol[pos] << (2 * (pos % 4));
+      solfile_write(packed, size, f);
+    }
+    solver_sampler_delete(sampler);
+    free(packed);
+    free(sol);
+    uint64_t nb_sols;
+    bool written = solfile_close(f, &nb_sols);
+    game_delete(g);
+    if (!written) {
+      fprintf(stderr, "Error: cannot write '%s'\n", output);
+      return EXIT_FAILURE;
+    }
+    if (res == SOLVER_UNSOLVABLE)
+      printf("> The game has no solutions\n");
+    else if (res == SOLVER_ABORTED)
+      printf("> The sampling was aborted\n");
+    printf("> %llu random solutions were written in '%s'\n", (unsigned long long)nb_sols, output);
+    return res == SOLVER_SOLVED ? EXIT_SUCCESS : EXIT_FAILURE;
+  } else if (strcmp(option, "-e") == 0) {
+    solver_estimate est;
+    solver_result res = solver_estimate_size(g, nb_probes, opts, &est);
+    if (res == SOLVER_ABORTED) printf("> The estimation was aborted after %u probes\n", est.probes);
+    uint nb_threads = opts->nb_threads > 0 ? opts->nb_threads : solver_nb_threads();
+    if (est.probes > 0 || est.exact) print_estimate(&est, nb_threads);
+    if (output && (est.probes > 0 || est.exact)) {
+      // One line for the scripts: nodes (low high), solutions (low high), seconds on one thread
+      FILE* f = fopen(output, "w");
+      bool ok = f && fprintf(f, "%.6g %.6g %.6g %.6g %.6g %.6g %.6g\n", est.nodes, est.nodes_low, est.nodes_high,
+                             est.solutions, est.solutions_low, est.solutions_high, est.seconds) > 0;
+      if (f && fclose(f) != 0) ok = false;
+      if (!ok) {
+        fprintf(stderr, "Error: cannot write '%s'\n", output);
+        game_delete(g);
+        return EXIT_FAILURE;
+      }
+      printf("> Estimation was successfully saved as '%s'\n", output);
+    }
+    game_delete(g);
+    return res == SOLVER_ABORTED ? EXIT_FAILURE : EXIT_SUCCESS;
+  } else if (strcmp(option, "-s") == 0) {
+    // Any solution of the cache will do, unless the first or the closest one is wanted
+    solver_result res;
+    bool solvable;
+    uint turns;
+    if (min_turns) {
+      res = solver_solve_min(g, opts, &turns);
+      if (res == SOLVER_SOLVED) printf("> Fewest quarter turns from the current orientations: %u\n", turns);
+      if (res == SOLVER_ABORTED && turns != UINT_MAX) {
+        printf("> The search was aborted: the solution found needs %u quarter turns, maybe not the fewest\n", turns);
+        res = SOLVER_SOLVED;
+      }
+    } else if (anneal) {
+      uint cost;
+      res = solver_anneal(g, opts, &cost);
+      if (res == SOLVER_ABORTED)
+        printf("> The local search was aborted: the best state found has a cost of %u (mismatched edges plus "
+               "components minus one)\n", cost);
+    } else if (strips) {
+      res = solver_solve_strips(g, opts);
+    } else if (cache && !opts->deterministic && !game_won(g) && solcache_solution(cache, g, &solvable)) {
+      printf("> (answer of the cache)\n");
+      res = solvable ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+    } else if (nb_configs > 0) {
+      // Race the first configurations of the portfolio, within the limits of the command line
+      solver_options configs[PORTFOLIO_SIZE];
+      solver_stats stats[PORTFOLIO_SIZE] = {0};
+      for (uint k = 0; k < nb_configs; k++) {
+        configs[k] = portfolio[k];
+        configs[k].timeout = opts->timeout;
+        configs[k].max_nodes = opts->max_nodes;
+        configs[k].stats = opts->stats ? &stats[k] : NULL;
+      }
+      uint winner;
+      res = solver_portfolio(g, configs, nb_configs, &winner);
+      if (winner < nb_configs) {
+        printf("> Configuration %u won (", winner);
+        print_config(&configs[winner]);
+        printf(")\n");
+        if (opts->stats) *opts->stats = stats[winner];
+        stats[winner] = (solver_stats){0};
+      }
+      for (uint k = 0; k < nb_configs; k++) solver_stats_free(&stats[k]);
+    } else if (opts->restart != SOLVER_RESTART_NONE) {
+      res = solver_solve(g, opts);
+    } else {
+      res = solver_solve_parallel(g, opts);
+    }
+    if (cache && res != SOLVER_ABORTED) solcache_put_solution(cache, g, res == SOLVER_SOLVED);
+    if (res == SOLVER_SOLVED) {
       printf("> A solution to the game :\n");
       game_print(g);
       if (output) game_save(g, output);
       game_delete(g);
       return EXIT_SUCCESS;
     }
-    printf("> The game has no solutions\n");
+    if (res == SOLVER_ABORTED)
+      printf("> The search was aborted before finding a solution\n");
+    else
+      printf("> The game has no solutions\n");
     game_delete(g);
     return EXIT_FAILURE;
   } else {
-    uint nb_sols = game_nb_solutions(g);
-    printf("> The game has %u solutions\n", nb_sols);
-    if (output) {
+    if (opts->resume && !solver_checkpoint_matches(g, opts->checkpoint)) {
+      fprintf(stderr, "Error: '%s' is not a checkpoint of this game\n", opts->checkpoint);
+      game_delete(g);
+      return EXIT_FAILURE;
+    }
+    if (opts->resume) printf("> Resuming the count saved in '%s'\n", opts->checkpoint);
+    // The parts of a partition and the resumed counts are not whole counts
+    uint nb_sols = 0;
+    uint64_t cached;
+    bool whole = opts->nb_jobs == 0 && !opts->checkpoint;
+    solver_result res;
+    if (cache && whole && solcache_count(cache, g, &cached)) {
+      printf("> (answer of the cache)\n");
+      nb_sols = limit > 0 && cached >= limit ? limit : cached > UINT_MAX ? UINT_MAX : (uint)cached;
+      res = cached > 0 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+    } else {
+      res = solver_count_ext(g, limit, opts, &nb_sols);
+      if (cache && whole && res != SOLVER_ABORTED && (limit == 0 || nb_sols < limit))
+        solcache_put_count(cache, g, nb_sols);
+    }
+    if (res == SOLVER_ERROR) {
+      fprintf(stderr, "Error: cannot write the checkpoint '%s', the count was stopped after %u solutions\n",
+              opts->checkpoint, nb_sols);
+      game_delete(g);
+      return EXIT_FAILURE;
+    }
+    if (res == SOLVER_ABORTED)
+      printf("> The game has at least %u solutions (search aborted)\n", nb_sols);
+    else if (limit > 0 && nb_sols >= limit)
+      printf("> The game has at least %u solutions (limit reached)\n", nb_sols);
+    else
+      printf("> The game has %u solutions\n", nb_sols);
+    if (opts->nb_jobs > 0) printf("> (job %u of %u: only one part of the search tree)\n", opts->job, opts->nb_jobs);
+    if (output && opts->nb_jobs > 0) {
+      if (!write_job(g, output, opts, nb_sols, res != SOLVER_ABORTED && (limit == 0 || nb_sols < limit))) {
+        fprintf(stderr, "Error: cannot write '%s'\n", output);
+        game_delete(g);
+        return EXIT_FAILURE;
+      }
+      printf("> Job result was successfully saved as '%s'\n", output);
+    } else if (output) {
       FILE* f = fopen(output, "w");
-      assert(f);
-      fprintf(f, "%u\n", nb_sols);
-      fclose(f);
+      bool ok = f && fprintf(f, "%u\n", nb_sols) > 0;
+      if (f && fclose(f) != 0) ok = false;
+      if (!ok) {
+        fprintf(stderr, "Error: cannot write '%s'\n", output);
+        game_delete(g);
+        return EXIT_FAILURE;
+      }
       printf("> Game was successfully saved as '%s'\n", output);
     }
+    game_delete(g);
     return EXIT_SUCCESS;
   }
 }
@@ -45,7 +388,42 @@ int compute_solution(game g, char* option, char* output) {
 /* ************************************************************************** */
 
 void usage(const char* prog_name) {
-  fprintf(stderr, "Usage: %s <option> <input> [<output>]\n", prog_name);
+  fprintf(stderr, "Usage: %s <option> <input> [<output>] [<flags>]\n", prog_name);
+  fprintf(stderr, "       %s -m <input> <job result>...\n", prog_name);
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  -s  search a solution\n");
+  fprintf(stderr, "  -c  count the solutions\n");
+  fprintf(stderr, "  -r  write random solutions in <output>, drawn uniformly (same format as -a)\n");
+  fprintf(stderr, "  -e  estimate the size of the search tree, the number of solutions and the time to count them\n");
+  fprintf(stderr, "  -a  write all the solutions in <output> (binary file, 2 bits per square)\n");
+  fprintf(stderr, "  -m  merge the job results given after <input> (see --partition) and print the count\n");
+  fprintf(stderr, "Flags:\n");
+  fprintf(stderr, "  --threads <n>    number of threads (default: one per processor)\n");
+  fprintf(stderr, "  --deterministic  (-s) give the first solution in lexicographic order, whatever the threads\n");
+  fprintf(stderr, "  --min-turns      (-s) give the solution closest to the orientations (fewest quarter turns)\n");
+  fprintf(stderr, "  --anneal         (-s) local search from the orientations, for the largest boards\n");
+  fprintf(stderr, "  --strips         (-s) solve by strips of lines, for the long boards (16 squares across)\n");
+  fprintf(stderr, "  --limit <n>      (-c) stop counting after n solutions\n");
+  fprintf(stderr, "  --timeout <s>    (-s, -c) abort the search after s seconds\n");
+  fprintf(stderr, "  --max-nodes <n>  (-s, -c) abort the search after n nodes\n");
+  fprintf(stderr, "  --samples <n>    (-r) number of random solutions (default 1)\n");
+  fprintf(stderr, "  --approximate    (-r) estimate the large subtrees instead of counting them (close to uniform)\n");
+  fprintf(stderr, "  --probes <n>     (-e) number of random probes of the search tree (default 1000)\n");
+  fprintf(stderr, "  --no-split       (-c) count the board as a whole, without splitting it in independent parts\n");
+  fprintf(stderr, "  --checkpoint <f> (-c) save the rest of the count in f regularly (without splitting the board)\n");
+  fprintf(stderr, "  --checkpoint-interval <s>  (-c) seconds between two checkpoints (default 5)\n");
+  fprintf(stderr, "  --resume <f>     (-c) continue the count saved in the checkpoint f (and keep saving it)\n");
+  fprintf(stderr, "  --partition <k>  (-c) split the count in k jobs, count one, write it in <output>\n");
+  fprintf(stderr, "  --job <i>        (-c) the job counted, from 0 to k - 1\n");
+  fprintf(stderr, "  --cache <f>      (-s, -c) look the game up in the solution cache f, and store the answer\n");
+  fprintf(stderr, "  --order <o>      order of the squares: dynamic (default), row, spiral or bfs\n");
+  fprintf(stderr, "  --learn <n>      learn up to n nogoods and backjump over the decisions not involved\n");
+  fprintf(stderr, "  --seed <n>       seed of the random choices: ties and order of the orientations, samples of -r\n");
+  fprintf(stderr, "  --restart <r>    (-s) restart schedule: none (default), luby or geometric (randomized)\n");
+  fprintf(stderr, "  --restart-base <n>  (-s) nodes of the first run (default 512)\n");
+  fprintf(stderr, "  --keep-learned   (-s) keep the nogoods of --learn from one run to the next\n");
+  fprintf(stderr, "  --portfolio <k>  (-s) race the first k of %u configurations on k threads\n", (uint)PORTFOLIO_SIZE);
+  fprintf(stderr, "  -v               print statistics of the search (time, nodes, pruning, branching)\n");
   fprintf(stderr, "Example: %s -s default.txt default_sol.txt\n", prog_name);
   exit(EXIT_FAILURE);
 }
@@ -55,16 +433,112 @@ void usage(const char* prog_name) {
 /* ************************************************************************** */
 
 int main(int argc, char* argv[]) {
-  // This program needs at least 2 arguments (3rd one is facultative)
-  if (argc < 3) usage(argv[0]);
+  // Split positional arguments and flags
+  char** args = (char**)calloc(argc, sizeof(char*));
+  assert(args);
+  uint nb_args = 0;
+  uint limit = 0, nb_configs = 0, nb_probes = 0, nb_samples = 1;
+  bool approximate = false, min_turns = false, anneal = false, strips = false;
+  solver_options opts = {0};
+  solver_stats stats = {0};
+  solcache* cache = NULL;
+  for (int k = 1; k < argc; k++) {
+    if (strcmp(argv[k], "--limit") == 0 && k + 1 < argc)
+      limit = atoi(argv[++k]);
+    else if (strcmp(argv[k], "--probes") == 0 && k + 1 < argc)
+      nb_probes = atoi(argv[++k]);
+    else if (strcmp(argv[k], "--samples") == 0 && k + 1 < argc)
+      nb_samples = atoi(argv[++k]);
+    else if (strcmp(argv[k], "--approximate") == 0)
+      approximate = true;
+    else if (strcmp(argv[k], "--min-turns") == 0)
+      min_turns = true;
+    else if (strcmp(argv[k], "--anneal") == 0)
+      anneal = true;
+    else if (strcmp(argv[k], "--strips") == 0)
+      strips = true;
+    else if (strcmp(argv[k], "--threads") == 0 && k + 1 < argc)
+      opts.nb_threads = atoi(argv[++k]);
+    else if (strcmp(argv[k], "--deterministic") == 0)
+      opts.deterministic = true;
+    else if (strcmp(argv[k], "--timeout") == 0 && k + 1 < argc)
+      opts.timeout = atof(argv[++k]);
+    else if (strcmp(argv[k], "--max-nodes") == 0 && k + 1 < argc)
+      opts.max_nodes = strtoull(argv[++k], NULL, 10);
+    else if (strcmp(argv[k], "--no-split") == 0)
+      opts.no_decomposition = true;
+    else if (strcmp(argv[k], "--checkpoint") == 0 && k + 1 < argc)
+      opts.checkpoint = argv[++k];
+    else if (strcmp(argv[k], "--checkpoint-interval") == 0 && k + 1 < argc)
+      opts.checkpoint_interval = atof(argv[++k]);
+    else if (strcmp(argv[k], "--resume") == 0 && k + 1 < argc) {
+      opts.checkpoint = argv[++k];
+      opts.resume = true;
+    } else if (strcmp(argv[k], "--cache") == 0 && k + 1 < argc) {
+      cache = solcache_open(argv[++k]);
+      if (!cache) {
+        fprintf(stderr, "Error: '%s' is not a solution cache\n", argv[k]);
+        exit(EXIT_FAILURE);
+      }
+    } else if (strcmp(argv[k], "--order") == 0 && k + 1 < argc) {
+      if (!parse_order(argv[++k], &opts.order)) usage(argv[0]);
+    } else if (strcmp(argv[k], "--learn") == 0 && k + 1 < argc)
+      opts.max_nogoods = atoi(argv[++k]);
+    else if (strcmp(argv[k], "--seed") == 0 && k + 1 < argc) {
+      opts.seed = strtoull(argv[++k], NULL, 10);
+      opts.randomize = true;
+    } else if (strcmp(argv[k], "--restart") == 0 && k + 1 < argc) {
+      if (!parse_restart(argv[++k], &opts.restart)) usage(argv[0]);
+    } else if (strcmp(argv[k], "--restart-base") == 0 && k + 1 < argc)
+      opts.restart_base = strtoull(argv[++k], NULL, 10);
+    else if (strcmp(argv[k], "--portfolio") == 0 && k + 1 < argc) {
+      nb_configs = atoi(argv[++k]);
+      if (nb_configs == 0 || nb_configs > PORTFOLIO_SIZE) usage(argv[0]);
+    } else if (strcmp(argv[k], "--keep-learned") == 0)
+      opts.keep_learned = true;
+    else if (strcmp(argv[k], "-v") == 0)
+      opts.stats = &stats;
+    else if (strcmp(argv[k], "--partition") == 0 && k + 1 < argc)
+      opts.nb_jobs = atoi(argv[++k]);
+    else if (strcmp(argv[k], "--job") == 0 && k + 1 < argc)
+      opts.job = atoi(argv[++k]);
+    else if (argv[k][0] == '-' && argv[k][1] == '-')
+      usage(argv[0]);
+    else
+      args[nb_args++] = argv[k];
+  }
 
-  char* option = argv[1];
-  char* input = argv[2];
-  char* output = argc > 3 ? argv[3] : NULL;
+  // This program needs at least 2 arguments (3rd one is facultative, -m takes any number of job results)
+  if (nb_args < 2 || (nb_args > 3 && strcmp(args[0], "-m") != 0)) usage(argv[0]);
+  if (opts.nb_jobs > 0 && (opts.job >= opts.nb_jobs || opts.nb_jobs > MAX_JOBS)) usage(argv[0]);
 
-  if (strcmp(option, "-c") != 0 && strcmp(option, "-s") != 0) usage(argv[0]);  // Check valid option
+  char* option = args[0];
+  char* input = args[1];
+  char* output = args[2];
+
+  // Check valid option
+  static const char* options[] = {"-s", "-c", "-a", "-r", "-e", "-m"};
+  bool valid = false;
+  for (uint k = 0; k < sizeof(options) / sizeof(options[0]); k++) valid = valid || strcmp(option, options[k]) == 0;
+  if (!valid) usage(argv[0]);
+  if ((strcmp(option, "-a") == 0 || strcmp(option, "-r") == 0) && !output) usage(argv[0]);
+  if (opts.nb_jobs > 0 && (strcmp(option, "-c") != 0 || !output)) usage(argv[0]);
+  if (strcmp(option, "-m") == 0 && nb_args < 3) usage(argv[0]);
   game g = game_load(input);
   game_print(g);
+  if (strcmp(option, "-m") == 0) {
+    int ret = merge_jobs(g, args + 2, nb_args - 2);
+    free(args);
+    return ret;
+  }
 
-  return compute_solution(g, option, output);
+  int ret = compute_solution(g, option, output, limit, nb_configs, nb_probes, nb_samples, approximate, min_turns,
+                             anneal, strips, &opts, cache);
+  solcache_close(cache);
+  free(args);
+  if (opts.stats) {
+    print_stats(opts.stats);
+    solver_stats_free(opts.stats);
+  }
+  return ret;
 }
@@ -0,0 +1,4233 @@
+/**
+ * @file game_solver.c
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+#define _POSIX_C_SOURCE 200809L
+#include "game_solver.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "game_aux.h"
+#include "game_ext.h"
+#include "game_private.h"
+
+/* ************************************************************************** */
+/*                          MAPPING SHAPE AND DIRECTION                       */
+/* ************************************************************************** */
+#define NORTH_B 0b0001
+#define EAST_B 0b0010
+#define SOUTH_B 0b0100
+#define WEST_B 0b1000
+static uint8_t directions[] = {NORTH_B, EAST_B, SOUTH_B, WEST_B};
+
+#define OPPOSITE(d) (((d) + 2) % NB_DIRS)
+
+/* ************************************************************************** */
+/*                               SEARCH ENGINE                                */
+/* ************************************************************************** */
+
+/*
+ * Each square is packed in one byte (a cell):
+ * - bits 0-3: the orientations still possible (domain, NORTH_B ... WEST_B),
+ * - bits 4-5: the orientation chosen, when the square is fixed,
+ * - bit 6: the square is fixed.
+ * Every change of a cell is recorded on the trail with its previous value, so
+ * that backtracking only restores the cells changed since a trail mark.
+ */
+#define CELL_DOM 0x0F
+#define CELL_FIXED 0x40
+#define CELL_ORIENT(c) (((c) >> 4) & 3)
+#define NO_SQUARE UINT32_MAX
+
+/* number of orientations of each domain */
+static const uint8_t dom_size[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+/*
+ * With the dynamic order, the free squares are kept in buckets by score (see
+ * engine_score): the next square is taken from the lowest non-empty bucket.
+ */
+#define NB_SCORES 40
+#define NO_SCORE UINT8_MAX
+
+/*
+ * The fixed pieces form the components of the network, kept in a union-find
+ * (without path compression, so that it can be undone) with the number of
+ * half-edges of each component toward free squares. A component without such
+ * half-edges is closed: it is a conflict unless it holds all the pieces.
+ */
+#define UF_PARENT 0
+#define UF_SIZE 1
+#define UF_OPEN 2
+/* words saved on the union-find trail by one assignment: 4 unions of 3 words, and the open count */
+#define UF_SAVES_PER_ASSIGN 13
+#define UF(e, field, pos) ((e)->uf[(field) * (e)->size + (pos)])
+
+/* maximal number of squares of a recorded nogood: longer conflicts are only used to backjump */
+#define MAX_NOGOOD_LEN 12
+/* a random free square is chosen among the first RANDOM_TIES of the best bucket */
+#define RANDOM_TIES 4
+
+/* larger conflict sets (large closed components) are replaced by all the previous decisions */
+#define MAX_CONF_LEN 64
+
+/**
+ * @brief One change of a cell, undone when backtracking.
+ */
+typedef struct {
+  uint pos;     // the square changed
+  uint8_t old;  // its cell before the change
+} trail_entry;
+
+/**
+ * @brief One change of the union-find, undone when backtracking.
+ */
+typedef struct {
+  uint at;     // length of the cell trail when the word was changed
+  uint index;  // the word changed
+  uint old;    // its previous value
+} uf_entry;
+
+/**
+ * @brief One decision of the search: the square oriented at some depth.
+ */
+typedef struct {
+  uint pos;       // the square oriented at this depth
+  uint8_t left;   // orientations not tried yet
+  uint mark;      // length of the trail before the first try
+  bool solved;    // a solution was found below this decision
+  bool conf_all;  // the conflict set holds all the previous depths
+  uint* conf;     // conflict set: depths of the decisions which rejected orientations
+  uint conf_len;  // number of depths in conf
+  uint conf_cap;  // allocated size of conf
+} frame;
+
+/**
+ * @brief A nogood: orientations of some squares that no solution has all together.
+ */
+typedef struct {
+  uint len;                        // number of squares (0 for a free slot)
+  uint gen;                        // incremented when the slot is reused, to invalidate its occurrences
+  bool used;                       // second chance bit of the clock eviction
+  uint pos[MAX_NOGOOD_LEN];        // the squares
+  uint8_t orient[MAX_NOGOOD_LEN];  // their orientations
+} nogood;
+
+/**
+ * @brief An occurrence of a square and orientation in a nogood.
+ */
+typedef struct {
+  uint id;   // slot of the nogood
+  uint gen;  // generation of the slot when the nogood was recorded
+} occurrence;
+
+/**
+ * @brief A bounded database of nogoods, with a clock (second chance) eviction.
+ */
+typedef struct {
+  uint capacity;     // number of slots
+  uint hand;         // next slot examined by the eviction
+  nogood* slots;     // the nogoods
+  occurrence** occ;  // nogoods of each square and orientation (pos * NB_DIRS + orientation)
+  uint* occ_len;     // number of occurrences of each square and orientation
+  uint* occ_cap;     // allocated size of each list of occurrences
+} nogood_db;
+
+/**
+ * @brief The board seen by the search (one per thread).
+ * @details All the arrays are allocated once: the search does not allocate
+ * memory, does not recurse and does not go through the game accessors.
+ */
+typedef struct {
+  uint size;                               // number of squares
+  uint end;                                // depth of the leaves (size, unless only a part is searched)
+  bool joined;                             // the leaves must have all their fixed pieces in one component
+  uint nb_pieces;                          // number of non-empty squares
+  uint first_piece;                        // first non-empty square (size if none)
+  uint8_t* shapes;                         // shape of each square
+  uint8_t* cells;                          // packed cell of each square
+  uint* neighbours;                        // 4 neighbours of each square (NO_SQUARE outside the board)
+  uint* order;                             // static order in which the squares are oriented
+  bool dynamic;                            // the squares are chosen by engine_select instead
+  uint8_t* score;                          // bucket of each free square (NO_SCORE when fixed)
+  uint* bucket_next;                       // next square in the same bucket
+  uint* bucket_prev;                       // previous square in the same bucket
+  uint bucket_head[NB_SCORES];             // first square of each bucket (NO_SQUARE if empty)
+  trail_entry* trail;                      // changes of the cells since the root
+  uint trail_len;                          // number of changes on the trail
+  frame* frames;                           // decision stack, one frame per depth
+  uint* queue;                             // work queue of the breadth-first searches
+  uint* seen;                              // squares visited by the breadth-first searches (stamp)
+  uint stamp;                              // current stamp of seen
+  uint border_prunes;                      // orientations removed by the border of the board
+  uint* level;                             // depth at which each fixed square was fixed
+  uint* uf;                                // union-find of the fixed pieces (UF_PARENT, UF_SIZE, UF_OPEN)
+  uf_entry* uf_trail;                      // changes of the union-find since the root
+  uint uf_trail_len;                       // number of changes on the union-find trail
+  nogood_db* nogoods;                      // learned nogoods (NULL without learning)
+  uint* lvl_mark;                          // depths already in the conflict set being built (stamp)
+  uint conf_stamp;                         // current stamp of lvl_mark
+  uint conf_owner;                         // depth whose conflict set is marked in lvl_mark (NO_SQUARE if none)
+  const uint* reason;                      // squares responsible for the last rejection (with learning)
+  uint reason_len;                         // number of squares in reason
+  uint reason_buf[NB_DIRS];                // storage for short reasons
+  rng* rng;                                // source of the random choices (NULL for none)
+  uint8_t half_edges[NB_SHAPES][NB_DIRS];  // half-edges of each piece (NORTH_B ... WEST_B)
+  uint8_t compat[NB_SHAPES][NB_DIRS][2];   // orientations with (1) or without (0) a half-edge in a direction
+} engine;
+
+static void order_spiral(engine* e, uint nb_rows, uint nb_cols);
+static void order_bfs(engine* e, uint nb_rows, uint nb_cols);
+static void buckets_init(engine* e);
+
+/* ****************************** ENGINE INIT ******************************* */
+static void engine_init(engine* e, cgame g, solver_order order) {
+  uint nb_rows = game_nb_rows(g);
+  uint nb_cols = game_nb_cols(g);
+  uint size = nb_rows * nb_cols;
+  uint nb_locked = 0;
+  *e = (engine){.size = size, .end = size, .first_piece = size};
+
+  // Half-edges of the pieces, in the bit order of the domains
+  for (shape s = 0; s < NB_SHAPES; s++) {
+    for (direction o = 0; o < NB_DIRS; o++) {
+      uint code = _encode_shape(s, o);
+      for (direction d = 0; d < NB_DIRS; d++)
+        if (code & (0b1000 >> d)) e->half_edges[s][o] |= directions[d];
+    }
+    for (direction d = 0; d < NB_DIRS; d++)
+      for (direction o = 0; o < NB_DIRS; o++)
+        e->compat[s][d][(e->half_edges[s][o] & directions[d]) != 0] |= directions[o];
+  }
+
+  e->shapes = (uint8_t*)malloc(size * sizeof(uint8_t));
+  e->cells = (uint8_t*)malloc(size * sizeof(uint8_t));
+  e->neighbours = (uint*)malloc(NB_DIRS * size * sizeof(uint));
+  e->order = (uint*)malloc(size * sizeof(uint));
+  e->trail = (trail_entry*)malloc((NB_DIRS + 1) * size * sizeof(trail_entry));
+  e->frames = (frame*)calloc(size, sizeof(frame));
+  e->queue = (uint*)malloc(size * sizeof(uint));
+  e->seen = (uint*)calloc(size, sizeof(uint));
+  e->level = (uint*)malloc(size * sizeof(uint));
+  e->uf = (uint*)malloc(3 * size * sizeof(uint));
+  e->uf_trail = (uf_entry*)malloc(UF_SAVES_PER_ASSIGN * size * sizeof(uf_entry));
+  assert(e->shapes && e->cells && e->neighbours && e->order && e->trail && e->frames && e->queue && e->seen);
+  assert(e->level && e->uf && e->uf_trail);
+
+  for (uint pos = 0; pos < size; pos++) {
+    uint i = pos / nb_cols, j = pos % nb_cols;
+    shape s = game_get_piece_shape(g, i, j);
+    e->shapes[pos] = s;
+    e->order[pos] = pos;
+    UF(e, UF_PARENT, pos) = pos;
+    UF(e, UF_SIZE, pos) = 1;
+    UF(e, UF_OPEN, pos) = 0;
+    if (s != EMPTY) {
+      if (e->nb_pieces == 0) e->first_piece = pos;
+      e->nb_pieces++;
+    }
+
+    // Symmetric pieces only keep their distinct orientations, so that
+    // symmetric solutions are counted once; a locked piece keeps its own
+    uint8_t dom;
+    if (game_is_piece_locked(g, i, j)) {
+      dom = directions[game_get_piece_orientation(g, i, j)];
+      nb_locked++;
+    } else if (s == EMPTY || s == CROSS)
+      dom = NORTH_B;
+    else if (s == SEGMENT)
+      dom = NORTH_B | EAST_B;
+    else
+      dom = NORTH_B | EAST_B | SOUTH_B | WEST_B;
+
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint i_next, j_next;
+      if (game_get_ajacent_square(g, i, j, d, &i_next, &j_next)) {
+        e->neighbours[NB_DIRS * pos + d] = i_next * nb_cols + j_next;
+      } else {
+        // No half-edge can point out of the board
+        e->neighbours[NB_DIRS * pos + d] = NO_SQUARE;
+        uint8_t kept = dom & e->compat[s][d][0];
+        for (direction o = 0; o < NB_DIRS; o++)
+          if ((dom & ~kept) & directions[o]) e->border_prunes++;
+        dom = kept;
+      }
+    }
+    e->cells[pos] = dom;
+  }
+
+  if (order == SOLVER_ORDER_SPIRAL) order_spiral(e, nb_rows, nb_cols);
+  if (order == SOLVER_ORDER_BFS) order_bfs(e, nb_rows, nb_cols);
+  if (order == SOLVER_ORDER_DYNAMIC) buckets_init(e);
+
+  // The locked squares come first in a static order (the dynamic one starts with
+  // them anyway): the first depths propagate them before the first real decision
+  if (!e->dynamic && nb_locked > 0) {
+    uint nb_first = 0, nb_others = 0;
+    for (uint k = 0; k < size; k++) {
+      uint pos = e->order[k];
+      if (game_is_piece_locked(g, pos / nb_cols, pos % nb_cols))
+        e->order[nb_first++] = pos;
+      else
+        e->queue[nb_others++] = pos;
+    }
+    memcpy(e->order + nb_first, e->queue, nb_others * sizeof(uint));
+  }
+}
+
+/* ****************************** ENGINE FREE ******************************* */
+static void engine_free(engine* e) {
+  free(e->shapes);
+  free(e->cells);
+  free(e->neighbours);
+  free(e->order);
+  free(e->trail);
+  free(e->queue);
+  free(e->seen);
+  free(e->score);
+  free(e->bucket_next);
+  free(e->bucket_prev);
+  free(e->level);
+  free(e->uf);
+  free(e->uf_trail);
+  free(e->lvl_mark);
+  for (uint k = 0; k < e->size; k++) free(e->frames[k].conf);
+  free(e->frames);
+  if (e->nogoods) {
+    for (uint k = 0; k < NB_DIRS * e->size; k++) free(e->nogoods->occ[k]);
+    free(e->nogoods->occ);
+    free(e->nogoods->occ_len);
+    free(e->nogoods->occ_cap);
+    free(e->nogoods->slots);
+    free(e->nogoods);
+  }
+}
+
+/* ***************************** NOGOODS INIT ******************************* */
+/* enable learning, with a database of capacity nogoods */
+static void nogoods_init(engine* e, uint capacity) {
+  nogood_db* db = (nogood_db*)malloc(sizeof(nogood_db));
+  assert(db);
+  db->capacity = capacity;
+  db->hand = 0;
+  db->slots = (nogood*)calloc(capacity, sizeof(nogood));
+  db->occ = (occurrence**)calloc(NB_DIRS * e->size, sizeof(occurrence*));
+  db->occ_len = (uint*)calloc(NB_DIRS * e->size, sizeof(uint));
+  db->occ_cap = (uint*)calloc(NB_DIRS * e->size, sizeof(uint));
+  e->lvl_mark = (uint*)calloc(e->size, sizeof(uint));
+  e->conf_owner = NO_SQUARE;
+  assert(db->slots && db->occ && db->occ_len && db->occ_cap && e->lvl_mark);
+  e->nogoods = db;
+}
+
+/* ****************************** ORDER SPIRAL ****************************** */
+/* ring by ring, from the border toward the center */
+static void order_spiral(engine* e, uint nb_rows, uint nb_cols) {
+  int top = 0, bottom = nb_rows - 1, left = 0, right = nb_cols - 1;
+  uint k = 0;
+  while (top <= bottom && left <= right) {
+    for (int j = left; j <= right; j++) e->order[k++] = top * nb_cols + j;
+    top++;
+    for (int i = top; i <= bottom; i++) e->order[k++] = i * nb_cols + right;
+    right--;
+    if (top <= bottom) {
+      for (int j = right; j >= left; j--) e->order[k++] = bottom * nb_cols + j;
+      bottom--;
+    }
+    if (left <= right) {
+      for (int i = bottom; i >= top; i--) e->order[k++] = i * nb_cols + left;
+      left++;
+    }
+  }
+  assert(k == e->size);
+}
+
+/* ******************************* ORDER BFS ******************************** */
+/* breadth-first from the corner with the fewest orientations */
+static void order_bfs(engine* e, uint nb_rows, uint nb_cols) {
+  uint corners[] = {0, nb_cols - 1, (nb_rows - 1) * nb_cols, nb_rows * nb_cols - 1};
+  uint start = corners[0];
+  for (uint c = 1; c < 4; c++)
+    if (dom_size[e->cells[corners[c]] & CELL_DOM] < dom_size[e->cells[start] & CELL_DOM]) start = corners[c];
+
+  // The order itself is the queue of the traversal, e->seen marks the squares met
+  e->stamp++;
+  uint head = 0, tail = 0;
+  e->order[tail++] = start;
+  e->seen[start] = e->stamp;
+  while (head < tail) {
+    uint pos = e->order[head++];
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint next = e->neighbours[NB_DIRS * pos + d];
+      if (next != NO_SQUARE && e->seen[next] != e->stamp) {
+        e->seen[next] = e->stamp;
+        e->order[tail++] = next;
+      }
+    }
+  }
+  assert(tail == e->size);
+}
+
+/* ****************************** ENGINE SCORE ****************************** */
+/* bucket of a free square: fewest orientations first, then most constrained
+ * neighbours (fixed or out of the board), then squares that a fixed neighbour
+ * connects to (the frontier of the network already built) */
+static inline uint8_t engine_score(engine* e, uint pos) {
+  const uint* neighbours = e->neighbours + NB_DIRS * pos;
+  uint nb_fixed = 0;
+  bool linked = false;
+  for (direction d = 0; d < NB_DIRS; d++) {
+    uint next = neighbours[d];
+    if (next == NO_SQUARE) {
+      nb_fixed++;
+    } else if (e->cells[next] & CELL_FIXED) {
+      nb_fixed++;
+      if (e->half_edges[e->shapes[next]][CELL_ORIENT(e->cells[next])] & directions[OPPOSITE(d)]) linked = true;
+    }
+  }
+  uint nb_orients = dom_size[e->cells[pos] & CELL_DOM];
+  if (nb_orients == 0) return 0;  // no solution: fail as soon as possible
+  return (nb_orients - 1) * 10 + (NB_DIRS - nb_fixed) * 2 + !linked;
+}
+
+/* ***************************** BUCKET UNLINK ****************************** */
+static inline void bucket_unlink(engine* e, uint pos) {
+  uint next = e->bucket_next[pos], prev = e->bucket_prev[pos];
+  if (prev == NO_SQUARE)
+    e->bucket_head[e->score[pos]] = next;
+  else
+    e->bucket_next[prev] = next;
+  if (next != NO_SQUARE) e->bucket_prev[next] = prev;
+  e->score[pos] = NO_SCORE;
+}
+
+/* ****************************** BUCKET LINK ******************************* */
+static inline void bucket_link(engine* e, uint pos, uint8_t score) {
+  uint head = e->bucket_head[score];
+  e->bucket_next[pos] = head;
+  e->bucket_prev[pos] = NO_SQUARE;
+  if (head != NO_SQUARE) e->bucket_prev[head] = pos;
+  e->bucket_head[score] = pos;
+  e->score[pos] = score;
+}
+
+/* ******************************** RESCORE ********************************* */
+/* move a square to the bucket of its current score (or out of the buckets once fixed) */
+static inline void rescore(engine* e, uint pos) {
+  if (e->cells[pos] & CELL_FIXED) {
+    if (e->score[pos] != NO_SCORE) bucket_unlink(e, pos);
+    return;
+  }
+  uint8_t score = engine_score(e, pos);
+  if (score == e->score[pos]) return;
+  if (e->score[pos] != NO_SCORE) bucket_unlink(e, pos);
+  bucket_link(e, pos, score);
+}
+
+/* ********************************* TOUCH ********************************** */
+/* a cell changed: its score changes, and so do the ones of its neighbours when it
+ * was fixed or released */
+static inline void touch(engine* e, uint pos, uint8_t old) {
+  rescore(e, pos);
+  if ((old ^ e->cells[pos]) & CELL_FIXED)
+    for (direction d = 0; d < NB_DIRS; d++)
+      if (e->neighbours[NB_DIRS * pos + d] != NO_SQUARE) rescore(e, e->neighbours[NB_DIRS * pos + d]);
+}
+
+/* ****************************** BUCKETS INIT ****************************** */
+static void buckets_init(engine* e) {
+  e->dynamic = true;
+  e->score = (uint8_t*)malloc(e->size * sizeof(uint8_t));
+  e->bucket_next = (uint*)malloc(e->size * sizeof(uint));
+  e->bucket_prev = (uint*)malloc(e->size * sizeof(uint));
+  assert(e->score && e->bucket_next && e->bucket_prev);
+  for (uint s = 0; s < NB_SCORES; s++) e->bucket_head[s] = NO_SQUARE;
+  for (uint pos = e->size; pos-- > 0;) bucket_link(e, pos, engine_score(e, pos));
+}
+
+/* ***************************** ENGINE SELECT ****************************** */
+/* the square to orient at a depth: next one of the static order, or best free one */
+static inline uint engine_select(engine* e, uint depth) {
+  if (!e->dynamic) return e->order[depth];
+  for (uint s = 0; s < NB_SCORES; s++) {
+    uint pos = e->bucket_head[s];
+    if (pos == NO_SQUARE) continue;
+    if (e->rng) {
+      // The squares of a bucket are equally good: pick one of the first ones at random
+      uint n = 1;
+      for (uint next = e->bucket_next[pos]; next != NO_SQUARE && n < RANDOM_TIES; next = e->bucket_next[next]) n++;
+      for (uint r = rng_bounded(e->rng, n); r > 0; r--) pos = e->bucket_next[pos];
+    }
+    return pos;
+  }
+  assert(false);
+  return NO_SQUARE;
+}
+
+/* ******************************* ENGINE SET ******************************* */
+static inline void engine_set(engine* e, uint pos, uint8_t cell) {
+  uint8_t old = e->cells[pos];
+  e->trail[e->trail_len++] = (trail_entry){.pos = pos, .old = old};
+  e->cells[pos] = cell;
+  if (e->dynamic) touch(e, pos, old);
+}
+
+/* ****************************** ENGINE UNDO ******************************* */
+/* restore the cells as they were when the trail had mark entries */
+static inline void engine_undo(engine* e, uint mark) {
+  while (e->uf_trail_len > 0 && e->uf_trail[e->uf_trail_len - 1].at > mark) {
+    uf_entry* u = &e->uf_trail[--e->uf_trail_len];
+    e->uf[u->index] = u->old;
+  }
+  while (e->trail_len > mark) {
+    trail_entry* t = &e->trail[--e->trail_len];
+    uint8_t cur = e->cells[t->pos];
+    e->cells[t->pos] = t->old;
+    if (e->dynamic) touch(e, t->pos, cur);
+  }
+}
+
+/* ******************************** UF SET ********************************** */
+static inline void uf_set(engine* e, uint field, uint pos, uint value) {
+  uint index = field * e->size + pos;
+  e->uf_trail[e->uf_trail_len++] = (uf_entry){.at = e->trail_len, .index = index, .old = e->uf[index]};
+  e->uf[index] = value;
+}
+
+/* ******************************** UF FIND ********************************* */
+static inline uint uf_find(engine* e, uint pos) {
+  while (UF(e, UF_PARENT, pos) != pos) pos = UF(e, UF_PARENT, pos);
+  return pos;
+}
+
+/* ******************************** UF UNION ******************************** */
+/* merge two components given by their roots, return the new root */
+static inline uint uf_union(engine* e, uint a, uint b) {
+  if (UF(e, UF_SIZE, a) < UF(e, UF_SIZE, b)) {
+    uint tmp = a;
+    a = b;
+    b = tmp;
+  }
+  uf_set(e, UF_PARENT, b, a);
+  uf_set(e, UF_SIZE, a, UF(e, UF_SIZE, a) + UF(e, UF_SIZE, b));
+  uf_set(e, UF_OPEN, a, UF(e, UF_OPEN, a) + UF(e, UF_OPEN, b));
+  return a;
+}
+
+/* ****************************** ENGINE JOINED ***************************** */
+/* return true if the fixed pieces are all in the same component */
+static bool engine_joined(engine* e) {
+  uint root = NO_SQUARE;
+  for (uint pos = 0; pos < e->size; pos++) {
+    if (!(e->cells[pos] & CELL_FIXED) || e->shapes[pos] == EMPTY) continue;
+    uint other = uf_find(e, pos);
+    if (root == NO_SQUARE) root = other;
+    if (other != root) return false;
+  }
+  return true;
+}
+
+/* ***************************** EXPLAIN CLOSED ***************************** */
+/* reason of a closed component: all its squares (the search stops past MAX_CONF_LEN squares) */
+static void explain_closed(engine* e, uint pos) {
+  if (++e->stamp == 0) {
+    memset(e->seen, 0, e->size * sizeof(uint));
+    e->stamp = 1;
+  }
+  uint head = 0, tail = 0;
+  e->queue[tail++] = pos;
+  e->seen[pos] = e->stamp;
+  while (head < tail && tail <= MAX_CONF_LEN) {
+    uint cur = e->queue[head++];
+    uint8_t half_edges = e->half_edges[e->shapes[cur]][CELL_ORIENT(e->cells[cur])];
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint next = e->neighbours[NB_DIRS * cur + d];
+      if ((half_edges & directions[d]) && e->seen[next] != e->stamp) {
+        e->seen[next] = e->stamp;
+        e->queue[tail++] = next;
+      }
+    }
+  }
+  e->reason = e->queue;
+  e->reason_len = tail;
+}
+
+/* **************************** NOGOOD VIOLATED ***************************** */
+/* check the nogoods with the orientation just given to a square */
+static bool nogood_violated(engine* e, uint pos, direction o) {
+  nogood_db* db = e->nogoods;
+  uint key = NB_DIRS * pos + o;
+  occurrence* occ = db->occ[key];
+  for (uint k = 0; k < db->occ_len[key];) {
+    nogood* n = &db->slots[occ[k].id];
+    if (n->gen != occ[k].gen) {
+      occ[k] = occ[--db->occ_len[key]];  // the nogood was evicted
+      continue;
+    }
+    bool all = true;
+    for (uint l = 0; l < n->len && all; l++)
+      all = (e->cells[n->pos[l]] & CELL_FIXED) && CELL_ORIENT(e->cells[n->pos[l]]) == n->orient[l];
+    if (all) {
+      n->used = true;
+      e->reason = n->pos;
+      e->reason_len = n->len;
+      return true;
+    }
+    k++;
+  }
+  return false;
+}
+
+/* ***************************** NOGOODS CLEAR ****************************** */
+/* forget all the learned nogoods */
+static void nogoods_clear(engine* e) {
+  nogood_db* db = e->nogoods;
+  memset(db->slots, 0, db->capacity * sizeof(nogood));
+  memset(db->occ_len, 0, NB_DIRS * e->size * sizeof(uint));
+  db->hand = 0;
+}
+
+/* ****************************** NOGOOD ADD ******************************** */
+/* record the orientations of the decisions at some depths, return false if too long */
+static bool nogood_add(engine* e, const uint* depths, uint len) {
+  nogood_db* db = e->nogoods;
+  if (len == 0 || len > MAX_NOGOOD_LEN) return false;
+
+  // Clock eviction: the nogoods used since the hand last passed get a second chance
+  while (db->slots[db->hand].len > 0 && db->slots[db->hand].used) {
+    db->slots[db->hand].used = false;
+    db->hand = (db->hand + 1) % db->capacity;
+  }
+  uint id = db->hand;
+  db->hand = (db->hand + 1) % db->capacity;
+
+  nogood* n = &db->slots[id];
+  n->gen++;
+  n->len = len;
+  n->used = true;
+  for (uint k = 0; k < len; k++) {
+    uint pos = e->frames[depths[k]].pos;
+    n->pos[k] = pos;
+    n->orient[k] = CELL_ORIENT(e->cells[pos]);
+
+    uint key = NB_DIRS * pos + n->orient[k];
+    if (db->occ_len[key] == db->occ_cap[key]) {
+      db->occ_cap[key] = db->occ_cap[key] ? 2 * db->occ_cap[key] : 4;
+      db->occ[key] = (occurrence*)realloc(db->occ[key], db->occ_cap[key] * sizeof(occurrence));
+      assert(db->occ[key]);
+    }
+    db->occ[key][db->occ_len[key]++] = (occurrence){.id = id, .gen = n->gen};
+  }
+  return true;
+}
+
+/* ***************************** ENGINE ASSIGN ****************************** */
+/* fix a square and remove the incompatible orientations of its neighbours,
+ * return the rule which rejects the orientation (the cells must then be undone);
+ * with learning, e->reason is set to the other squares responsible */
+static inline solver_rule engine_assign(engine* e, uint pos, direction o) {
+  uint8_t s = e->shapes[pos];
+  uint8_t half_edges = e->half_edges[s][o];
+  const uint* neighbours = e->neighbours + NB_DIRS * pos;
+  e->reason_len = 0;
+
+  // Two endpoints connected to each other form a closed component
+  if (s == ENDPOINT && e->nb_pieces > 2 && neighbours[o] != NO_SQUARE && e->shapes[neighbours[o]] == ENDPOINT)
+    return RULE_ENDPOINT;
+
+  engine_set(e, pos, CELL_FIXED | (o << 4) | directions[o]);
+  for (direction d = 0; d < NB_DIRS; d++) {
+    uint next = neighbours[d];
+    if (next == NO_SQUARE) continue;  // already removed by engine_init
+    uint8_t cell = e->cells[next];
+    uint8_t kept = e->compat[e->shapes[next]][OPPOSITE(d)][(half_edges & directions[d]) != 0];
+    if (cell & CELL_FIXED) {
+      if (!(kept & directions[CELL_ORIENT(cell)])) {
+        e->reason_buf[0] = next;
+        e->reason = e->reason_buf;
+        e->reason_len = 1;
+        return RULE_NEIGHBOUR;
+      }
+    } else if ((cell & kept & CELL_DOM) != (cell & CELL_DOM)) {
+      if (!(cell & kept & CELL_DOM)) {
+        // The other orientations of next were removed by its fixed neighbours
+        if (e->nogoods) {
+          for (direction d2 = 0; d2 < NB_DIRS; d2++) {
+            uint other = e->neighbours[NB_DIRS * next + d2];
+            if (other != NO_SQUARE && (e->cells[other] & CELL_FIXED)) e->reason_buf[e->reason_len++] = other;
+          }
+          e->reason = e->reason_buf;
+        }
+        return RULE_NEIGHBOUR;
+      }
+      engine_set(e, next, (cell & ~CELL_DOM) | (cell & kept & CELL_DOM));
+    }
+  }
+
+  // Merge the component of the piece with the ones of its fixed neighbours
+  if (s != EMPTY) {
+    uint root = pos, open = 0, closed = 0;
+    for (direction d = 0; d < NB_DIRS; d++) {
+      if (!(half_edges & directions[d])) continue;
+      uint next = neighbours[d];
+      if (!(e->cells[next] & CELL_FIXED)) {
+        open++;
+      } else if (next != pos) {
+        closed++;  // next had an open half-edge toward this square
+        uint other = uf_find(e, next);
+        if (other != root) root = uf_union(e, root, other);
+      }
+    }
+    uf_set(e, UF_OPEN, root, UF(e, UF_OPEN, root) + open - closed);
+    if (UF(e, UF_OPEN, root) == 0 && UF(e, UF_SIZE, root) < e->nb_pieces) {
+      if (e->nogoods) explain_closed(e, pos);
+      return RULE_CLOSED;
+    }
+  }
+
+  if (e->nogoods && nogood_violated(e, pos, o)) return RULE_NOGOOD;
+  return RULE_NONE;
+}
+
+/* ****************************** CONF BEGIN ******************************** */
+/* mark the depths of the conflict set of a frame, before adding some */
+static inline void conf_begin(engine* e, uint depth) {
+  if (e->conf_owner == depth) return;
+  if (++e->conf_stamp == 0) {
+    memset(e->lvl_mark, 0, e->size * sizeof(uint));
+    e->conf_stamp = 1;
+  }
+  frame* f = &e->frames[depth];
+  for (uint k = 0; k < f->conf_len; k++) e->lvl_mark[f->conf[k]] = e->conf_stamp;
+  e->conf_owner = depth;
+}
+
+/* ****************************** CONF INSERT ******************************* */
+/* add a depth to the conflict set of a frame, conf_begin must have been called */
+static inline void conf_insert(engine* e, uint depth, uint level) {
+  frame* f = &e->frames[depth];
+  if (f->conf_all || e->lvl_mark[level] == e->conf_stamp) return;
+  if (f->conf_len == MAX_CONF_LEN) {
+    f->conf_all = true;
+    return;
+  }
+  e->lvl_mark[level] = e->conf_stamp;
+  if (f->conf_len == f->conf_cap) {
+    f->conf_cap = f->conf_cap ? 2 * f->conf_cap : 8;
+    f->conf = (uint*)realloc(f->conf, f->conf_cap * sizeof(uint));
+    assert(f->conf);
+  }
+  f->conf[f->conf_len++] = level;
+}
+
+/* ****************************** CONF REASON ******************************* */
+/* add the decisions responsible for the last rejection to the conflict set of a frame */
+static inline void conf_reason(engine* e, uint depth) {
+  uint pos = e->frames[depth].pos;
+  if (e->frames[depth].conf_all) return;
+  if (e->reason_len > MAX_CONF_LEN) {
+    e->frames[depth].conf_all = true;
+    return;
+  }
+  conf_begin(e, depth);
+  for (uint k = 0; k < e->reason_len; k++)
+    if (e->reason[k] != pos) conf_insert(e, depth, e->level[e->reason[k]]);
+}
+
+/* ****************************** CONF TARGET ******************************* */
+/* complete the conflict set of an exhausted frame with the decisions which
+ * removed orientations before it was entered, return its deepest depth (NO_SQUARE if empty) */
+static uint conf_target(engine* e, uint depth) {
+  frame* f = &e->frames[depth];
+  if (f->conf_all) return depth > 0 ? depth - 1 : NO_SQUARE;
+  conf_begin(e, depth);
+  for (direction d = 0; d < NB_DIRS; d++) {
+    uint next = e->neighbours[NB_DIRS * f->pos + d];
+    if (next != NO_SQUARE && (e->cells[next] & CELL_FIXED)) conf_insert(e, depth, e->level[next]);
+  }
+  uint target = NO_SQUARE;
+  for (uint k = 0; k < f->conf_len; k++)
+    if (target == NO_SQUARE || f->conf[k] > target) target = f->conf[k];
+  return target;
+}
+
+/* ********************************* JUMP *********************************** */
+/* go back from an exhausted frame to the deepest decision of its conflict set */
+static void jump(engine* e, uint depth, uint target) {
+  frame* f = &e->frames[depth];
+  bool solved = false;
+  for (uint k = target + 1; k < depth; k++) solved = solved || e->frames[k].solved;
+  if (solved) {
+    // The skipped decisions have solutions below: the target is not a failure
+    e->frames[target].solved = true;
+    return;
+  }
+  if (f->conf_all) {
+    e->frames[target].conf_all = true;
+    return;
+  }
+  conf_begin(e, target);
+  for (uint k = 0; k < f->conf_len; k++)
+    if (f->conf[k] != target) conf_insert(e, target, f->conf[k]);
+}
+
+/* ************************************************************************** */
+/*                               SEARCH CONTEXT                               */
+/* ************************************************************************** */
+
+/**
+ * @brief State shared by all the threads working on the same search.
+ */
+typedef struct {
+  atomic_uint nb_sols;                 // number of solutions found so far
+  atomic_bool stop;                    // set when the search must end, every thread stops
+  atomic_bool aborted;                 // set when the search was stopped by a limit of the options
+  atomic_uint_fast64_t nodes;          // number of nodes visited (updated every CHECK_INTERVAL nodes)
+  atomic_uint_fast64_t next_progress;  // number of nodes of the next progress report
+  const solver_options* opts;          // limits of the search
+  double deadline;                     // time at which the search is aborted (0 for none)
+} solver_shared;
+
+/**
+ * @brief A subtree of the search: the decisions leading to it from the root.
+ * With left, it is the rest of a search stack instead: the node reached by the
+ * decisions and the orientations not tried yet at each depth.
+ */
+typedef struct {
+  uint len;         // number of decisions
+  uint* pos;        // squares of the decisions
+  uint8_t* orient;  // their orientations
+  uint8_t* left;    // orientations left at each depth (or NULL for the node only)
+} subtree;
+
+/**
+ * @brief The subtrees waiting in a thread: the owner works at the bottom, the
+ * other threads steal at the top (the oldest, largest subtrees).
+ */
+typedef struct {
+  subtree* tasks;        // the subtrees, between top and bottom
+  uint top;              // index of the oldest subtree
+  uint bottom;           // index after the newest subtree
+  uint capacity;         // allocated size of tasks
+  pthread_mutex_t lock;  // protects the deque
+} task_deque;
+
+/**
+ * @brief Checkpoints of a count by work stealing: at regular intervals, every
+ * thread parks and leaves the rest of its stack in frontier, and the frontiers
+ * are saved with the subtrees of the deques. A limit of the options stops the
+ * count after one last checkpoint.
+ */
+typedef struct {
+  const char* file;      // checkpoint file
+  double interval;       // seconds between two checkpoints
+  atomic_bool request;   // set when the threads must park
+  uint running;          // threads not ended yet
+  uint parked;           // threads parked for the current checkpoint
+  uint gen;              // number of checkpoints taken: the parked threads wait for the next one
+  subtree* frontier;     // rest of the stack of each parked thread
+  bool* busy;            // the thread was searching a subtree when it parked
+  uint64_t solutions;    // solutions counted before the checkpoint resumed
+  uint64_t nodes;        // nodes visited before the checkpoint resumed
+  bool last;             // a limit is reached: the count stops after the next checkpoint
+  bool failed;           // a checkpoint could not be written: the count is stopped
+  pthread_mutex_t lock;  // protects the fields above request
+  pthread_cond_t cond;   // signaled when a thread parks or ends, and when a checkpoint is taken
+} solver_checkpoint;
+
+/**
+ * @brief A parallel search by work stealing.
+ */
+typedef struct {
+  cgame g;                    // the game to solve
+  uint nb_threads;            // number of threads
+  task_deque* deques;         // subtrees of each thread
+  atomic_uint pending;        // subtrees waiting or being searched: the search ends at 0
+  atomic_uint hungry;         // threads looking for a subtree
+  solver_shared shared;       // counters shared by all the threads
+  solver_options opts;        // options of the search
+  solver_stats* stats;        // statistics of the whole search (or NULL)
+  bool deterministic;         // search the lexicographically first solution
+  direction* best;            // best solution so far (deterministic mode)
+  bool found;                 // best holds a solution
+  atomic_uint best_gen;       // incremented when best changes
+  pthread_mutex_t lock;       // protects stats and best
+  solver_checkpoint* ckpt;    // checkpoints of a count (or NULL)
+  struct solver_ctx_s* ctxs;  // context of each thread
+  solver_stats* locals;       // statistics of each thread
+} solver_steal;
+
+/**
+ * @brief State of the search of one thread.
+ */
+typedef struct solver_ctx_s {
+  engine e;               // the board being searched
+  uint limit;             // stop after this number of solutions (0 for no limit)
+  direction* sols;        // storage for the first solutions found (or NULL)
+  uint nb_stored;         // number of solutions that fit in sols
+  solver_callback cb;     // called with each solution (or NULL)
+  void* cb_data;          // user data given to cb
+  uint8_t* packed;        // buffer for the packed solution given to cb
+  uint64_t nodes;         // nodes visited since the last check of the limits
+  solver_stats* stats;    // statistics of this thread (or NULL when disabled)
+  solver_shared* shared;  // counters shared with the other threads
+  rng rng;                // random choices of the engine (when randomized)
+  uint64_t run_budget;    // nodes of the current run before a restart (0 for none)
+  uint64_t run_nodes;     // nodes visited by the current run
+  bool restart;           // the current run was stopped by its budget
+  bool local_count;       // count the solutions in found, without sharing them (decomposition)
+  uint64_t found;         // solutions counted by this thread alone
+  solver_steal* steal;    // work-stealing search of the thread (or NULL)
+  uint thread;            // index of the thread in the work-stealing search
+  uint best_gen;          // generation of the best solution last compared
+} solver_ctx;
+
+/* the limits of the options are checked every CHECK_INTERVAL nodes */
+#define CHECK_INTERVAL 1024
+
+/* default restart schedule: nodes of the first run and growth of the geometric budgets */
+#define RESTART_BASE 512
+#define RESTART_FACTOR 1.5
+
+/* minimal number of tasks per thread for the parallel search */
+#define TASKS_PER_THREAD 8
+/* boards smaller than this are always solved sequentially */
+#define PARALLEL_MIN_SIZE 16
+
+/* ************************************************************************** */
+/*                               SOLVER FUNCTIONS                             */
+/* ************************************************************************** */
+
+/* ***************************** STORE SOLUTION ***************************** */
+static void store_solution(solver_ctx* ctx, uint index) {
+  if (!ctx->sols || index >= ctx->nb_stored) return;
+  direction* sol = ctx->sols + index * ctx->e.size;
+  for (uint pos = 0; pos < ctx->e.size; pos++) sol[pos] = CELL_ORIENT(ctx->e.cells[pos]);
+}
+
+/* ****************************** PACK SOLUTION ***************************** */
+static void pack_solution(engine* e, uint8_t* packed) {
+  memset(packed, 0, (e->size + 3) / 4);
+  for (uint pos = 0; pos < e->size; pos++) packed[pos / 4] |= CELL_ORIENT(e->cells[pos]) << (2 * (pos % 4));
+}
+
+/* ********************************** NOW *********************************** */
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ***************************** SHARED INIT ******************************** */
+static const solver_options default_options = {0};
+
+static void shared_init(solver_shared* shared, const solver_options* opts) {
+  if (!opts) opts = &default_options;
+  atomic_init(&shared->nb_sols, 0);
+  atomic_init(&shared->stop, false);
+  atomic_init(&shared->aborted, false);
+  atomic_init(&shared->nodes, 0);
+  atomic_init(&shared->next_progress, opts->progress_interval);
+  shared->opts = opts;
+  shared->deadline = opts->timeout > 0 ? now() + opts->timeout : 0;
+}
+
+/* ***************************** CHECK LIMITS ******************************* */
+/* publish the nodes visited by the thread, return true if the search must be aborted */
+static bool check_limits(solver_ctx* ctx) {
+  solver_shared* shared = ctx->shared;
+  const solver_options* opts = shared->opts;
+  uint64_t total = atomic_fetch_add(&shared->nodes, ctx->nodes) + ctx->nodes;
+  ctx->nodes = 0;
+
+  bool abort = (opts->cancel && atomic_load(opts->cancel));
+  abort = abort || (opts->max_nodes > 0 && total >= opts->max_nodes);
+  abort = abort || (shared->deadline > 0 && now() >= shared->deadline);
+
+  // Only one thread reports each progress step
+  if (!abort && opts->progress) {
+    uint64_t mark = atomic_load(&shared->next_progress);
+    if (total >= mark && atomic_compare_exchange_strong(&shared->next_progress, &mark, total + opts->progress_interval))
+      abort = !opts->progress(total, opts->progress_data);
+  }
+
+  // A checkpointed count goes on until its threads park for the last checkpoint
+  solver_checkpoint* ckpt = ctx->steal ? ctx->steal->ckpt : NULL;
+  if (abort && ckpt) {
+    pthread_mutex_lock(&ckpt->lock);
+    ckpt->last = true;
+    pthread_cond_broadcast(&ckpt->cond);
+    pthread_mutex_unlock(&ckpt->lock);
+    return false;
+  }
+  if (abort) {
+    atomic_store(&shared->aborted, true);
+    atomic_store(&shared->stop, true);
+  }
+  return abort;
+}
+
+/* ***************************** LEX COMPARE ******************************** */
+/* compare the orientations of the first len squares (row-major order) to a solution */
+static int lex_compare(engine* e, uint len, const direction* sol) {
+  for (uint pos = 0; pos < len; pos++) {
+    direction o = CELL_ORIENT(e->cells[pos]);
+    if (o != sol[pos]) return o < sol[pos] ? -1 : 1;
+  }
+  return 0;
+}
+
+/* ***************************** STEAL SOLUTION ***************************** */
+/* keep the solution if it is the first one in lexicographic order, end the subtree */
+static bool steal_solution(solver_ctx* ctx) {
+  solver_steal* steal = ctx->steal;
+  pthread_mutex_lock(&steal->lock);
+  if (!steal->found || lex_compare(&ctx->e, ctx->e.size, steal->best) < 0) {
+    for (uint pos = 0; pos < ctx->e.size; pos++) steal->best[pos] = CELL_ORIENT(ctx->e.cells[pos]);
+    steal->found = true;
+    atomic_fetch_add(&steal->best_gen, 1);
+  }
+  pthread_mutex_unlock(&steal->lock);
+  return true;
+}
+
+/* ******************************** DONATE ********************************** */
+/* give the orientations not tried yet of the shallowest decision below base to the deque */
+static void donate(solver_ctx* ctx, uint base, uint depth) {
+  engine* e = &ctx->e;
+  uint k = base;
+  while (k < depth && e->frames[k].left == 0) k++;
+  if (k == depth) return;
+
+  frame* f = &e->frames[k];
+  task_deque* dq = &ctx->steal->deques[ctx->thread];
+  pthread_mutex_lock(&dq->lock);
+  for (direction o = NB_DIRS; o-- > 0;) {
+    if (!(f->left & directions[o])) continue;
+    subtree t = {.len = k + 1};
+    t.pos = (uint*)malloc(t.len * sizeof(uint));
+    t.orient = (uint8_t*)malloc(t.len * sizeof(uint8_t));
+    assert(t.pos && t.orient);
+    for (uint l = 0; l < k; l++) {
+      t.pos[l] = e->frames[l].pos;
+      t.orient[l] = CELL_ORIENT(e->cells[e->frames[l].pos]);
+    }
+    t.pos[k] = f->pos;
+    t.orient[k] = o;
+    if (dq->bottom == dq->capacity) {
+      dq->capacity *= 2;
+      dq->tasks = (subtree*)realloc(dq->tasks, dq->capacity * sizeof(subtree));
+      assert(dq->tasks);
+    }
+    dq->tasks[dq->bottom++] = t;
+    atomic_fetch_add(&ctx->steal->pending, 1);
+  }
+  pthread_mutex_unlock(&dq->lock);
+
+  // The decision is no longer exhausted here: it must not be used to backjump
+  f->left = 0;
+  f->solved = true;
+}
+
+/* ********************************** PARK ********************************** */
+/* leave the rest of the stack (below base, up to the node at depth) for the
+ * checkpoint and wait until it is taken; an idle thread has no stack (depth NO_SQUARE) */
+static void park(solver_ctx* ctx, uint base, uint depth) {
+  solver_checkpoint* ckpt = ctx->steal->ckpt;
+  engine* e = &ctx->e;
+  pthread_mutex_lock(&ckpt->lock);
+  if (atomic_load(&ckpt->request)) {
+    subtree* t = &ckpt->frontier[ctx->thread];
+    ckpt->busy[ctx->thread] = depth != NO_SQUARE;
+    t->len = depth != NO_SQUARE ? depth : 0;
+    if (t->len > 0) {
+      t->pos = (uint*)realloc(t->pos, t->len * sizeof(uint));
+      t->orient = (uint8_t*)realloc(t->orient, t->len * sizeof(uint8_t));
+      t->left = (uint8_t*)realloc(t->left, t->len * sizeof(uint8_t));
+      assert(t->pos && t->orient && t->left);
+    }
+    for (uint k = 0; k < t->len; k++) {
+      t->pos[k] = e->frames[k].pos;
+      t->orient[k] = CELL_ORIENT(e->cells[t->pos[k]]);
+      t->left[k] = k >= base ? e->frames[k].left : 0;  // the other orientations above base belong to other subtrees
+    }
+    ckpt->parked++;
+    pthread_cond_broadcast(&ckpt->cond);
+    uint gen = ckpt->gen;
+    while (ckpt->gen == gen) pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+  }
+  pthread_mutex_unlock(&ckpt->lock);
+}
+
+/* ******************************* STEAL POLL ******************************* */
+/* share work with the idle threads, park for a checkpoint, return true if the
+ * search stops after the checkpoint or if the rest of the subtree cannot hold a
+ * better solution than the best one (deterministic mode) */
+static inline bool steal_poll(solver_ctx* ctx, uint base, uint depth) {
+  solver_steal* steal = ctx->steal;
+  if (steal->ckpt && atomic_load_explicit(&steal->ckpt->request, memory_order_relaxed)) {
+    park(ctx, base, depth);
+    if (atomic_load(&steal->shared.stop)) return true;
+  }
+  if (atomic_load_explicit(&steal->hungry, memory_order_relaxed) > 0) {
+    task_deque* dq = &steal->deques[ctx->thread];
+    pthread_mutex_lock(&dq->lock);
+    bool empty = dq->top == dq->bottom;
+    pthread_mutex_unlock(&dq->lock);
+    if (empty) donate(ctx, base, depth);
+  }
+  if (steal->deterministic) {
+    uint gen = atomic_load_explicit(&steal->best_gen, memory_order_acquire);
+    if (gen != ctx->best_gen) {
+      ctx->best_gen = gen;
+      pthread_mutex_lock(&steal->lock);
+      bool worse = lex_compare(&ctx->e, depth, steal->best) > 0;
+      pthread_mutex_unlock(&steal->lock);
+      if (worse) return true;
+    }
+  }
+  return false;
+}
+
+/* ***************************** FOUND SOLUTION ***************************** */
+/* record the solution held by the cells, return true if the search must stop */
+static bool found_solution(solver_ctx* ctx) {
+  if (ctx->local_count) return ++ctx->found >= ctx->limit && ctx->limit > 0;
+  if (ctx->steal && ctx->steal->deterministic) return steal_solution(ctx);
+  uint index = atomic_fetch_add(&ctx->shared->nb_sols, 1);
+  store_solution(ctx, index);
+  bool stop = ctx->limit > 0 && index + 1 >= ctx->limit;
+  if (ctx->cb) {
+    pack_solution(&ctx->e, ctx->packed);
+    if (!ctx->cb(ctx->packed, ctx->e.size, ctx->cb_data)) stop = true;
+  }
+  if (stop) atomic_store(&ctx->shared->stop, true);
+  return stop;
+}
+
+/* ********************************* SEARCH ********************************* */
+/* body of the search, compiled twice: with and without statistics (with_stats is a constant);
+ * with learning, an exhausted decision without solution below jumps back to the
+ * deepest decision of its conflict set (conflict-directed backjumping) and records it as a nogood */
+static inline __attribute__((always_inline)) bool search_body(solver_ctx* ctx, uint base, uint start,
+                                                             const bool with_stats) {
+  // Depth-first search below the first base squares of the order, which are fixed
+  // Start with the node at depth start: the decisions between base and start are already taken
+  // Return true when the search must stop (limit reached, maybe by another thread)
+  engine* e = &ctx->e;
+  uint depth = start;
+  if (check_limits(ctx)) return true;
+
+  while (true) {
+    // Enter the node at this depth
+    if (atomic_load_explicit(&ctx->shared->stop, memory_order_relaxed)) return true;
+    if (ctx->steal && steal_poll(ctx, base, depth)) return true;
+    if (++ctx->nodes >= CHECK_INTERVAL && check_limits(ctx)) return true;
+    if (ctx->run_budget > 0 && ++ctx->run_nodes > ctx->run_budget) {
+      ctx->restart = true;
+      return true;
+    }
+    if (with_stats) {
+      ctx->stats->nodes++;
+      ctx->stats->nodes_at_depth[depth]++;
+      if (depth > ctx->stats->max_depth) ctx->stats->max_depth = depth;
+    }
+    if (depth == e->end) {
+      // No closed component was found on the way: every leaf is a solution (unless
+      // only a joint part is searched, and the fixed pieces are not connected yet)
+      if (with_stats) ctx->stats->leaves++;
+      if (!e->joined || engine_joined(e)) {
+        if (with_stats) ctx->stats->solutions++;
+        if (found_solution(ctx)) return true;
+      }
+    } else {
+      frame* f = &e->frames[depth];
+      f->pos = engine_select(e, depth);
+      f->left = e->cells[f->pos] & CELL_DOM;
+      f->mark = e->trail_len;
+      f->solved = false;
+      f->conf_all = false;
+      f->conf_len = 0;
+      if (e->conf_owner == depth) e->conf_owner = NO_SQUARE;
+      e->level[f->pos] = depth;
+    }
+
+    // Go down with the next orientation of the deepest decision which has one left
+    while (true) {
+      if (depth == e->end || e->frames[depth].left == 0) {
+        if (depth < e->end) engine_undo(e, e->frames[depth].mark);
+        if (depth == base) return false;
+        bool solved = depth == e->end || e->frames[depth].solved;
+        if (!solved && e->nogoods) {
+          uint target = conf_target(e, depth);
+          if (target == NO_SQUARE || target < base) return false;  // no solution below base
+          frame* f = &e->frames[depth];
+          bool learned = !f->conf_all && nogood_add(e, f->conf, f->conf_len);
+          if (with_stats) {
+            ctx->stats->backjumps += target + 1 < depth;
+            ctx->stats->nogoods += learned;
+          }
+          jump(e, depth, target);
+          depth = target;
+          continue;
+        }
+        depth--;
+        if (solved) e->frames[depth].solved = true;
+        continue;
+      }
+      frame* f = &e->frames[depth];
+      direction o = 0;
+      uint r = e->rng ? rng_bounded(e->rng, dom_size[f->left]) : 0;
+      while (!(f->left & directions[o]) || r-- > 0) o++;
+      f->left &= ~directions[o];
+      engine_undo(e, f->mark);
+
+      solver_rule rule = engine_assign(e, f->pos, o);
+      if (with_stats) ctx->stats->tries++;
+      if (rule == RULE_NONE) break;
+      if (with_stats) ctx->stats->prunes[rule]++;
+      if (e->nogoods) conf_reason(e, depth);
+    }
+    depth++;
+  }
+}
+
+static bool search_stats(solver_ctx* ctx, uint base, uint start) { return search_body(ctx, base, start, true); }
+static bool search_fast(solver_ctx* ctx, uint base, uint start) { return search_body(ctx, base, start, false); }
+
+/* resume a search stack at depth start: the statistics are only collected when enabled */
+static bool search_from(solver_ctx* ctx, uint base, uint start) {
+  return ctx->stats ? search_stats(ctx, base, start) : search_fast(ctx, base, start);
+}
+
+/* entry point of the search */
+static bool search(solver_ctx* ctx, uint base) { return search_from(ctx, base, base); }
+
+/* ******************************* STATS INIT ******************************* */
+static void stats_init(solver_stats* stats, uint size) {
+  *stats = (solver_stats){.depth_size = size + 1};
+  stats->nodes_at_depth = (uint64_t*)calloc(size + 1, sizeof(uint64_t));
+  assert(stats->nodes_at_depth);
+}
+
+/* ****************************** STATS MERGE ******************************* */
+static void stats_merge(solver_stats* into, const solver_stats* from) {
+  into->nodes += from->nodes;
+  into->tries += from->tries;
+  for (uint r = 0; r < NB_RULES; r++) into->prunes[r] += from->prunes[r];
+  into->leaves += from->leaves;
+  into->solutions += from->solutions;
+  into->backjumps += from->backjumps;
+  into->nogoods += from->nogoods;
+  into->restarts += from->restarts;
+  if (from->max_depth > into->max_depth) into->max_depth = from->max_depth;
+  for (uint k = 0; k < into->depth_size && k < from->depth_size; k++)
+    into->nodes_at_depth[k] += from->nodes_at_depth[k];
+}
+
+/* ****************************** STATS BEGIN ******************************* */
+/* reset the statistics requested by the options, return them (or NULL when disabled) */
+static solver_stats* stats_begin(const solver_options* opts, const engine* e) {
+  if (!opts || !opts->stats) return NULL;
+  solver_stats_free(opts->stats);
+  stats_init(opts->stats, e->size);
+  opts->stats->prunes[RULE_BORDER] = e->border_prunes;
+  opts->stats->time = now();
+  return opts->stats;
+}
+
+/* ******************************* STATS END ******************************** */
+static void stats_end(solver_stats* stats) {
+  if (stats) stats->time = now() - stats->time;
+}
+
+/* ****************************** STATS FREE ******************************** */
+void solver_stats_free(solver_stats* stats) {
+  assert(stats);
+  free(stats->nodes_at_depth);
+  stats->nodes_at_depth = NULL;
+  stats->depth_size = 0;
+}
+
+/* ******************************** CTX INIT ******************************** */
+static void ctx_init(cgame g, solver_ctx* ctx, uint limit, solver_shared* shared) {
+  *ctx = (solver_ctx){.limit = limit, .shared = shared};
+  engine_init(&ctx->e, g, shared->opts->order);
+  if (shared->opts->max_nogoods > 0) nogoods_init(&ctx->e, shared->opts->max_nogoods);
+  if (shared->opts->randomize || shared->opts->restart != SOLVER_RESTART_NONE) {
+    rng_seed(&ctx->rng, shared->opts->seed);
+    ctx->e.rng = &ctx->rng;
+  }
+}
+
+/* ********************************** LUBY ********************************** */
+/* k-th term of the Luby sequence (k >= 1): 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ... */
+static uint64_t luby(uint64_t k) {
+  while (true) {
+    uint bits = 1;
+    while ((UINT64_C(1) << bits) - 1 < k) bits++;
+    if (k == (UINT64_C(1) << bits) - 1) return UINT64_C(1) << (bits - 1);
+    k -= (UINT64_C(1) << (bits - 1)) - 1;
+  }
+}
+
+/* ***************************** RESTART BUDGET ***************************** */
+/* nodes of a run of the restart schedule (run >= 1), 0 for no budget */
+static uint64_t restart_budget(const solver_options* opts, uint run) {
+  if (opts->restart == SOLVER_RESTART_NONE) return 0;
+  uint64_t base = opts->restart_base > 0 ? opts->restart_base : RESTART_BASE;
+  if (opts->restart == SOLVER_RESTART_LUBY) return base * luby(run);
+  double factor = opts->restart_factor > 1 ? opts->restart_factor : RESTART_FACTOR;
+  double budget = base;
+  for (uint k = 1; k < run && budget < 1e18; k++) budget *= factor;
+  return (uint64_t)budget;
+}
+
+/* ****************************** SOLVER COUNT ****************************** */
+uint solver_count(cgame g, uint limit, direction* sols, uint nb_sols) {
+  assert(g);
+  solver_shared shared;
+  shared_init(&shared, NULL);
+
+  solver_ctx ctx;
+  ctx_init(g, &ctx, limit, &shared);
+  ctx.sols = sols;
+  ctx.nb_stored = sols ? nb_sols : 0;
+
+  search(&ctx, 0);
+
+  engine_free(&ctx.e);
+  uint count = atomic_load(&shared.nb_sols);
+  return (limit > 0 && count > limit) ? limit : count;
+}
+
+/* **************************** SOLVER ENUMERATE **************************** */
+solver_result solver_enumerate(cgame g, solver_callback cb, void* data, const solver_options* opts, uint* count) {
+  assert(g && cb && count);
+  solver_shared shared;
+  shared_init(&shared, opts);
+
+  solver_ctx ctx;
+  ctx_init(g, &ctx, 0, &shared);
+  ctx.stats = stats_begin(opts, &ctx.e);
+  ctx.cb = cb;
+  ctx.cb_data = data;
+  ctx.packed = (uint8_t*)malloc((ctx.e.size + 3) / 4);
+  assert(ctx.packed);
+
+  search(&ctx, 0);
+  stats_end(ctx.stats);
+
+  free(ctx.packed);
+  engine_free(&ctx.e);
+  *count = atomic_load(&shared.nb_sols);
+  if (atomic_load(&shared.stop)) return SOLVER_ABORTED;  // by the limits or by the callback
+  return *count > 0 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+}
+
+/* ****************************** SOLVER SOLVE ****************************** */
+solver_result solver_solve(game g, const solver_options* opts) {
+  assert(g);
+  if (game_won(g)) return SOLVER_SOLVED;
+
+  solver_shared shared;
+  shared_init(&shared, opts);
+
+  // The solution is written directly in the game, which is only changed if one is found
+  solver_ctx ctx;
+  ctx_init(g, &ctx, 1, &shared);
+  ctx.stats = stats_begin(opts, &ctx.e);
+  ctx.sols = g->tab_direction;
+  ctx.nb_stored = 1;
+
+  // Each run continues the random choices of the previous one, from the root
+  for (uint run = 1;; run++) {
+    ctx.run_budget = restart_budget(shared.opts, run);
+    ctx.run_nodes = 0;
+    ctx.restart = false;
+    search(&ctx, 0);
+    if (!ctx.restart) break;
+    if (ctx.stats) ctx.stats->restarts++;
+    engine_undo(&ctx.e, 0);
+    if (ctx.e.nogoods && !shared.opts->keep_learned) nogoods_clear(&ctx.e);
+  }
+  stats_end(ctx.stats);
+
+  engine_free(&ctx.e);
+  if (atomic_load(&shared.nb_sols) > 0) return SOLVER_SOLVED;
+  return atomic_load(&shared.aborted) ? SOLVER_ABORTED : SOLVER_UNSOLVABLE;
+}
+
+/* ************************************************************************** */
+/*                               DECOMPOSITION                                */
+/* ************************************************************************** */
+
+/**
+ * @brief A count split into independent parts. Once the forced orientations
+ * are fixed, the free squares form regions (by adjacency). A region whose
+ * fixed neighbours lead into a single component of fixed pieces cannot connect
+ * that component to anything else: it is counted alone (pendant part). The
+ * other regions are counted together (joint part), with the fixed pieces. Each
+ * part is counted by the next idle thread, and the counts are multiplied.
+ */
+typedef struct {
+  cgame g;               // the game to count
+  uint limit;            // the count of each part stops at this number (0 for no limit)
+  uint nb_parts;         // number of parts
+  bool joint;            // part 0 is the joint part
+  uint* part;            // part of each free square (NO_SQUARE for the fixed ones)
+  uint* cells;           // squares of each part, in the static order of the search
+  uint* start;           // first square of each part in cells (nb_parts + 1 entries)
+  uint64_t* counts;      // number of solutions of each part
+  atomic_uint next;      // next part to count
+  solver_shared shared;  // counters shared by all the threads
+  solver_stats* stats;   // statistics of the whole search (or NULL)
+  pthread_mutex_t lock;  // protects stats
+} solver_split;
+
+/* **************************** ENGINE PROPAGATE **************************** */
+/* fix the squares with a single orientation left (until none is left), as the
+ * decisions of the first depths; return their number, or NO_SQUARE on a conflict */
+static uint engine_propagate(engine* e) {
+  uint depth = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (uint pos = 0; pos < e->size; pos++) {
+      uint8_t cell = e->cells[pos];
+      if ((cell & CELL_FIXED) || dom_size[cell & CELL_DOM] > 1) continue;
+      if (dom_size[cell & CELL_DOM] == 0) return NO_SQUARE;
+      direction o = 0;
+      while (!(cell & directions[o])) o++;
+      e->frames[depth].pos = pos;
+      e->level[pos] = depth++;
+      if (engine_assign(e, pos, o) != RULE_NONE) return NO_SQUARE;
+      changed = true;
+    }
+  }
+  return depth;
+}
+
+/* ****************************** REGION LINKS ****************************** */
+/* number of components of fixed pieces with a half-edge into a region (0, 1 or 2 for more) */
+static uint region_links(engine* e, const uint* cells, uint len) {
+  uint first = NO_SQUARE;
+  for (uint k = 0; k < len; k++) {
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint next = e->neighbours[NB_DIRS * cells[k] + d];
+      if (next == NO_SQUARE || !(e->cells[next] & CELL_FIXED)) continue;
+      if (!(e->half_edges[e->shapes[next]][CELL_ORIENT(e->cells[next])] & directions[OPPOSITE(d)])) continue;
+      uint root = uf_find(e, next);
+      if (first == NO_SQUARE) first = root;
+      if (root != first) return 2;
+    }
+  }
+  return first == NO_SQUARE ? 0 : 1;
+}
+
+/* ****************************** SPLIT PARTS ******************************* */
+/* group the free squares in parts, return false if there is no solution */
+static bool split_parts(solver_split* split, engine* e) {
+  uint* region = (uint*)malloc(e->size * sizeof(uint));
+  uint* cells = (uint*)malloc(e->size * sizeof(uint));
+  uint* start = (uint*)calloc(e->size + 1, sizeof(uint));
+  split->part = (uint*)malloc(e->size * sizeof(uint));
+  split->cells = (uint*)malloc(e->size * sizeof(uint));
+  split->start = (uint*)calloc(e->size + 2, sizeof(uint));
+  assert(region && cells && start && split->part && split->cells && split->start);
+
+  // Regions of free squares, by adjacency
+  uint nb_regions = 0, len = 0;
+  for (uint pos = 0; pos < e->size; pos++) region[pos] = NO_SQUARE;
+  for (uint pos = 0; pos < e->size; pos++) {
+    if ((e->cells[pos] & CELL_FIXED) || region[pos] != NO_SQUARE) continue;
+    region[pos] = nb_regions;
+    start[nb_regions] = len;
+    cells[len++] = pos;
+    for (uint head = start[nb_regions]; head < len; head++) {
+      for (direction d = 0; d < NB_DIRS; d++) {
+        uint next = e->neighbours[NB_DIRS * cells[head] + d];
+        if (next == NO_SQUARE || (e->cells[next] & CELL_FIXED) || region[next] != NO_SQUARE) continue;
+        region[next] = nb_regions;
+        cells[len++] = next;
+      }
+    }
+    nb_regions++;
+  }
+  start[nb_regions] = len;
+
+  // Pendant regions are parts of their own, the others form the joint part 0
+  bool pieces = e->nb_pieces > len, ok = true;
+  uint* part_of = (uint*)malloc((nb_regions + 1) * sizeof(uint));
+  assert(part_of);
+  split->nb_parts = 1;
+  for (uint r = 0; r < nb_regions; r++) {
+    uint links = region_links(e, cells + start[r], start[r + 1] - start[r]);
+    if (links == 0 && (pieces || nb_regions > 1)) ok = false;  // the region can never be connected
+    part_of[r] = (links == 1) ? split->nb_parts++ : 0;
+    if (links != 1) split->joint = true;
+  }
+  if (!split->joint) {
+    // Without joint part, the fixed pieces must already be connected
+    for (uint r = 0; r < nb_regions; r++) part_of[r]--;
+    split->nb_parts--;
+    if (!engine_joined(e)) ok = false;
+  }
+
+  // Squares of each part, in the order of the search
+  for (uint pos = 0; pos < e->size; pos++) {
+    split->part[pos] = region[pos] == NO_SQUARE ? NO_SQUARE : part_of[region[pos]];
+    if (split->part[pos] != NO_SQUARE) split->start[split->part[pos] + 1]++;
+  }
+  for (uint k = 0; k < split->nb_parts; k++) split->start[k + 1] += split->start[k];
+  memcpy(start, split->start, (split->nb_parts + 1) * sizeof(uint));
+  for (uint k = 0; k < e->size; k++) {
+    uint pos = e->order[k];
+    if (split->part[pos] != NO_SQUARE) split->cells[start[split->part[pos]]++] = pos;
+  }
+
+  free(part_of);
+  free(region);
+  free(cells);
+  free(start);
+  return ok;
+}
+
+/* ***************************** RESTRICT PART ****************************** */
+/* search only the squares of a part after the forced ones (or all of them again) */
+static void restrict_part(engine* e, const solver_split* split, uint nb_forced, uint k, bool on) {
+  uint len = split->start[k + 1] - split->start[k];
+  e->end = on ? nb_forced + len : e->size;
+  e->joined = on && split->joint && k == 0;
+  if (!e->dynamic) {
+    memcpy(e->order + nb_forced, split->cells + split->start[k], len * sizeof(uint));
+    return;
+  }
+  // The free squares of the other parts leave the buckets
+  for (uint pos = 0; pos < e->size; pos++) {
+    if (split->part[pos] == NO_SQUARE || split->part[pos] == k) continue;
+    if (on && e->score[pos] != NO_SCORE) bucket_unlink(e, pos);
+    if (!on) rescore(e, pos);
+  }
+}
+
+/* ****************************** SPLIT WORKER ****************************** */
+static void* split_worker(void* arg) {
+  solver_split* split = (solver_split*)arg;
+  solver_ctx ctx;
+  ctx_init(split->g, &ctx, split->limit, &split->shared);
+  ctx.local_count = true;
+  solver_stats local;
+  if (split->stats) {
+    stats_init(&local, ctx.e.size);
+    ctx.stats = &local;
+  }
+
+  uint nb_forced = engine_propagate(&ctx.e);
+  uint mark = ctx.e.trail_len;
+  uint k;
+  while ((k = atomic_fetch_add(&split->next, 1)) < split->nb_parts) {
+    if (atomic_load(&split->shared.stop)) break;
+    engine_undo(&ctx.e, mark);
+    restrict_part(&ctx.e, split, nb_forced, k, true);
+    ctx.found = 0;
+    search(&ctx, nb_forced);
+    restrict_part(&ctx.e, split, nb_forced, k, false);
+    split->counts[k] = ctx.found;
+    if (ctx.found == 0) atomic_store(&split->shared.stop, true);  // the product is 0
+  }
+  atomic_fetch_add(&split->shared.nodes, ctx.nodes);
+  if (split->stats) {
+    pthread_mutex_lock(&split->lock);
+    stats_merge(split->stats, &local);
+    pthread_mutex_unlock(&split->lock);
+    solver_stats_free(&local);
+  }
+  engine_free(&ctx.e);
+  return NULL;
+}
+
+/* ****************************** SPLIT COUNT ******************************* */
+/* count the solutions by independent parts, return false if the board does not split */
+static bool split_count(cgame g, uint limit, const solver_options* opts, uint* count, solver_result* result) {
+  solver_split split = {.g = g, .limit = limit};
+  atomic_init(&split.next, 0);
+  shared_init(&split.shared, opts);
+  solver_ctx ctx;
+  ctx_init(g, &ctx, limit, &split.shared);
+
+  uint nb_forced = engine_propagate(&ctx.e);
+  bool done = true;
+  if (nb_forced == ctx.e.size) {
+    *count = 1;  // every orientation is forced
+  } else if (nb_forced == NO_SQUARE || !split_parts(&split, &ctx.e)) {
+    *count = 0;
+  } else if (split.nb_parts == 1) {
+    done = false;
+  } else {
+    uint nb_threads = (opts && opts->nb_threads > 0) ? opts->nb_threads : solver_nb_threads();
+    if (nb_threads > split.nb_parts) nb_threads = split.nb_parts;
+    split.counts = (uint64_t*)calloc(split.nb_parts, sizeof(uint64_t));
+    assert(split.counts);
+    split.stats = stats_begin(opts, &ctx.e);
+    pthread_mutex_init(&split.lock, NULL);
+    pthread_t* threads = (pthread_t*)malloc(nb_threads * sizeof(pthread_t));
+    assert(threads);
+    for (uint t = 0; t < nb_threads; t++) pthread_create(&threads[t], NULL, split_worker, &split);
+    for (uint t = 0; t < nb_threads; t++) pthread_join(threads[t], NULL);
+    free(threads);
+    pthread_mutex_destroy(&split.lock);
+    stats_end(split.stats);
+
+    // Product of the counts, at most the limit (or the largest count)
+    uint64_t cap = limit > 0 ? limit : UINT_MAX, total = 1;
+    for (uint k = 0; k < split.nb_parts; k++) {
+      if (split.counts[k] == 0) total = 0;
+      total = (total > 0 && split.counts[k] > cap / total) ? cap : total * split.counts[k];
+    }
+    *count = (uint)total;
+    free(split.counts);
+  }
+
+  if (done) {
+    if (atomic_load(&split.shared.aborted))
+      *result = SOLVER_ABORTED;
+    else
+      *result = *count > 0 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+  }
+  free(split.part);
+  free(split.cells);
+  free(split.start);
+  engine_free(&ctx.e);
+  return done;
+}
+
+/* ************************************************************************** */
+/*                            FORCED ORIENTATIONS                             */
+/* ************************************************************************** */
+
+/* ******************************* FIX SINGLE ******************************* */
+/* fix a free square to its only orientation left, return false on a conflict */
+static inline bool fix_single(engine* e, uint pos) {
+  uint8_t cell = e->cells[pos];
+  if (dom_size[cell & CELL_DOM] == 0) return false;
+  direction o = 0;
+  while (!(cell & directions[o])) o++;
+  return engine_assign(e, pos, o) == RULE_NONE;
+}
+
+/* ******************************** UNIT FIX ******************************** */
+/* fix a square left with a single orientation and, from it, every free square
+ * left with a single orientation; return false on a conflict */
+static bool unit_fix(engine* e, uint pos) {
+  // The squares are fixed when queued, so that each one is queued once
+  if (!fix_single(e, pos)) return false;
+  uint head = 0, tail = 0;
+  e->queue[tail++] = pos;
+  while (head < tail) {
+    uint cur = e->queue[head++];
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint next = e->neighbours[NB_DIRS * cur + d];
+      if (next == NO_SQUARE || (e->cells[next] & CELL_FIXED) || dom_size[e->cells[next] & CELL_DOM] > 1) continue;
+      if (!fix_single(e, next)) return false;
+      e->queue[tail++] = next;
+    }
+  }
+  return true;
+}
+
+/* ********************************* FAILS ********************************** */
+/* try an orientation of a free square: does unit propagation lead to a conflict? */
+static bool fails(engine* e, uint pos, direction o) {
+  uint mark = e->trail_len;
+  engine_set(e, pos, (e->cells[pos] & ~CELL_DOM) | directions[o]);
+  bool failed = !unit_fix(e, pos);
+  engine_undo(e, mark);
+  return failed;
+}
+
+/* ***************************** SOLVER FORCED ****************************** */
+solver_result solver_forced(cgame g, bool probe, direction* forced) {
+  assert(g && forced);
+  engine e;
+  engine_init(&e, g, SOLVER_ORDER_ROW);
+  bool ok = true;
+  for (uint pos = 0; pos < e.size && ok; pos++)
+    if (!(e.cells[pos] & CELL_FIXED) && dom_size[e.cells[pos] & CELL_DOM] <= 1) ok = unit_fix(&e, pos);
+
+  // Failed literals: an orientation whose propagation fails is removed, until nothing changes
+  bool changed = probe;
+  while (ok && changed) {
+    changed = false;
+    for (uint pos = 0; pos < e.size && ok; pos++) {
+      for (direction o = 0; o < NB_DIRS && ok && !(e.cells[pos] & CELL_FIXED); o++) {
+        if (!(e.cells[pos] & directions[o]) || !fails(&e, pos, o)) continue;
+        engine_set(&e, pos, e.cells[pos] & ~directions[o]);
+        if (dom_size[e.cells[pos] & CELL_DOM] <= 1) ok = unit_fix(&e, pos);
+        changed = true;
+      }
+    }
+  }
+
+  for (uint pos = 0; pos < e.size; pos++)
+    forced[pos] = ok && (e.cells[pos] & CELL_FIXED) ? CELL_ORIENT(e.cells[pos]) : NB_DIRS;
+  engine_free(&e);
+  return ok ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+}
+
+/* ************************************************************************** */
+/*                             DIFFICULTY RATING                              */
+/* ************************************************************************** */
+
+/* ****************************** EDGE AGREES ******************************* */
+/* can each half-edge of an orientation of a free square, and each absence of
+ * one, be matched by an orientation left to the neighbour? */
+static bool edge_agrees(engine* e, uint pos, direction o) {
+  uint8_t half_edges = e->half_edges[e->shapes[pos]][o];
+  for (direction d = 0; d < NB_DIRS; d++) {
+    uint next = e->neighbours[NB_DIRS * pos + d];
+    if (next == NO_SQUARE || next == pos) continue;
+    uint8_t kept = e->compat[e->shapes[next]][OPPOSITE(d)][(half_edges & directions[d]) != 0];
+    if (!(e->cells[next] & kept & CELL_DOM)) return false;
+  }
+  return true;
+}
+
+/* ****************************** RATE REJECTS ****************************** */
+/* is an orientation of a free square removed by the rule of a level? */
+static bool rate_rejects(engine* e, uint pos, direction o, solver_level level) {
+  if (level == SOLVER_LEVEL_EDGES) return !edge_agrees(e, pos, o);
+  if (level == SOLVER_LEVEL_LOOKAHEAD) return fails(e, pos, o);
+  uint mark = e->trail_len;
+  solver_rule rule = engine_assign(e, pos, o);
+  engine_undo(e, mark);
+  return rule == RULE_ENDPOINT || rule == RULE_CLOSED;
+}
+
+/* ******************************* RATE PASS ******************************** */
+/* remove the orientations rejected by the rule of a level over the whole
+ * board, and fix the squares left with one; return true if some were removed */
+static bool rate_pass(engine* e, solver_level level, bool* ok) {
+  bool removed = false;
+  for (uint pos = 0; pos < e->size && *ok; pos++) {
+    for (direction o = 0; o < NB_DIRS && *ok && !(e->cells[pos] & CELL_FIXED); o++) {
+      if (!(e->cells[pos] & directions[o]) || !rate_rejects(e, pos, o, level)) continue;
+      engine_set(e, pos, e->cells[pos] & ~directions[o]);
+      if (dom_size[e->cells[pos] & CELL_DOM] <= 1) *ok = unit_fix(e, pos);
+      removed = true;
+    }
+  }
+  return removed;
+}
+
+/* ******************************** NB FREE ********************************* */
+/* number of squares not fixed yet */
+static uint nb_free(const engine* e) {
+  uint count = 0;
+  for (uint pos = 0; pos < e->size; pos++) count += !(e->cells[pos] & CELL_FIXED);
+  return count;
+}
+
+/* ****************************** SOLVER RATE ******************************* */
+solver_result solver_rate(cgame g, solver_rating* rating) {
+  assert(g && rating);
+  memset(rating, 0, sizeof(solver_rating));
+  engine e;
+  engine_init(&e, g, SOLVER_ORDER_ROW);
+  uint size = e.size;
+  bool ok = true;
+  for (uint pos = 0; pos < size && ok; pos++)
+    if (!(e.cells[pos] & CELL_FIXED) && dom_size[e.cells[pos] & CELL_DOM] <= 1) ok = unit_fix(&e, pos);
+
+  // The weakest rule which removes an orientation is used, then all of them are tried again
+  uint left = ok ? nb_free(&e) : 0;
+  rating->histogram[SOLVER_LEVEL_EDGES] = size - left;
+  solver_level level = SOLVER_LEVEL_EDGES;
+  while (ok && left > 0 && level < SOLVER_LEVEL_SEARCH) {
+    if (!rate_pass(&e, level, &ok)) {
+      level++;
+      continue;
+    }
+    uint now = nb_free(&e);
+    rating->histogram[level] += left - now;
+    if (level > rating->level) rating->level = level;
+    left = now;
+    level = SOLVER_LEVEL_EDGES;
+  }
+  engine_free(&e);
+  if (!ok) {
+    memset(rating, 0, sizeof(solver_rating));
+    return SOLVER_UNSOLVABLE;
+  }
+
+  rating->nb_guesses = left;
+  rating->histogram[SOLVER_LEVEL_SEARCH] = left;
+  if (left > 0) rating->level = SOLVER_LEVEL_SEARCH;
+  rating->grade = rating->level == SOLVER_LEVEL_EDGES    ? SOLVER_GRADE_EASY
+                  : rating->level == SOLVER_LEVEL_CLOSED ? SOLVER_GRADE_MEDIUM
+                                                         : SOLVER_GRADE_HARD;
+  double sum = 0;
+  for (uint k = 0; k < NB_LEVELS; k++) sum += (k + 1.0) * rating->histogram[k];
+  rating->difficulty = size > 0 ? sum / size : 1.0;
+  return SOLVER_SOLVED;
+}
+
+/* ************************************************************************** */
+/*                             MINIMUM ROTATIONS                              */
+/* ************************************************************************** */
+
+/**
+ * @brief A branch and bound over the orientations, for the solution closest to
+ * the current orientations. The bound of a node is the sum, over all the
+ * squares, of the fewest quarter turns toward an orientation still in their
+ * domain: it is exact for the fixed squares and never above the cost of a
+ * solution below the node.
+ */
+typedef struct {
+  uint8_t* cost;      // quarter turns of each square to each orientation (pos * NB_DIRS + o)
+  direction* reach;   // the orientation equivalent to each one reached by these turns
+  uint8_t* min_cost;  // fewest quarter turns of each square over each domain (pos * 16 + dom)
+  uint* bound;        // bound of the node at each depth
+  direction* best;    // best solution found
+  uint best_cost;     // its cost (UINT_MAX if none)
+} solver_bnb;
+
+/* ******************************** BNB INIT ******************************** */
+static void bnb_init(solver_bnb* b, cgame g, const engine* e) {
+  b->cost = (uint8_t*)malloc(e->size * NB_DIRS);
+  b->reach = (direction*)malloc(e->size * NB_DIRS * sizeof(direction));
+  b->min_cost = (uint8_t*)malloc(e->size * 16);
+  b->bound = (uint*)malloc((e->size + 1) * sizeof(uint));
+  b->best = (direction*)malloc(e->size * sizeof(direction));
+  assert(b->cost && b->reach && b->min_cost && b->bound && b->best);
+  b->best_cost = UINT_MAX;
+
+  uint nb_cols = game_nb_cols(g);
+  for (uint pos = 0; pos < e->size; pos++) {
+    // The symmetric orientations of a piece are reached by the fewest turns, in either way
+    shape s = e->shapes[pos];
+    uint period = _shape_period(s);
+    direction cur = game_get_piece_orientation(g, pos / nb_cols, pos % nb_cols);
+    for (direction o = 0; o < NB_DIRS; o++) {
+      b->cost[NB_DIRS * pos + o] = NB_DIRS;
+      for (uint t = 0; t < NB_DIRS; t++) {
+        uint turns = t <= NB_DIRS - t ? t : NB_DIRS - t;
+        if ((cur + t + NB_DIRS - o) % period != 0 || turns >= b->cost[NB_DIRS * pos + o]) continue;
+        b->cost[NB_DIRS * pos + o] = turns;
+        b->reach[NB_DIRS * pos + o] = (cur + t) % NB_DIRS;
+      }
+    }
+    for (uint dom = 0; dom < 16; dom++) {
+      uint8_t fewest = dom ? NB_DIRS : 0;
+      for (direction o = 0; o < NB_DIRS; o++)
+        if ((dom & directions[o]) && b->cost[NB_DIRS * pos + o] < fewest) fewest = b->cost[NB_DIRS * pos + o];
+      b->min_cost[16 * pos + dom] = fewest;
+    }
+  }
+}
+
+/* ******************************** BNB FREE ******************************** */
+static void bnb_free(solver_bnb* b) {
+  free(b->cost);
+  free(b->reach);
+  free(b->min_cost);
+  free(b->bound);
+  free(b->best);
+}
+
+/* ******************************* BNB RAISE ******************************** */
+/* increase of the bound by the changes of the cells since a trail mark */
+static uint bnb_raise(solver_bnb* b, engine* e, uint mark) {
+  if (++e->stamp == 0) {
+    memset(e->seen, 0, e->size * sizeof(uint));
+    e->stamp = 1;
+  }
+  uint raise = 0;
+  for (uint k = mark; k < e->trail_len; k++) {
+    // The first change of a square since the mark holds its domain before them all
+    uint pos = e->trail[k].pos;
+    if (e->seen[pos] == e->stamp) continue;
+    e->seen[pos] = e->stamp;
+    raise += b->min_cost[16 * pos + (e->cells[pos] & CELL_DOM)] - b->min_cost[16 * pos + (e->trail[k].old & CELL_DOM)];
+  }
+  return raise;
+}
+
+/* ******************************* BNB SEARCH ******************************* */
+/* depth-first branch and bound, the cheapest orientations first; return true if aborted */
+static bool bnb_search(solver_ctx* ctx, solver_bnb* b) {
+  engine* e = &ctx->e;
+  solver_stats* stats = ctx->stats;
+  uint depth = 0;
+  if (check_limits(ctx)) return true;
+  b->bound[0] = 0;
+  for (uint pos = 0; pos < e->size; pos++) b->bound[0] += b->min_cost[16 * pos + (e->cells[pos] & CELL_DOM)];
+
+  while (true) {
+    // Enter the node at this depth, unless it cannot beat the best solution
+    if (++ctx->nodes >= CHECK_INTERVAL && check_limits(ctx)) return true;
+    if (stats) {
+      stats->nodes++;
+      stats->nodes_at_depth[depth]++;
+      if (depth > stats->max_depth) stats->max_depth = depth;
+    }
+    if (depth == e->end) {
+      // Every leaf is a solution, and its bound is its cost
+      if (stats) stats->leaves++;
+      if (b->bound[depth] < b->best_cost) {
+        if (stats) stats->solutions++;
+        b->best_cost = b->bound[depth];
+        for (uint pos = 0; pos < e->size; pos++) b->best[pos] = b->reach[NB_DIRS * pos + CELL_ORIENT(e->cells[pos])];
+      }
+    } else {
+      frame* f = &e->frames[depth];
+      f->pos = engine_select(e, depth);
+      f->left = b->bound[depth] < b->best_cost ? e->cells[f->pos] & CELL_DOM : 0;
+      f->mark = e->trail_len;
+    }
+
+    // Go down with the cheapest orientation left of the deepest decision which has one
+    while (true) {
+      if (depth == e->end || e->frames[depth].left == 0) {
+        if (depth < e->end) engine_undo(e, e->frames[depth].mark);
+        if (depth == 0) return false;
+        depth--;
+        continue;
+      }
+      frame* f = &e->frames[depth];
+      const uint8_t* cost = b->cost + NB_DIRS * f->pos;
+      direction o = NB_DIRS;
+      for (direction d = 0; d < NB_DIRS; d++)
+        if ((f->left & directions[d]) && (o == NB_DIRS || cost[d] < cost[o])) o = d;
+      f->left &= ~directions[o];
+      engine_undo(e, f->mark);
+
+      // The orientations left cost at least as much: none of them can beat the best solution either
+      uint own = cost[o] - b->min_cost[16 * f->pos + (e->cells[f->pos] & CELL_DOM)];
+      if (b->bound[depth] + own >= b->best_cost) {
+        f->left = 0;
+        continue;
+      }
+      solver_rule rule = engine_assign(e, f->pos, o);
+      if (stats) stats->tries++;
+      if (rule == RULE_NONE) break;
+      if (stats) stats->prunes[rule]++;
+    }
+    b->bound[depth + 1] = b->bound[depth] + bnb_raise(b, e, e->frames[depth].mark);
+    depth++;
+  }
+}
+
+/* **************************** SOLVER SOLVE MIN **************************** */
+solver_result solver_solve_min(game g, const solver_options* opts, uint* turns) {
+  assert(g && turns);
+
+  // Learned nogoods would also cut the solutions pruned by the bound: only the order is kept
+  solver_options bnb_opts = opts ? *opts : default_options;
+  bnb_opts.max_nogoods = 0;
+  bnb_opts.randomize = false;
+  bnb_opts.restart = SOLVER_RESTART_NONE;
+  solver_shared shared;
+  shared_init(&shared, &bnb_opts);
+
+  solver_ctx ctx;
+  ctx_init(g, &ctx, 0, &shared);
+  ctx.stats = stats_begin(&bnb_opts, &ctx.e);
+  solver_bnb b;
+  bnb_init(&b, g, &ctx.e);
+  bool aborted = bnb_search(&ctx, &b);
+  stats_end(ctx.stats);
+
+  // The game keeps its orientations if no solution was found
+  if (b.best_cost != UINT_MAX) memcpy(g->tab_direction, b.best, ctx.e.size * sizeof(direction));
+  *turns = b.best_cost;
+  solver_result res = aborted ? SOLVER_ABORTED : b.best_cost != UINT_MAX ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+  bnb_free(&b);
+  engine_free(&ctx.e);
+  return res;
+}
+
+/* ************************************************************************** */
+/*                              PARALLEL SEARCH                               */
+/* ************************************************************************** */
+
+/**
+ * @brief A parallel search: the orientations of the first squares (the prefix)
+ * are enumerated, and each combination is a task taken by the next idle thread.
+ */
+typedef struct {
+  cgame g;               // the game to solve
+  uint limit;            // stop after this number of solutions (0 for no limit)
+  uint prefix;           // number of squares in the prefix
+  uint nb_tasks;         // number of prefix combinations
+  atomic_uint next;      // next task to take
+  solver_shared shared;  // counters shared by all the threads
+  solver_stats* stats;   // statistics of the whole search (or NULL)
+  pthread_mutex_t lock;  // protects stats
+} solver_par;
+
+/* ****************************** DOMAIN SIZE ******************************* */
+static uint domain_size(uint8_t dom) {
+  uint n = 0;
+  for (direction d = 0; d < NB_DIRS; d++)
+    if (dom & directions[d]) n++;
+  return n;
+}
+
+/* ****************************** SET PREFIX ******************************** */
+/* fix the prefix of a task, return false if it is already a mismatch */
+static bool set_prefix(engine* e, const uint8_t* initial, uint prefix, uint task) {
+  for (uint k = 0; k < prefix; k++) {
+    uint pos = e->order[k];
+    uint8_t dom = initial[pos] & CELL_DOM;
+    uint n = domain_size(dom);
+    uint r = task % n;
+    task /= n;
+    e->frames[k].pos = pos;
+    e->level[pos] = k;
+
+    // r-th orientation of the initial domain, maybe already removed by the previous squares
+    direction d = 0;
+    while (!(dom & directions[d]) || r-- > 0) d++;
+    if (!(e->cells[pos] & directions[d])) return false;
+    if (engine_assign(e, pos, d) != RULE_NONE) return false;
+  }
+  return true;
+}
+
+/* ****************************** PAR WORKER ******************************** */
+static void* par_worker(void* arg) {
+  solver_par* par = (solver_par*)arg;
+  solver_ctx ctx;
+  ctx_init(par->g, &ctx, par->limit, &par->shared);
+  solver_stats local;
+  if (par->stats) {
+    stats_init(&local, ctx.e.size);
+    ctx.stats = &local;
+  }
+
+  // The domains before any task give the task numbering
+  uint8_t* initial = (uint8_t*)malloc(ctx.e.size * sizeof(uint8_t));
+  assert(initial);
+  memcpy(initial, ctx.e.cells, ctx.e.size * sizeof(uint8_t));
+
+  uint task;
+  while ((task = atomic_fetch_add(&par->next, 1)) < par->nb_tasks) {
+    if (atomic_load(&par->shared.stop)) break;
+    engine_undo(&ctx.e, 0);
+    if (set_prefix(&ctx.e, initial, par->prefix, task)) search(&ctx, par->prefix);
+  }
+  atomic_fetch_add(&par->shared.nodes, ctx.nodes);
+  if (par->stats) {
+    pthread_mutex_lock(&par->lock);
+    stats_merge(par->stats, &local);
+    pthread_mutex_unlock(&par->lock);
+    solver_stats_free(&local);
+  }
+
+  free(initial);
+  engine_free(&ctx.e);
+  return NULL;
+}
+
+/* a count which saves its frontier in a checkpoint file (see CHECKPOINTS) */
+static solver_result checkpoint_count(cgame g, const solver_options* opts, uint* count);
+/* a count of one part of the search tree (see PARTITION) */
+static solver_result job_count(cgame g, uint limit, const solver_options* opts, uint* count);
+
+/* **************************** SOLVER COUNT EXT **************************** */
+solver_result solver_count_ext(cgame g, uint limit, const solver_options* opts, uint* count) {
+  assert(g && count);
+  if (opts && opts->nb_jobs > 1) return job_count(g, limit, opts, count);
+  if (opts && opts->checkpoint && limit == 0) return checkpoint_count(g, opts, count);
+  solver_result result;
+  if (!(opts && opts->no_decomposition) && split_count(g, limit, opts, count, &result)) return result;
+  uint nb_threads = (opts && opts->nb_threads > 0) ? opts->nb_threads : solver_nb_threads();
+
+  solver_par par = {.g = g, .limit = limit, .prefix = 0, .nb_tasks = 1};
+  atomic_init(&par.next, 0);
+  shared_init(&par.shared, opts);
+
+  solver_ctx ctx;
+  ctx_init(g, &ctx, limit, &par.shared);
+  par.stats = stats_begin(opts, &ctx.e);
+
+  if (nb_threads <= 1 || ctx.e.size < PARALLEL_MIN_SIZE) {
+    // Sequential search
+    ctx.stats = par.stats;
+    search(&ctx, 0);
+    atomic_fetch_add(&par.shared.nodes, ctx.nodes);
+  } else {
+    // Smallest prefix giving enough tasks to balance the load
+    while (par.prefix < ctx.e.size && par.nb_tasks < TASKS_PER_THREAD * nb_threads)
+      par.nb_tasks *= domain_size(ctx.e.cells[ctx.e.order[par.prefix++]] & CELL_DOM);
+
+    pthread_mutex_init(&par.lock, NULL);
+    pthread_t* threads = (pthread_t*)malloc(nb_threads * sizeof(pthread_t));
+    assert(threads);
+    for (uint t = 0; t < nb_threads; t++) pthread_create(&threads[t], NULL, par_worker, &par);
+    for (uint t = 0; t < nb_threads; t++) pthread_join(threads[t], NULL);
+    free(threads);
+    pthread_mutex_destroy(&par.lock);
+  }
+  stats_end(par.stats);
+  engine_free(&ctx.e);
+
+  *count = atomic_load(&par.shared.nb_sols);
+  if (limit > 0 && *count > limit) *count = limit;
+  if (atomic_load(&par.shared.aborted)) return SOLVER_ABORTED;
+  return *count > 0 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+}
+
+/* ************************************************************************** */
+/*                               WORK STEALING                                */
+/* ************************************************************************** */
+
+/* ******************************** TAKE TASK ******************************* */
+/* take the newest subtree of the thread, or else the oldest one of another thread */
+static bool take_task(solver_steal* steal, uint thread, subtree* t) {
+  for (uint k = 0; k < steal->nb_threads; k++) {
+    task_deque* dq = &steal->deques[(thread + k) % steal->nb_threads];
+    pthread_mutex_lock(&dq->lock);
+    bool found = dq->top < dq->bottom;
+    if (found) *t = (k == 0) ? dq->tasks[--dq->bottom] : dq->tasks[dq->top++];
+    if (dq->top == dq->bottom) dq->top = dq->bottom = 0;
+    pthread_mutex_unlock(&dq->lock);
+    if (found) return true;
+  }
+  return false;
+}
+
+/* ****************************** REPLAY TASK ******************************* */
+/* apply the decisions of a subtree, return false if they are already a conflict */
+static bool replay_task(engine* e, const subtree* t) {
+  engine_undo(e, 0);
+  for (uint k = 0; k < t->len; k++) {
+    // The decisions of a stack are resumed with their orientations left, without learning from them
+    frame* f = &e->frames[k];
+    f->pos = t->pos[k];
+    f->left = t->left ? t->left[k] : 0;
+    f->mark = e->trail_len;
+    f->solved = true;
+    f->conf_all = true;
+    f->conf_len = 0;
+    e->level[t->pos[k]] = k;
+    if (!(e->cells[t->pos[k]] & directions[t->orient[k]])) return false;
+    if (engine_assign(e, t->pos[k], t->orient[k]) != RULE_NONE) return false;
+  }
+  return true;
+}
+
+/* ****************************** SUBTREE FREE ****************************** */
+static void subtree_free(subtree* t) {
+  free(t->pos);
+  free(t->orient);
+  free(t->left);
+}
+
+/* ****************************** STEAL WORKER ****************************** */
+static void* steal_worker(void* arg) {
+  solver_ctx* ctx = (solver_ctx*)arg;
+  solver_steal* steal = ctx->steal;
+  bool hungry = false;
+
+  while (!atomic_load(&steal->shared.stop)) {
+    if (steal->ckpt && atomic_load_explicit(&steal->ckpt->request, memory_order_relaxed)) {
+      park(ctx, 0, NO_SQUARE);
+      continue;
+    }
+    subtree t;
+    if (!take_task(steal, ctx->thread, &t)) {
+      if (atomic_load(&steal->pending) == 0) break;
+      if (!hungry) atomic_fetch_add(&steal->hungry, 1);
+      hungry = true;
+      sched_yield();
+      continue;
+    }
+    if (hungry) atomic_fetch_sub(&steal->hungry, 1);
+    hungry = false;
+
+    if (replay_task(&ctx->e, &t)) {
+      bool worse = false;
+      if (steal->deterministic) {
+        pthread_mutex_lock(&steal->lock);
+        worse = steal->found && lex_compare(&ctx->e, t.len, steal->best) > 0;
+        pthread_mutex_unlock(&steal->lock);
+      }
+      if (!worse) search_from(ctx, t.left ? 0 : t.len, t.len);
+    }
+    subtree_free(&t);
+    atomic_fetch_sub(&steal->pending, 1);
+  }
+  if (hungry) atomic_fetch_sub(&steal->hungry, 1);
+  atomic_fetch_add(&steal->shared.nodes, ctx->nodes);
+  if (steal->ckpt) {
+    pthread_mutex_lock(&steal->ckpt->lock);
+    steal->ckpt->running--;
+    pthread_cond_broadcast(&steal->ckpt->cond);
+    pthread_mutex_unlock(&steal->ckpt->lock);
+  }
+  return NULL;
+}
+
+/* ******************************* STEAL INIT ******************************* */
+/* allocate the deques and the contexts of the threads (each one stops after limit solutions) */
+static void steal_init(solver_steal* steal, uint limit, const solver_options* opts) {
+  uint size = game_nb_rows(steal->g) * game_nb_cols(steal->g);
+  shared_init(&steal->shared, &steal->opts);
+  atomic_init(&steal->pending, 0);
+  atomic_init(&steal->hungry, 0);
+  atomic_init(&steal->best_gen, 0);
+  pthread_mutex_init(&steal->lock, NULL);
+  steal->deques = (task_deque*)calloc(steal->nb_threads, sizeof(task_deque));
+  steal->ctxs = (solver_ctx*)malloc(steal->nb_threads * sizeof(solver_ctx));
+  steal->locals = (solver_stats*)calloc(steal->nb_threads, sizeof(solver_stats));
+  assert(steal->deques && steal->ctxs && steal->locals);
+
+  for (uint t = 0; t < steal->nb_threads; t++) {
+    task_deque* dq = &steal->deques[t];
+    dq->capacity = NB_DIRS;
+    dq->tasks = (subtree*)malloc(dq->capacity * sizeof(subtree));
+    assert(dq->tasks);
+    pthread_mutex_init(&dq->lock, NULL);
+
+    solver_ctx* ctx = &steal->ctxs[t];
+    ctx_init(steal->g, ctx, limit, &steal->shared);
+    ctx->steal = steal;
+    ctx->thread = t;
+    for (uint k = 0; k < t; k++) rng_jump(&ctx->rng);  // independent random choices
+  }
+  steal->stats = stats_begin(opts, &steal->ctxs[0].e);
+  if (steal->stats) {
+    for (uint t = 0; t < steal->nb_threads; t++) {
+      stats_init(&steal->locals[t], size);
+      steal->ctxs[t].stats = &steal->locals[t];
+    }
+  }
+}
+
+/* ******************************* STEAL PUSH ******************************* */
+/* add a subtree to the deque of a thread */
+static void steal_push(solver_steal* steal, uint thread, subtree t) {
+  task_deque* dq = &steal->deques[thread];
+  if (dq->bottom == dq->capacity) {
+    dq->capacity *= 2;
+    dq->tasks = (subtree*)realloc(dq->tasks, dq->capacity * sizeof(subtree));
+    assert(dq->tasks);
+  }
+  dq->tasks[dq->bottom++] = t;
+  atomic_fetch_add(&steal->pending, 1);
+}
+
+/* ******************************* STEAL RUN ******************************** */
+/* search the subtrees of the deques on all the threads, while the calling
+ * thread runs monitor (or just waits for them if NULL) */
+static void steal_run(solver_steal* steal, void (*monitor)(solver_steal*)) {
+  pthread_t* threads = (pthread_t*)malloc(steal->nb_threads * sizeof(pthread_t));
+  assert(threads);
+  for (uint t = 0; t < steal->nb_threads; t++) pthread_create(&threads[t], NULL, steal_worker, &steal->ctxs[t]);
+  if (monitor) monitor(steal);
+  for (uint t = 0; t < steal->nb_threads; t++) pthread_join(threads[t], NULL);
+  free(threads);
+}
+
+/* ******************************* STEAL FREE ******************************* */
+/* merge the statistics of the threads and release the search */
+static void steal_free(solver_steal* steal) {
+  for (uint t = 0; t < steal->nb_threads; t++) {
+    if (steal->stats) {
+      stats_merge(steal->stats, &steal->locals[t]);
+      solver_stats_free(&steal->locals[t]);
+    }
+    task_deque* dq = &steal->deques[t];
+    for (uint k = dq->top; k < dq->bottom; k++) subtree_free(&dq->tasks[k]);
+    free(dq->tasks);
+    pthread_mutex_destroy(&dq->lock);
+    engine_free(&steal->ctxs[t].e);
+  }
+  stats_end(steal->stats);
+  pthread_mutex_destroy(&steal->lock);
+  free(steal->locals);
+  free(steal->ctxs);
+  free(steal->deques);
+}
+
+/* ************************** SOLVER SOLVE PARALLEL ************************* */
+solver_result solver_solve_parallel(game g, const solver_options* opts) {
+  assert(g);
+  solver_steal steal = {.g = g, .opts = opts ? *opts : default_options};
+  steal.opts.restart = SOLVER_RESTART_NONE;
+  steal.deterministic = steal.opts.deterministic;
+  if (steal.deterministic) {
+    // Row-major order and increasing orientations: each subtree meets its solutions in lexicographic order
+    steal.opts.order = SOLVER_ORDER_ROW;
+    steal.opts.randomize = false;
+  }
+  steal.nb_threads = steal.opts.nb_threads > 0 ? steal.opts.nb_threads : solver_nb_threads();
+  uint size = game_nb_rows(g) * game_nb_cols(g);
+  if (!steal.deterministic && (steal.nb_threads <= 1 || size < PARALLEL_MIN_SIZE)) return solver_solve(g, &steal.opts);
+  if (!steal.deterministic && game_won(g)) return SOLVER_SOLVED;
+
+  // Without the deterministic mode, the first solution found stops all the threads
+  steal_init(&steal, 1, opts);
+  steal.best = (direction*)malloc(size * sizeof(direction));
+  assert(steal.best);
+  for (uint t = 0; t < steal.nb_threads; t++) {
+    steal.ctxs[t].sols = g->tab_direction;
+    steal.ctxs[t].nb_stored = steal.deterministic ? 0 : 1;
+  }
+
+  // The whole tree is the first subtree
+  steal_push(&steal, 0, (subtree){0});
+  steal_run(&steal, NULL);
+
+  solver_result result;
+  if (steal.deterministic && steal.found && !atomic_load(&steal.shared.aborted)) {
+    memcpy(g->tab_direction, steal.best, size * sizeof(direction));
+    result = SOLVER_SOLVED;
+  } else if (!steal.deterministic && atomic_load(&steal.shared.nb_sols) > 0) {
+    result = SOLVER_SOLVED;
+  } else {
+    result = atomic_load(&steal.shared.aborted) ? SOLVER_ABORTED : SOLVER_UNSOLVABLE;
+  }
+
+  steal_free(&steal);
+  free(steal.best);
+  return result;
+}
+
+/* ************************************************************************** */
+/*                                CHECKPOINTS                                 */
+/* ************************************************************************** */
+
+/*
+ * A checkpoint file holds the rest of a count, in little-endian:
+ * - bytes 0-15: the header of a solution file (see game_solfile.h) with the
+ *   magic string "NETC", and the order of the squares in byte 6,
+ * - bytes 16-23: the hash of the game (see solver_game_hash),
+ * - bytes 24-31: the solutions counted so far,
+ * - bytes 32-39: the nodes visited so far,
+ * - bytes 40-43: the number of subtrees left,
+ * then each subtree: its number of decisions (the high bit is set for the rest
+ * of a stack), and for each decision its square on 4 bytes, and one byte
+ * holding its orientation (bits 0-1) and the orientations left (bits 2-5).
+ */
+#define CHECKPOINT_HEADER_SIZE 44
+#define CHECKPOINT_STACK 0x80000000u
+/* default number of seconds between two checkpoints */
+#define CHECKPOINT_INTERVAL 5.0
+
+/* ******************************** PUT U32 ********************************* */
+static uint8_t* put_u32(uint8_t* p, uint32_t v) {
+  for (uint k = 0; k < 4; k++) p[k] = (v >> (8 * k)) & 0xFF;
+  return p + 4;
+}
+
+/* ******************************** PUT U64 ********************************* */
+static uint8_t* put_u64(uint8_t* p, uint64_t v) {
+  for (uint k = 0; k < 8; k++) p[k] = (v >> (8 * k)) & 0xFF;
+  return p + 8;
+}
+
+/* ******************************** GET U32 ********************************* */
+static uint32_t get_u32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (uint k = 0; k < 4; k++) v |= (uint32_t)p[k] << (8 * k);
+  return v;
+}
+
+/* ******************************** GET U64 ********************************* */
+static uint64_t get_u64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (uint k = 0; k < 8; k++) v |= (uint64_t)p[k] << (8 * k);
+  return v;
+}
+
+/* ****************************** PUT SUBTREE ******************************* */
+static uint8_t* put_subtree(uint8_t* p, const subtree* t) {
+  p = put_u32(p, t->len | (t->left ? CHECKPOINT_STACK : 0));
+  for (uint k = 0; k < t->len; k++) {
+    p = put_u32(p, t->pos[k]);
+    *p++ = t->orient[k] | (t->left ? t->left[k] << 2 : 0);
+  }
+  return p;
+}
+
+/* **************************** CHECKPOINT SAVE ***************************** */
+/* write the rest of the count while every thread is parked (or ended), the
+ * file is replaced at once by the renaming of a temporary file */
+static bool checkpoint_save(solver_steal* steal) {
+  solver_checkpoint* ckpt = steal->ckpt;
+  uint64_t solutions = ckpt->solutions;
+  uint nb_subtrees = 0;
+  size_t size = CHECKPOINT_HEADER_SIZE;
+  for (uint t = 0; t < steal->nb_threads; t++) {
+    solutions += steal->ctxs[t].found;
+    if (ckpt->busy[t]) {
+      nb_subtrees++;
+      size += 4 + 5 * (size_t)ckpt->frontier[t].len;
+    }
+    task_deque* dq = &steal->deques[t];
+    for (uint k = dq->top; k < dq->bottom; k++) {
+      nb_subtrees++;
+      size += 4 + 5 * (size_t)dq->tasks[k].len;
+    }
+  }
+
+  uint8_t* buffer = (uint8_t*)malloc(size);
+  assert(buffer);
+  uint8_t header[8] = {'N', 'E', 'T', 'C', 1, game_is_wrapping(steal->g), steal->opts.order, 0};
+  memcpy(buffer, header, sizeof(header));
+  uint8_t* p = put_u32(buffer + 8, game_nb_rows(steal->g));
+  p = put_u32(p, game_nb_cols(steal->g));
+  p = put_u64(p, solver_game_hash(steal->g));
+  p = put_u64(p, solutions);
+  p = put_u64(p, ckpt->nodes + atomic_load(&steal->shared.nodes));
+  p = put_u32(p, nb_subtrees);
+  for (uint t = 0; t < steal->nb_threads; t++) {
+    if (ckpt->busy[t]) p = put_subtree(p, &ckpt->frontier[t]);
+    task_deque* dq = &steal->deques[t];
+    for (uint k = dq->top; k < dq->bottom; k++) p = put_subtree(p, &dq->tasks[k]);
+  }
+  assert((size_t)(p - buffer) == size);
+
+  char* tmp = (char*)malloc(strlen(ckpt->file) + 5);
+  assert(tmp);
+  sprintf(tmp, "%s.tmp", ckpt->file);
+  FILE* f = fopen(tmp, "wb");
+  bool ok = f && fwrite(buffer, 1, size, f) == size;
+  ok = f && fflush(f) == 0 && fsync(fileno(f)) == 0 && ok;
+  if (f) ok = fclose(f) == 0 && ok;
+  ok = ok && rename(tmp, ckpt->file) == 0;
+  if (!ok) remove(tmp);
+  free(tmp);
+  free(buffer);
+  return ok;
+}
+
+/* **************************** CHECKPOINT LOAD ***************************** */
+/* read a checkpoint of the game, return false if it cannot be resumed */
+static bool checkpoint_load(cgame g, const char* file, solver_order* order, uint64_t* solutions, uint64_t* nodes,
+                            subtree** subtrees, uint* nb_subtrees) {
+  FILE* f = fopen(file, "rb");
+  if (!f) return false;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t* buffer = size >= CHECKPOINT_HEADER_SIZE ? (uint8_t*)malloc(size) : NULL;
+  bool ok = buffer && fread(buffer, 1, size, f) == (size_t)size;
+  fclose(f);
+
+  uint nb_squares = game_nb_rows(g) * game_nb_cols(g);
+  ok = ok && memcmp(buffer, "NETC", 4) == 0 && buffer[4] == 1 && buffer[5] == game_is_wrapping(g);
+  ok = ok && buffer[6] < NB_ORDERS && get_u32(buffer + 8) == game_nb_rows(g);
+  ok = ok && get_u32(buffer + 12) == game_nb_cols(g) && get_u64(buffer + 16) == solver_game_hash(g);
+  uint nb = ok ? get_u32(buffer + 40) : 0;
+  subtree* t = (subtree*)calloc(nb > 0 ? nb : 1, sizeof(subtree));
+  assert(t);
+
+  // Every subtree is checked before it is replayed
+  const uint8_t* p = ok ? buffer + CHECKPOINT_HEADER_SIZE : NULL;
+  const uint8_t* end = ok ? buffer + size : NULL;
+  for (uint k = 0; ok && k < nb; k++) {
+    ok = end - p >= 4;
+    if (!ok) break;
+    uint32_t len = get_u32(p);
+    p += 4;
+    t[k].len = len & ~CHECKPOINT_STACK;
+    ok = t[k].len <= nb_squares && (size_t)(end - p) >= 5 * (size_t)t[k].len;
+    if (!ok || t[k].len == 0) continue;
+    t[k].pos = (uint*)malloc(t[k].len * sizeof(uint));
+    t[k].orient = (uint8_t*)malloc(t[k].len * sizeof(uint8_t));
+    if (len & CHECKPOINT_STACK) t[k].left = (uint8_t*)malloc(t[k].len * sizeof(uint8_t));
+    assert(t[k].pos && t[k].orient && (t[k].left || !(len & CHECKPOINT_STACK)));
+    for (uint l = 0; l < t[k].len; l++, p += 5) {
+      t[k].pos[l] = get_u32(p);
+      t[k].orient[l] = p[4] & 3;
+      if (t[k].left) t[k].left[l] = (p[4] >> 2) & CELL_DOM;
+      ok = ok && t[k].pos[l] < nb_squares;
+    }
+  }
+  ok = ok && p == end;
+
+  if (ok) {
+    *order = buffer[6];
+    *solutions = get_u64(buffer + 24);
+    *nodes = get_u64(buffer + 32);
+    *subtrees = t;
+    *nb_subtrees = nb;
+  } else {
+    for (uint k = 0; k < nb; k++) subtree_free(&t[k]);
+    free(t);
+  }
+  free(buffer);
+  return ok;
+}
+
+/* **************************** CHECKPOINT LOOP ***************************** */
+/* take a checkpoint at regular intervals until the threads end, and a last one if the count is complete */
+static void checkpoint_loop(solver_steal* steal) {
+  solver_checkpoint* ckpt = steal->ckpt;
+  pthread_mutex_lock(&ckpt->lock);
+  double next = now() + ckpt->interval;
+  while (ckpt->running > 0) {
+    double wait = next - now();
+    if (wait > 0 && !ckpt->last) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      double end = ts.tv_sec + ts.tv_nsec * 1e-9 + wait;
+      ts.tv_sec = (time_t)end;
+      ts.tv_nsec = (long)((end - ts.tv_sec) * 1e9);
+      pthread_cond_timedwait(&ckpt->cond, &ckpt->lock, &ts);
+      continue;
+    }
+
+    // Once all the threads are parked, their stacks and the deques hold all the subtrees left
+    memset(ckpt->busy, 0, steal->nb_threads * sizeof(bool));
+    atomic_store(&ckpt->request, true);
+    while (ckpt->parked < ckpt->running) pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+    if (!atomic_load(&steal->shared.stop) && !checkpoint_save(steal)) {
+      ckpt->failed = true;
+      atomic_store(&steal->shared.stop, true);
+    }
+    if (ckpt->last) {
+      atomic_store(&steal->shared.aborted, true);
+      atomic_store(&steal->shared.stop, true);
+    }
+    atomic_store(&ckpt->request, false);
+    ckpt->parked = 0;
+    ckpt->gen++;
+    pthread_cond_broadcast(&ckpt->cond);
+    next = now() + ckpt->interval;
+  }
+
+  // A stopped count keeps its last checkpoint, a complete one leaves no subtree
+  if (!atomic_load(&steal->shared.stop)) {
+    memset(ckpt->busy, 0, steal->nb_threads * sizeof(bool));
+    if (!checkpoint_save(steal)) ckpt->failed = true;
+  }
+  pthread_mutex_unlock(&ckpt->lock);
+}
+
+/* **************************** CHECKPOINT COUNT **************************** */
+static solver_result checkpoint_count(cgame g, const solver_options* opts, uint* count) {
+  solver_checkpoint ckpt = {.file = opts->checkpoint};
+  ckpt.interval = opts->checkpoint_interval > 0 ? opts->checkpoint_interval : CHECKPOINT_INTERVAL;
+  solver_steal steal = {.g = g, .opts = *opts, .ckpt = &ckpt};
+  steal.opts.restart = SOLVER_RESTART_NONE;
+  steal.nb_threads = steal.opts.nb_threads > 0 ? steal.opts.nb_threads : solver_nb_threads();
+
+  // The subtrees of a checkpoint are resumed in its order of the squares
+  subtree* subtrees = NULL;
+  uint nb_subtrees = 0;
+  bool resumed = opts->resume && checkpoint_load(g, opts->checkpoint, &steal.opts.order, &ckpt.solutions,
+                                                 &ckpt.nodes, &subtrees, &nb_subtrees);
+  steal_init(&steal, 0, opts);
+  for (uint t = 0; t < steal.nb_threads; t++) steal.ctxs[t].local_count = true;
+  if (resumed) {
+    for (uint k = 0; k < nb_subtrees; k++) steal_push(&steal, k % steal.nb_threads, subtrees[k]);
+  } else {
+    steal_push(&steal, 0, (subtree){0});
+  }
+  free(subtrees);
+
+  atomic_init(&ckpt.request, false);
+  ckpt.running = steal.nb_threads;
+  ckpt.frontier = (subtree*)calloc(steal.nb_threads, sizeof(subtree));
+  ckpt.busy = (bool*)calloc(steal.nb_threads, sizeof(bool));
+  assert(ckpt.frontier && ckpt.busy);
+  pthread_mutex_init(&ckpt.lock, NULL);
+  pthread_cond_init(&ckpt.cond, NULL);
+  steal_run(&steal, checkpoint_loop);
+
+  uint64_t total = ckpt.solutions;
+  for (uint t = 0; t < steal.nb_threads; t++) {
+    total += steal.ctxs[t].found;
+    subtree_free(&ckpt.frontier[t]);
+  }
+  pthread_cond_destroy(&ckpt.cond);
+  pthread_mutex_destroy(&ckpt.lock);
+  free(ckpt.busy);
+  free(ckpt.frontier);
+  bool aborted = atomic_load(&steal.shared.aborted);
+  steal_free(&steal);
+
+  *count = total > UINT_MAX ? UINT_MAX : (uint)total;
+  if (ckpt.failed) return SOLVER_ERROR;
+  if (aborted) return SOLVER_ABORTED;
+  return total > 0 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+}
+
+/* *********************** SOLVER CHECKPOINT MATCHES ************************ */
+bool solver_checkpoint_matches(cgame g, const char* file) {
+  assert(g && file);
+  solver_order order;
+  uint64_t solutions, nodes;
+  subtree* subtrees;
+  uint nb_subtrees;
+  if (!checkpoint_load(g, file, &order, &solutions, &nodes, &subtrees, &nb_subtrees)) return false;
+  for (uint k = 0; k < nb_subtrees; k++) subtree_free(&subtrees[k]);
+  free(subtrees);
+  return true;
+}
+
+/* ************************************************************************** */
+/*                                 PARTITION                                  */
+/* ************************************************************************** */
+
+/* minimal number of subtrees per job of a partitioned count */
+#define TASKS_PER_JOB 32
+
+/* ******************************* PARTITION ******************************** */
+/* split the search tree breadth-first until there are at least target
+ * subtrees (or only leaves): the square of each split is the one the search
+ * would choose, so the subtrees which die at once are not split further, and
+ * the ones left are of similar sizes. Return the subtrees in the order they
+ * were made, their number in nb */
+static subtree* partition(engine* e, uint target, uint* nb) {
+  uint capacity = NB_DIRS * target + 1, nb_nodes = 1, nb_live = 1, head = 0;
+  subtree* nodes = (subtree*)calloc(capacity, sizeof(subtree));
+  bool* split = (bool*)calloc(capacity, sizeof(bool));
+  assert(nodes && split);
+
+  for (; nb_live < target && head < nb_nodes; head++) {
+    uint depth = nodes[head].len;
+    if (depth == e->end) continue;  // a leaf stays whole
+    replay_task(e, &nodes[head]);
+    uint pos = engine_select(e, depth), mark = e->trail_len;
+    e->frames[depth].pos = pos;
+    e->level[pos] = depth;
+    split[head] = true;
+    nb_live--;
+
+    for (direction o = 0; o < NB_DIRS; o++) {
+      if (!(e->cells[pos] & directions[o])) continue;
+      if (engine_assign(e, pos, o) == RULE_NONE) {
+        if (nb_nodes == capacity) {
+          capacity *= 2;
+          nodes = (subtree*)realloc(nodes, capacity * sizeof(subtree));
+          split = (bool*)realloc(split, capacity * sizeof(bool));
+          assert(nodes && split);
+        }
+        subtree* child = &nodes[nb_nodes];
+        *child = (subtree){.len = depth + 1};
+        child->pos = (uint*)malloc(child->len * sizeof(uint));
+        child->orient = (uint8_t*)malloc(child->len * sizeof(uint8_t));
+        assert(child->pos && child->orient);
+        for (uint l = 0; l <= depth; l++) {
+          child->pos[l] = e->frames[l].pos;
+          child->orient[l] = CELL_ORIENT(e->cells[e->frames[l].pos]);
+        }
+        split[nb_nodes++] = false;
+        nb_live++;
+      }
+      engine_undo(e, mark);
+    }
+  }
+  engine_undo(e, 0);
+
+  // Keep the subtrees which were not split
+  uint n = 0;
+  for (uint k = 0; k < nb_nodes; k++) {
+    if (split[k])
+      subtree_free(&nodes[k]);
+    else
+      nodes[n++] = nodes[k];
+  }
+  free(split);
+  *nb = n;
+  return nodes;
+}
+
+/* ******************************* JOB COUNT ******************************** */
+static solver_result job_count(cgame g, uint limit, const solver_options* opts, uint* count) {
+  assert(opts->job < opts->nb_jobs);
+  solver_steal steal = {.g = g, .opts = *opts};
+  steal.opts.restart = SOLVER_RESTART_NONE;
+  steal.opts.randomize = false;
+  steal.nb_threads = steal.opts.nb_threads > 0 ? steal.opts.nb_threads : solver_nb_threads();
+  steal_init(&steal, limit, opts);
+
+  // The subtrees are dealt to the jobs in turn: the parts only depend on the game, the order and the
+  // number of jobs (not on the threads), then the threads of the job share its subtrees by work stealing
+  uint nb;
+  subtree* nodes = partition(&steal.ctxs[0].e, TASKS_PER_JOB * opts->nb_jobs, &nb);
+  for (uint k = 0, n = 0; k < nb; k++) {
+    if (k % opts->nb_jobs == opts->job)
+      steal_push(&steal, n++ % steal.nb_threads, nodes[k]);
+    else
+      subtree_free(&nodes[k]);
+  }
+  free(nodes);
+  steal_run(&steal, NULL);
+
+  *count = atomic_load(&steal.shared.nb_sols);
+  if (limit > 0 && *count > limit) *count = limit;
+  bool aborted = atomic_load(&steal.shared.aborted);
+  steal_free(&steal);
+  if (aborted) return SOLVER_ABORTED;
+  return *count > 0 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+}
+
+/* ************************************************************************** */
+/*                                 ESTIMATION                                 */
+/* ************************************************************************** */
+
+/* default number of probes of an estimation */
+#define ESTIMATE_PROBES 1000
+/* nodes of the calibration search, which measures the speed of the search */
+#define ESTIMATE_CALIBRATION 100000
+/* half-width of a 95% confidence interval, in standard errors */
+#define ESTIMATE_Z 1.96
+
+/* **************************** ENGINE CHILDREN ***************************** */
+/* orientations of a free square which are not rejected when it is fixed */
+static uint8_t engine_children(engine* e, uint pos) {
+  uint mark = e->trail_len;
+  uint8_t children = 0;
+  for (direction o = 0; o < NB_DIRS; o++) {
+    if (!(e->cells[pos] & directions[o])) continue;
+    if (engine_assign(e, pos, o) == RULE_NONE) children |= directions[o];
+    engine_undo(e, mark);
+  }
+  return children;
+}
+
+/* ********************************** PICK ********************************** */
+/* one of the orientations of a non-empty domain, at random */
+static direction pick(uint8_t dom, rng* r) {
+  direction o = 0;
+  uint k = rng_bounded(r, dom_size[dom]);
+  while (!(dom & directions[o]) || k-- > 0) o++;
+  return o;
+}
+
+/* ********************************* PROBE ********************************** */
+/* follow a random path from the node at depth base down to a leaf or a dead
+ * end (Knuth): at each depth, the nodes of the tree are estimated by the product
+ * of the numbers of children met so far; add them to nodes, return the
+ * estimated solutions (the cells are restored) */
+static double probe(engine* e, rng* r, uint base, double* nodes) {
+  uint mark = e->trail_len, depth = base;
+  double weight = 1;
+  *nodes += 1;
+  while (depth < e->end) {
+    uint pos = engine_select(e, depth);
+    uint8_t children = engine_children(e, pos);
+    if (!children) break;
+
+    weight *= dom_size[children];
+    *nodes += weight;
+    e->frames[depth].pos = pos;
+    e->level[pos] = depth++;
+    engine_assign(e, pos, pick(children, r));
+  }
+
+  bool solution = depth == e->end && (!e->joined || engine_joined(e));
+  engine_undo(e, mark);
+  return solution ? weight : 0;
+}
+
+/* ******************************* HALF WIDTH ******************************* */
+/* half-width of the confidence interval of a mean, from the sums of n values and of their squares */
+static double half_width(double sum, double sum2, double n) {
+  if (n < 2) return 0;
+  double mean = sum / n;
+  return ESTIMATE_Z * sqrt(fmax(0, sum2 - n * mean * mean) / (n - 1) / n);
+}
+
+/* **************************** SOLVER ESTIMATE ***************************** */
+solver_result solver_estimate_size(cgame g, uint nb_probes, const solver_options* opts, solver_estimate* est) {
+  assert(g && est);
+  if (nb_probes == 0) nb_probes = ESTIMATE_PROBES;
+  *est = (solver_estimate){0};
+
+  // The tree estimated is the one of a plain count: without learning nor random choices
+  solver_options plain = opts ? *opts : default_options;
+  plain.max_nogoods = 0;
+  plain.randomize = false;
+  plain.restart = SOLVER_RESTART_NONE;
+  plain.stats = NULL;
+  solver_shared shared;
+  shared_init(&shared, &plain);
+  solver_ctx ctx;
+  ctx_init(g, &ctx, 0, &shared);
+
+  // Calibration: a short count measures the speed, and gives the exact values of a small tree
+  double start = now();
+  ctx.run_budget = ESTIMATE_CALIBRATION;
+  search(&ctx, 0);
+  double elapsed = now() - start;
+  uint64_t calibration = atomic_load(&shared.nodes) + ctx.nodes;
+  est->nodes_per_second = elapsed > 0 ? calibration / elapsed : 0;
+  if (!ctx.restart && !atomic_load(&shared.aborted)) {
+    est->exact = true;
+    est->nodes = est->nodes_low = est->nodes_high = calibration;
+    est->solutions = est->solutions_low = est->solutions_high = atomic_load(&shared.nb_sols);
+    est->seconds = elapsed;
+    engine_free(&ctx.e);
+    return SOLVER_SOLVED;
+  }
+  engine_undo(&ctx.e, 0);
+  ctx.run_budget = 0;
+
+  // Probes: mean and variance of the estimates of each probe
+  rng r;
+  rng_seed(&r, plain.seed);
+  double sum_nodes = 0, sum_nodes2 = 0, sum_sols = 0, sum_sols2 = 0;
+  bool found = false;
+  while (est->probes < nb_probes && !atomic_load(&shared.aborted)) {
+    double nodes = 0, sols = probe(&ctx.e, &r, 0, &nodes);
+    est->probes++;
+    sum_nodes += nodes;
+    sum_nodes2 += nodes * nodes;
+    sum_sols += sols;
+    sum_sols2 += sols * sols;
+    found = found || sols > 0;
+    ctx.nodes += ctx.e.size;
+    if (ctx.nodes >= CHECK_INTERVAL) check_limits(&ctx);
+  }
+  engine_free(&ctx.e);
+  if (est->probes == 0) return SOLVER_ABORTED;
+
+  double n = est->probes;
+  est->nodes = sum_nodes / n;
+  est->solutions = sum_sols / n;
+  double err_nodes = half_width(sum_nodes, sum_nodes2, n), err_sols = half_width(sum_sols, sum_sols2, n);
+  // The calibration visited some nodes, and a probe which found a solution proves there is one
+  est->nodes_low = fmax(est->nodes - err_nodes, calibration);
+  est->nodes_high = fmax(est->nodes + err_nodes, calibration);
+  est->nodes = fmax(est->nodes, calibration);
+  est->solutions_low = fmax(est->solutions - err_sols, found ? 1 : 0);
+  est->solutions_high = fmax(est->solutions + err_sols, found ? 1 : 0);
+  est->seconds = est->nodes_per_second > 0 ? est->nodes / est->nodes_per_second : 0;
+  return atomic_load(&shared.aborted) ? SOLVER_ABORTED : SOLVER_SOLVED;
+}
+
+/* ************************************************************************** */
+/*                                  SAMPLING                                  */
+/* ************************************************************************** */
+
+/* nodes of the exact count of a subtree, before the approximate sampler estimates it instead */
+#define SAMPLE_EXACT_NODES 20000
+/* probes of the estimation of a subtree by the approximate sampler */
+#define SAMPLE_PROBES 64
+/* maximal number of branching nodes kept by a sampler */
+#define SAMPLE_MAX_NODES (1u << 20)
+/* maximal size of the solutions kept by a sampler, in bytes */
+#define SAMPLE_MAX_LEAVES (1u << 26)
+/* the approximate sampler starts over after a dead end, at most this number of times per sample */
+#define SAMPLE_RETRIES 100
+#define NO_NODE UINT32_MAX
+/* a link toward a single solution (the index of a leaf) instead of a branching node */
+#define LEAF_LINK 0x80000000u
+
+/**
+ * @brief A node of the search tree where a sampler had to choose between
+ * several orientations of a square. The weights only depend on the choices
+ * made above the node: the forced orientations met on the way are implied by
+ * them, whatever the order in which they were fixed.
+ */
+typedef struct {
+  uint pos;                // the square
+  uint8_t children;        // its orientations which were not rejected
+  double weight[NB_DIRS];  // number of solutions below each orientation, or its estimate (0 if rejected)
+  uint child[NB_DIRS];     // next branching node below each orientation, LEAF_LINK | leaf, or NO_NODE
+} sample_node;
+
+/**
+ * @brief A sampler keeps the branching nodes already met, and the solutions
+ * found below the last ones: the next samples only count the subtrees which
+ * were not counted yet, and a path ending on a known solution needs no search.
+ */
+struct solver_sampler_s {
+  solver_options opts;   // limits of each sample
+  solver_shared shared;  // counters of the current sample
+  solver_ctx ctx;        // the search, at the root between two samples
+  bool approximate;      // estimate the large subtrees instead of counting them
+  uint first;            // link toward the first branching node of every path
+  sample_node* nodes;    // the branching nodes met so far
+  uint nb_nodes;         // number of nodes
+  uint capacity;         // allocated size of nodes
+  uint8_t* leaves;       // the solutions known, packed as for solver_enumerate
+  uint nb_leaves;        // number of solutions
+  uint leaves_capacity;  // allocated number of solutions in leaves
+  direction* choices;    // orientations drawn at the known branching nodes, replayed by the search
+};
+
+/* ****************************** SAMPLER NEW ******************************* */
+solver_sampler* solver_sampler_new(cgame g, bool approximate, const solver_options* opts) {
+  assert(g);
+  solver_sampler* s = (solver_sampler*)calloc(1, sizeof(solver_sampler));
+  assert(s);
+  // The weights are counts of a plain search: without learning nor random choices
+  s->opts = opts ? *opts : default_options;
+  s->opts.max_nogoods = 0;
+  s->opts.randomize = false;
+  s->opts.restart = SOLVER_RESTART_NONE;
+  s->opts.stats = NULL;
+  shared_init(&s->shared, &s->opts);
+  ctx_init(g, &s->ctx, 0, &s->shared);
+  s->ctx.local_count = true;
+  s->approximate = approximate;
+  s->first = NO_NODE;
+  s->choices = (direction*)malloc(s->ctx.e.size * sizeof(direction));
+  assert(s->choices);
+  return s;
+}
+
+/* ***************************** SAMPLER DELETE ***************************** */
+void solver_sampler_delete(solver_sampler* s) {
+  if (!s) return;
+  engine_free(&s->ctx.e);
+  free(s->nodes);
+  free(s->leaves);
+  free(s->choices);
+  free(s);
+}
+
+/* ****************************** SAMPLE LINK ******************************* */
+/* the link below an orientation of a branching node (the first link for NO_NODE) */
+static uint* sample_link(solver_sampler* s, uint parent, direction via) {
+  return parent == NO_NODE ? &s->first : &s->nodes[parent].child[via];
+}
+
+/* ****************************** SAMPLE COUNT ****************************** */
+/* number of solutions below the node at depth base: counted, or estimated by
+ * probes if the approximate count needs too many nodes (the cells are restored) */
+static double sample_count(solver_sampler* s, uint base, rng* r) {
+  solver_ctx* ctx = &s->ctx;
+  uint mark = ctx->e.trail_len;
+  ctx->found = 0;
+  ctx->run_nodes = 0;
+  ctx->run_budget = s->approximate ? SAMPLE_EXACT_NODES : 0;
+  ctx->restart = false;
+  search(ctx, base);
+  engine_undo(&ctx->e, mark);
+  if (!ctx->restart) return (double)ctx->found;
+
+  double nodes = 0, sols = 0;
+  for (uint k = 0; k < SAMPLE_PROBES; k++) sols += probe(&ctx->e, r, base, &nodes);
+  return sols / SAMPLE_PROBES;
+}
+
+/* ******************************* SAMPLE NODE ****************************** */
+/* weigh the orientations of a square chosen at a depth, return false if the search was aborted;
+ * with the exact number of solutions of the node (total >= 0), the last orientation is not counted */
+static bool sample_node_init(solver_sampler* s, sample_node* node, uint depth, uint8_t children, double total, rng* r) {
+  engine* e = &s->ctx.e;
+  uint mark = e->trail_len;
+  direction last = NB_DIRS;  // the orientation deduced from the total (NB_DIRS for none)
+  if (!s->approximate && total >= 0)
+    for (direction o = 0; o < NB_DIRS; o++)
+      if (children & directions[o]) last = o;
+  node->children = children;
+  for (direction o = 0; o < NB_DIRS; o++) {
+    node->weight[o] = 0;
+    node->child[o] = NO_NODE;
+    if (!(children & directions[o])) continue;
+    if (o == last) {
+      node->weight[o] = total;
+      continue;
+    }
+    engine_assign(e, node->pos, o);
+    node->weight[o] = sample_count(s, depth + 1, r);
+    engine_undo(e, mark);
+    total -= node->weight[o];
+    if (atomic_load(&s->shared.aborted)) return false;
+  }
+  return true;
+}
+
+/* ****************************** SAMPLE CHOOSE ***************************** */
+/* an orientation drawn with a probability proportional to its weight (uniformly if they are all 0) */
+static direction sample_choose(const sample_node* node, rng* r) {
+  double total = 0;
+  for (direction o = 0; o < NB_DIRS; o++) total += node->weight[o];
+  if (total == 0) return pick(node->children, r);
+  double x = rng_double(r) * total;
+  direction last = 0;
+  for (direction o = 0; o < NB_DIRS; o++) {
+    if (node->weight[o] == 0) continue;
+    if (x < node->weight[o]) return o;
+    x -= node->weight[o];
+    last = o;
+  }
+  return last;  // rounding errors
+}
+
+/* ****************************** SAMPLE STORE ****************************** */
+/* keep the solution held by the cells as the only one below a link */
+static void sample_store(solver_sampler* s, uint* link) {
+  engine* e = &s->ctx.e;
+  uint bytes = (e->size + 3) / 4;
+  if ((uint64_t)(s->nb_leaves + 1) * bytes > SAMPLE_MAX_LEAVES) return;
+  if (s->nb_leaves == s->leaves_capacity) {
+    s->leaves_capacity = s->leaves_capacity > 0 ? 2 * s->leaves_capacity : 64;
+    s->leaves = (uint8_t*)realloc(s->leaves, (size_t)s->leaves_capacity * bytes);
+    assert(s->leaves);
+  }
+  pack_solution(e, s->leaves + (size_t)s->nb_leaves * bytes);
+  *link = LEAF_LINK | s->nb_leaves++;
+}
+
+/* ****************************** SAMPLE WALK ******************************* */
+/* go down from the root: the forced orientations are taken, the others are drawn
+ * by their weights (the first nb_choices ones are replayed); return the result
+ * of the walk, the cells hold the solution when it is SOLVER_SOLVED */
+static solver_result sample_walk(solver_sampler* s, rng* r, uint nb_choices) {
+  engine* e = &s->ctx.e;
+  uint depth = 0, parent = NO_NODE, replayed = 0;
+  direction via = 0;
+  double total = -1;  // number of solutions below the last choice (unknown at the root)
+  bool branched = false, cached = true, unique = false;
+  while (depth < e->end && !unique) {
+    // The square of a known branching node is taken again, even if the order would choose another one
+    uint id = cached ? *sample_link(s, parent, via) : NO_NODE;
+    assert(id == NO_NODE || !(id & LEAF_LINK));
+    uint pos = id != NO_NODE ? s->nodes[id].pos : engine_select(e, depth);
+    if (e->cells[pos] & CELL_FIXED) {
+      // Forced since the node was met: its orientation is the only one with solutions
+      if (replayed < nb_choices) replayed++;
+      parent = id;
+      via = CELL_ORIENT(e->cells[pos]);
+      total = s->nodes[id].weight[via];
+      continue;
+    }
+    uint8_t children = engine_children(e, pos);
+    if (!children) break;
+    e->frames[depth].pos = pos;
+    e->level[pos] = depth;
+
+    direction o = 0;
+    if (id == NO_NODE && dom_size[children] == 1) {
+      while (!(children & directions[o])) o++;
+    } else {
+      // Weigh the orientations once, the following samples reuse them
+      sample_node local = {.pos = pos}, *node = &local;
+      if (id != NO_NODE) {
+        node = &s->nodes[id];
+      } else {
+        if (!sample_node_init(s, &local, depth, children, total, r)) return SOLVER_ABORTED;
+        if (cached && s->nb_nodes < SAMPLE_MAX_NODES) {
+          if (s->nb_nodes == s->capacity) {
+            s->capacity = s->capacity > 0 ? 2 * s->capacity : 64;
+            s->nodes = (sample_node*)realloc(s->nodes, s->capacity * sizeof(sample_node));
+            assert(s->nodes);
+          }
+          id = s->nb_nodes++;
+          s->nodes[id] = local;
+          *sample_link(s, parent, via) = id;
+          node = &s->nodes[id];
+        }
+        cached = id != NO_NODE;
+      }
+      bool none = true;
+      for (direction k = 0; k < NB_DIRS; k++) none = none && node->weight[k] == 0;
+      if (none && !s->approximate) return SOLVER_UNSOLVABLE;  // the choices above were forced
+      o = replayed < nb_choices ? s->choices[replayed++] : sample_choose(node, r);
+      if (!(children & directions[o])) return SOLVER_ABORTED;  // drawn among all the orientations (approximate)
+      unique = !s->approximate && node->weight[o] == 1;
+      total = node->weight[o];
+      branched = true;
+      parent = id;
+      via = o;
+    }
+    engine_assign(e, pos, o);
+    depth++;
+  }
+
+  // A single solution is left below: find it
+  if (unique) {
+    s->ctx.limit = 1;
+    s->ctx.found = 0;
+    s->ctx.run_budget = 0;
+    search(&s->ctx, depth);
+    s->ctx.limit = 0;
+    if (s->ctx.found == 0) return SOLVER_ABORTED;
+    depth = e->end;
+  }
+
+  if (depth == e->end) {
+    if (cached) sample_store(s, sample_link(s, parent, via));
+    return SOLVER_SOLVED;
+  }
+  if (!branched) return SOLVER_UNSOLVABLE;
+  // A dead end of the approximate mode: it was forced after the last branching node, which has no solution there
+  if (cached && parent != NO_NODE) s->nodes[parent].weight[via] = 0;
+  return SOLVER_ABORTED;
+}
+
+/* ***************************** SOLVER SAMPLE ****************************** */
+solver_result solver_sample(solver_sampler* s, rng* r, direction* sol) {
+  assert(s && r && sol);
+  shared_init(&s->shared, &s->opts);
+  engine* e = &s->ctx.e;
+  uint bytes = (e->size + 3) / 4;
+
+  for (uint attempt = 0; attempt < SAMPLE_RETRIES; attempt++) {
+    // Draw the path among the known branching nodes first
+    uint nb_choices = 0, link = s->first;
+    while (link != NO_NODE && !(link & LEAF_LINK)) {
+      direction o = sample_choose(&s->nodes[link], r);
+      s->choices[nb_choices++] = o;
+      link = s->nodes[link].child[o];
+    }
+    if (link != NO_NODE) {
+      // It ends on a known solution
+      const uint8_t* packed = s->leaves + (size_t)(link & ~LEAF_LINK) * bytes;
+      for (uint pos = 0; pos < e->size; pos++) sol[pos] = (packed[pos / 4] >> (2 * (pos % 4))) & 3;
+      return SOLVER_SOLVED;
+    }
+
+    // Otherwise search below it, with the same choices
+    solver_result result = sample_walk(s, r, nb_choices);
+    if (result == SOLVER_SOLVED)
+      for (uint pos = 0; pos < e->size; pos++) sol[pos] = CELL_ORIENT(e->cells[pos]);
+    engine_undo(e, 0);
+    if (result != SOLVER_ABORTED || atomic_load(&s->shared.aborted)) return result;
+  }
+  return SOLVER_ABORTED;
+}
+
+/* ************************************************************************** */
+/*                                LOCAL SEARCH                                */
+/* ************************************************************************** */
+
+/* minimal number of replicas of the parallel tempering */
+#define ANNEAL_MIN_REPLICAS 4
+/* temperatures of the coldest and of the hottest replica */
+#define ANNEAL_T_MIN 0.15
+#define ANNEAL_T_MAX 1.5
+/* minimal number of moves of a replica between two exchanges */
+#define ANNEAL_MIN_ROUND 256
+/* rounds without a better state before every replica restarts from the best one */
+#define ANNEAL_STALL 200
+/* out of ANNEAL_FOCUS moves, all but one turn a square with a mismatched edge (if any) */
+#define ANNEAL_FOCUS 4
+/* repairs tried at the end of a round, and their moves */
+#define ANNEAL_REPAIRS 8
+#define ANNEAL_REPAIR_MOVES 4096
+/* largest change of the number of mismatched edges made by one move */
+#define ANNEAL_MAX_DELTA 4
+
+/**
+ * @brief A local search over the orientations, by parallel tempering. The
+ * squares fixed by propagation are frozen. Each replica turns the free squares
+ * at the temperature of its slot (Metropolis rule on the number of mismatched
+ * edges, updated at each move from the 4 edges of the square), mostly squares
+ * which have a mismatched edge. After each round, the replicas of neighbouring
+ * slots may exchange their temperatures. The cost of a state is its number of
+ * mismatched edges plus its number of components of pieces minus one: it is 0
+ * exactly for a solution. It is measured at the end of each round. A state
+ * without mismatch but with several (closed) components is then repaired:
+ * two neighbour squares of different components are turned to link them, and
+ * the mismatches this makes are chased by cold moves; the repair is undone
+ * unless the cost goes down.
+ */
+typedef struct {
+  uint8_t* orient;  // orientation of each square
+  uint* bad_list;   // free squares (indices in free) with a mismatched edge
+  uint* bad_at;     // place of each free square in bad_list (NO_SQUARE if absent)
+  uint nb_bad;      // number of squares in bad_list
+  uint mismatches;  // number of mismatched edges
+  uint slot;        // temperature slot of the replica
+  uint64_t turns;   // moves accepted in the current round
+  rng rng;          // random choices of the replica
+} anneal_replica;
+
+/**
+ * @brief Memory used by one thread to measure the cost of its replicas.
+ */
+typedef struct {
+  struct solver_tempering_s* a;  // the search
+  uint index;                 // index of the thread
+  uint* parent;               // union-find of the pieces
+  uint* csize;                // size of the components (at their root)
+  trail_entry* log;           // squares turned by the current repair, with their previous orientation
+  uint nb_log;                // number of squares in log
+} anneal_thread;
+
+/**
+ * @brief A local search by parallel tempering.
+ */
+typedef struct solver_tempering_s {
+  engine e;                                  // the board after propagation (read only during the search)
+  uint nb_free;                              // number of free squares
+  uint* free;                                // the free squares
+  uint* free_at;                             // index of each square in free (NO_SQUARE if frozen)
+  uint* base_parent;                         // union-find of the frozen pieces
+  uint* base_size;                           // size of their components (at their root)
+  uint base_components;                      // components of the pieces when the free squares are isolated
+  uint nb_replicas;                          // number of replicas (and of temperature slots)
+  uint nb_threads;                           // number of threads
+  uint64_t round;                            // moves of a replica in a round
+  anneal_replica* replicas;                  // the replicas
+  uint* at_slot;                             // replica at each temperature slot
+  double* temps;                             // temperature of each slot
+  uint64_t (*accept)[ANNEAL_MAX_DELTA + 1];  // threshold of rng_next to accept a worse move, at each slot
+  uint8_t* best;                             // best state found
+  uint best_cost;                            // its cost
+  uint best_gen;                             // incremented when best changes
+  uint seen_gen;                             // best_gen at the last exchange
+  uint stall;                                // rounds without a better state
+  uint nb_rounds;                            // rounds run
+  bool done;                                 // the search must end
+  rng rng;                                   // random choices of the exchanges
+  solver_shared shared;                      // limits of the search
+  solver_ctx ctx;                            // moves of the round, to check the limits
+  solver_stats* stats;                       // statistics of the search (or NULL)
+  uint arrived;                              // threads at the end of the round
+  uint gen;                                  // rounds ended, the threads wait for the next one
+  pthread_mutex_t lock;                      // protects best, best_cost, best_gen, arrived and gen
+  pthread_cond_t cond;                       // signaled at the end of each round
+} solver_tempering;
+
+/* ****************************** ANNEAL HALF ******************************* */
+/* does the piece of a square have a half-edge in a direction, in a state */
+static inline bool anneal_half(const engine* e, const uint8_t* orient, uint pos, direction d) {
+  return e->half_edges[e->shapes[pos]][orient[pos]] & directions[d];
+}
+
+/* ***************************** ANNEAL DELTA ******************************* */
+/* change of the number of mismatched edges when a square is turned to o */
+static inline int anneal_delta(const engine* e, const uint8_t* orient, uint pos, direction o) {
+  uint8_t before = e->half_edges[e->shapes[pos]][orient[pos]], after = e->half_edges[e->shapes[pos]][o];
+  int delta = 0;
+  for (direction d = 0; d < NB_DIRS; d++) {
+    uint next = e->neighbours[NB_DIRS * pos + d];
+    bool was = before & directions[d], is = after & directions[d];
+    if (next == pos) {
+      // An edge of the square with itself (wrapping board of width or height 1), seen from both sides
+      delta += (is != ((after & directions[OPPOSITE(d)]) != 0)) - (was != ((before & directions[OPPOSITE(d)]) != 0));
+    } else {
+      bool other = next != NO_SQUARE && anneal_half(e, orient, next, OPPOSITE(d));
+      delta += 2 * ((is != other) - (was != other));
+    }
+  }
+  return delta / 2;
+}
+
+/* ****************************** ANNEAL MARK ******************************* */
+/* put a free square in the list of the squares with a mismatched edge, or remove it */
+static inline void anneal_mark(const solver_tempering* a, anneal_replica* r, uint pos) {
+  uint idx = a->free_at[pos];
+  if (idx == NO_SQUARE) return;
+  bool bad = false;
+  for (direction d = 0; d < NB_DIRS && !bad; d++) {
+    uint next = a->e.neighbours[NB_DIRS * pos + d];
+    bool other = next != NO_SQUARE && anneal_half(&a->e, r->orient, next, OPPOSITE(d));
+    bad = anneal_half(&a->e, r->orient, pos, d) != other;
+  }
+  if (bad && r->bad_at[idx] == NO_SQUARE) {
+    r->bad_at[idx] = r->nb_bad;
+    r->bad_list[r->nb_bad++] = idx;
+  } else if (!bad && r->bad_at[idx] != NO_SQUARE) {
+    uint last = r->bad_list[--r->nb_bad];
+    r->bad_list[r->bad_at[idx]] = last;
+    r->bad_at[last] = r->bad_at[idx];
+    r->bad_at[idx] = NO_SQUARE;
+  }
+}
+
+/* ****************************** ANNEAL TURN ******************************* */
+static inline void anneal_turn(const solver_tempering* a, anneal_replica* r, uint pos, direction o, int delta) {
+  r->orient[pos] = o;
+  r->mismatches += delta;
+  anneal_mark(a, r, pos);
+  for (direction d = 0; d < NB_DIRS; d++)
+    if (a->e.neighbours[NB_DIRS * pos + d] != NO_SQUARE) anneal_mark(a, r, a->e.neighbours[NB_DIRS * pos + d]);
+}
+
+/* ****************************** ANNEAL RESET ****************************** */
+/* set a replica to a state */
+static void anneal_reset(const solver_tempering* a, anneal_replica* r, const uint8_t* state) {
+  const engine* e = &a->e;
+  memcpy(r->orient, state, e->size);
+  // Each edge is seen from both sides (the border from one side, counted twice)
+  uint twice = 0;
+  for (uint pos = 0; pos < e->size; pos++) {
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint next = e->neighbours[NB_DIRS * pos + d];
+      bool other = next != NO_SQUARE && anneal_half(e, r->orient, next, OPPOSITE(d));
+      if (anneal_half(e, r->orient, pos, d) != other) twice += next == NO_SQUARE ? 2 : 1;
+    }
+  }
+  r->mismatches = twice / 2;
+  r->nb_bad = 0;
+  for (uint idx = 0; idx < a->nb_free; idx++) r->bad_at[idx] = NO_SQUARE;
+  for (uint idx = 0; idx < a->nb_free; idx++) anneal_mark(a, r, a->free[idx]);
+}
+
+/* ******************************* ANNEAL FIND ****************************** */
+static inline uint anneal_find(uint* parent, uint pos) {
+  while (parent[pos] != pos) pos = parent[pos] = parent[parent[pos]];
+  return pos;
+}
+
+/* ***************************** ANNEAL MEASURE ***************************** */
+/* cost of the state of a replica (the components are left in the union-find of the thread) */
+static uint anneal_measure(anneal_thread* t, const anneal_replica* r) {
+  const solver_tempering* a = t->a;
+  const engine* e = &a->e;
+  memcpy(t->parent, a->base_parent, e->size * sizeof(uint));
+  memcpy(t->csize, a->base_size, e->size * sizeof(uint));
+
+  // Link the free squares to their matched neighbours
+  uint components = a->base_components;
+  for (uint idx = 0; idx < a->nb_free; idx++) {
+    uint pos = a->free[idx];
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint next = e->neighbours[NB_DIRS * pos + d];
+      if (next == NO_SQUARE || !anneal_half(e, r->orient, pos, d) || !anneal_half(e, r->orient, next, OPPOSITE(d)))
+        continue;
+      uint root = anneal_find(t->parent, pos), other = anneal_find(t->parent, next);
+      if (root == other) continue;
+      if (t->csize[root] < t->csize[other]) {
+        uint tmp = root;
+        root = other;
+        other = tmp;
+      }
+      t->parent[other] = root;
+      t->csize[root] += t->csize[other];
+      components--;
+    }
+  }
+  return r->mismatches + (e->nb_pieces > 0 ? components - 1 : 0);
+}
+
+/* ***************************** ANNEAL LOGGED ****************************** */
+/* turn a square during a repair, so that the repair can be undone */
+static inline void anneal_logged(anneal_thread* t, anneal_replica* r, uint pos, direction o) {
+  t->log[t->nb_log++] = (trail_entry){.pos = pos, .old = r->orient[pos]};
+  anneal_turn(t->a, r, pos, o, anneal_delta(&t->a->e, r->orient, pos, o));
+}
+
+/* ***************************** ANNEAL REPAIR ****************************** */
+/* after anneal_measure of a state without mismatch but with several (closed)
+ * components: link two neighbour squares of different components, then remove
+ * the mismatches made around them by the moves of the coldest slot (the two
+ * squares stay); keep the result if its cost is lower, else undo it */
+static bool anneal_repair(anneal_thread* t, anneal_replica* r, uint* cost) {
+  solver_tempering* a = t->a;
+  const engine* e = &a->e;
+  uint from = NO_SQUARE, nb_pairs = 0;
+  direction via = 0;
+  for (uint idx = 0; idx < a->nb_free; idx++) {
+    uint pos = a->free[idx];
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint next = e->neighbours[NB_DIRS * pos + d];
+      if (next == NO_SQUARE || a->free_at[next] == NO_SQUARE) continue;
+      if (!(e->cells[pos] & e->compat[e->shapes[pos]][d][1])) continue;
+      if (!(e->cells[next] & e->compat[e->shapes[next]][OPPOSITE(d)][1])) continue;
+      if (anneal_find(t->parent, pos) == anneal_find(t->parent, next)) continue;
+      if (rng_bounded(&r->rng, ++nb_pairs) == 0) {
+        from = pos;
+        via = d;
+      }
+    }
+  }
+  if (from == NO_SQUARE) return false;
+
+  uint to = e->neighbours[NB_DIRS * from + via];
+  t->nb_log = 0;
+  anneal_logged(t, r, from, pick(e->cells[from] & e->compat[e->shapes[from]][via][1] & CELL_DOM, &r->rng));
+  anneal_logged(t, r, to, pick(e->cells[to] & e->compat[e->shapes[to]][OPPOSITE(via)][1] & CELL_DOM, &r->rng));
+  const uint64_t* accept = a->accept[0];
+  for (uint m = 0; m < ANNEAL_REPAIR_MOVES && r->nb_bad > 0; m++) {
+    uint pos = a->free[r->bad_list[rng_bounded(&r->rng, r->nb_bad)]];
+    if (pos == from || pos == to) continue;
+    direction o = pick((e->cells[pos] & CELL_DOM) & ~directions[r->orient[pos]], &r->rng);
+    int delta = anneal_delta(e, r->orient, pos, o);
+    if (delta > 0 && rng_next(&r->rng) >= accept[delta]) continue;
+    anneal_logged(t, r, pos, o);
+  }
+
+  uint repaired = anneal_measure(t, r);
+  if (repaired < *cost) {
+    *cost = repaired;
+    return true;
+  }
+  while (t->nb_log > 0) {
+    trail_entry undo = t->log[--t->nb_log];
+    anneal_turn(a, r, undo.pos, undo.old, anneal_delta(e, r->orient, undo.pos, undo.old));
+  }
+  return false;
+}
+
+/* ****************************** ANNEAL ROUND ****************************** */
+/* the moves of a replica during a round, then its cost (and the best state) */
+static void anneal_round(anneal_thread* t, anneal_replica* r) {
+  solver_tempering* a = t->a;
+  const engine* e = &a->e;
+  const uint64_t* accept = a->accept[r->slot];
+  r->turns = 0;
+  for (uint64_t m = 0; m < a->round; m++) {
+    uint idx = (r->nb_bad > 0 && rng_bounded(&r->rng, ANNEAL_FOCUS) > 0) ? r->bad_list[rng_bounded(&r->rng, r->nb_bad)]
+                                                                           : rng_bounded(&r->rng, a->nb_free);
+    uint pos = a->free[idx];
+    direction o = pick((e->cells[pos] & CELL_DOM) & ~directions[r->orient[pos]], &r->rng);
+    int delta = anneal_delta(e, r->orient, pos, o);
+    if (delta > 0 && rng_next(&r->rng) >= accept[delta]) continue;
+    anneal_turn(a, r, pos, o, delta);
+    r->turns++;
+  }
+
+  // A state without mismatch is linked to its neighbour components
+  uint cost = anneal_measure(t, r);
+  for (uint k = 0; k < ANNEAL_REPAIRS && r->mismatches == 0 && cost > 0; k++)
+    if (!anneal_repair(t, r, &cost)) cost = anneal_measure(t, r);
+  pthread_mutex_lock(&a->lock);
+  if (cost < a->best_cost) {
+    memcpy(a->best, r->orient, e->size);
+    a->best_cost = cost;
+    a->best_gen++;
+  }
+  pthread_mutex_unlock(&a->lock);
+}
+
+/* **************************** ANNEAL EXCHANGE ***************************** */
+/* end of a round, by the last thread (the others wait): exchanges of
+ * temperatures, restarts and limits */
+static void anneal_exchange(solver_tempering* a) {
+  // The pairs of neighbouring slots alternate from one round to the next
+  a->nb_rounds++;
+  for (uint k = a->nb_rounds % 2; k + 1 < a->nb_replicas; k += 2) {
+    anneal_replica* cold = &a->replicas[a->at_slot[k]];
+    anneal_replica* hot = &a->replicas[a->at_slot[k + 1]];
+    double p = exp((1 / a->temps[k] - 1 / a->temps[k + 1]) * ((double)cold->mismatches - (double)hot->mismatches));
+    if (p >= 1 || rng_double(&a->rng) < p) {
+      a->at_slot[k] = hot - a->replicas;
+      a->at_slot[k + 1] = cold - a->replicas;
+      cold->slot = k + 1;
+      hot->slot = k;
+    }
+  }
+
+  uint64_t turns = 0;
+  for (uint k = 0; k < a->nb_replicas; k++) turns += a->replicas[k].turns;
+  if (a->stats) {
+    a->stats->nodes += a->nb_replicas * a->round;
+    a->stats->tries += turns;
+  }
+
+  // Without progress for a while, every replica starts again from the best state
+  if (a->best_gen != a->seen_gen) {
+    a->seen_gen = a->best_gen;
+    a->stall = 0;
+  } else if (++a->stall >= ANNEAL_STALL) {
+    a->stall = 0;
+    for (uint k = 0; k < a->nb_replicas; k++) anneal_reset(a, &a->replicas[k], a->best);
+    if (a->stats) a->stats->restarts++;
+  }
+
+  a->ctx.nodes = a->nb_replicas * a->round;
+  a->done = a->best_cost == 0 || check_limits(&a->ctx);
+}
+
+/* ***************************** ANNEAL WORKER ****************************** */
+static void* anneal_worker(void* arg) {
+  anneal_thread* t = (anneal_thread*)arg;
+  solver_tempering* a = t->a;
+  while (true) {
+    for (uint k = t->index; k < a->nb_replicas; k += a->nb_threads) anneal_round(t, &a->replicas[k]);
+
+    // The last thread to end the round ends it for all
+    pthread_mutex_lock(&a->lock);
+    uint gen = a->gen;
+    if (++a->arrived == a->nb_threads) {
+      anneal_exchange(a);
+      a->arrived = 0;
+      a->gen++;
+      pthread_cond_broadcast(&a->cond);
+    } else {
+      while (gen == a->gen) pthread_cond_wait(&a->cond, &a->lock);
+    }
+    bool done = a->done;
+    pthread_mutex_unlock(&a->lock);
+    if (done) return NULL;
+  }
+}
+
+/* ****************************** ANNEAL START ****************************** */
+/* the orientation of each square the search starts from: the one of the game
+ * for a free square, or an equivalent one in its domain */
+static void anneal_start(solver_tempering* a, cgame g, uint8_t* state) {
+  engine* e = &a->e;
+  for (uint pos = 0; pos < e->size; pos++) {
+    uint8_t cell = e->cells[pos];
+    a->free_at[pos] = NO_SQUARE;
+    if (cell & CELL_FIXED) {
+      state[pos] = CELL_ORIENT(cell);
+      continue;
+    }
+    a->free_at[pos] = a->nb_free;
+    a->free[a->nb_free++] = pos;
+    direction o = game_get_piece_orientation(g, pos / game_nb_cols(g), pos % game_nb_cols(g));
+    uint8_t same = 0;
+    for (direction other = 0; other < NB_DIRS; other++)
+      if (e->half_edges[e->shapes[pos]][other] == e->half_edges[e->shapes[pos]][o]) same |= directions[other];
+    state[pos] = pick((cell & CELL_DOM & same) ? (cell & CELL_DOM & same) : (cell & CELL_DOM), &a->rng);
+  }
+
+  // The components of the frozen pieces, flattened
+  a->base_components = 0;
+  for (uint pos = 0; pos < e->size; pos++) {
+    uint root = uf_find(e, pos);
+    a->base_parent[pos] = root;
+    a->base_size[pos] = UF(e, UF_SIZE, pos);
+    if (root == pos && e->shapes[pos] != EMPTY) a->base_components++;
+  }
+}
+
+/* ***************************** SOLVER ANNEAL ****************************** */
+solver_result solver_anneal(game g, const solver_options* opts, uint* cost) {
+  assert(g && cost);
+  if (!opts) opts = &default_options;
+  solver_tempering* a = (solver_tempering*)calloc(1, sizeof(solver_tempering));
+  assert(a);
+  engine* e = &a->e;
+  engine_init(e, g, SOLVER_ORDER_ROW);
+  a->stats = stats_begin(opts, e);
+
+  // The squares fixed by unit propagation are frozen
+  bool ok = true;
+  for (uint pos = 0; pos < e->size && ok; pos++)
+    if (!(e->cells[pos] & CELL_FIXED) && dom_size[e->cells[pos] & CELL_DOM] <= 1) ok = unit_fix(e, pos);
+  if (!ok) {
+    stats_end(a->stats);
+    engine_free(e);
+    free(a);
+    *cost = UINT_MAX;
+    return SOLVER_UNSOLVABLE;
+  }
+
+  uint size = e->size;
+  uint nb_threads = opts->nb_threads > 0 ? opts->nb_threads : solver_nb_threads();
+  a->nb_replicas = nb_threads > ANNEAL_MIN_REPLICAS ? nb_threads : ANNEAL_MIN_REPLICAS;
+  a->nb_threads = nb_threads;
+  a->free = (uint*)malloc(size * sizeof(uint));
+  a->free_at = (uint*)malloc(size * sizeof(uint));
+  a->base_parent = (uint*)malloc(size * sizeof(uint));
+  a->base_size = (uint*)malloc(size * sizeof(uint));
+  a->best = (uint8_t*)malloc(size * sizeof(uint8_t));
+  a->replicas = (anneal_replica*)calloc(a->nb_replicas, sizeof(anneal_replica));
+  a->at_slot = (uint*)malloc(a->nb_replicas * sizeof(uint));
+  a->temps = (double*)malloc(a->nb_replicas * sizeof(double));
+  a->accept = malloc(a->nb_replicas * sizeof(*a->accept));
+  assert(a->free && a->free_at && a->base_parent && a->base_size && a->best && a->replicas && a->at_slot);
+  assert(a->temps && a->accept);
+  rng_seed(&a->rng, opts->seed);
+  uint8_t* state = (uint8_t*)malloc(size * sizeof(uint8_t));
+  assert(state);
+  anneal_start(a, g, state);
+  a->round = a->nb_free > ANNEAL_MIN_ROUND ? a->nb_free : ANNEAL_MIN_ROUND;
+
+  // Geometric temperatures, from the coldest slot to the hottest one
+  for (uint k = 0; k < a->nb_replicas; k++) {
+    a->temps[k] = ANNEAL_T_MIN * pow(ANNEAL_T_MAX / ANNEAL_T_MIN, (double)k / (a->nb_replicas - 1));
+    a->accept[k][0] = UINT64_MAX;
+    for (uint delta = 1; delta <= ANNEAL_MAX_DELTA; delta++)
+      a->accept[k][delta] = (uint64_t)(exp(-(double)delta / a->temps[k]) * 18446744073709551615.0);
+  }
+  for (uint k = 0; k < a->nb_replicas; k++) {
+    anneal_replica* r = &a->replicas[k];
+    r->orient = (uint8_t*)malloc(size * sizeof(uint8_t));
+    r->bad_list = (uint*)malloc((a->nb_free + 1) * sizeof(uint));
+    r->bad_at = (uint*)malloc((a->nb_free + 1) * sizeof(uint));
+    assert(r->orient && r->bad_list && r->bad_at);
+    r->rng = a->rng;
+    for (uint j = 0; j <= k; j++) rng_jump(&r->rng);  // independent random choices
+    r->slot = a->at_slot[k] = k;
+    anneal_reset(a, r, state);
+  }
+  anneal_thread* threads = (anneal_thread*)malloc(nb_threads * sizeof(anneal_thread));
+  assert(threads);
+  for (uint t = 0; t < nb_threads; t++) {
+    threads[t] = (anneal_thread){.a = a, .index = t};
+    threads[t].parent = (uint*)malloc(size * sizeof(uint));
+    threads[t].csize = (uint*)malloc(size * sizeof(uint));
+    threads[t].log = (trail_entry*)malloc((ANNEAL_REPAIR_MOVES + 2) * sizeof(trail_entry));
+    assert(threads[t].parent && threads[t].csize && threads[t].log);
+  }
+
+  // The search starts from the orientations of the game, which may already be a solution
+  memcpy(a->best, state, size);
+  a->best_cost = anneal_measure(&threads[0], &a->replicas[0]);
+  if (a->best_cost > 0 && a->nb_free > 0) {
+    shared_init(&a->shared, opts);
+    a->ctx.shared = &a->shared;
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->cond, NULL);
+    pthread_t* tids = (pthread_t*)malloc(nb_threads * sizeof(pthread_t));
+    assert(tids);
+    for (uint t = 0; t < nb_threads; t++) pthread_create(&tids[t], NULL, anneal_worker, &threads[t]);
+    for (uint t = 0; t < nb_threads; t++) pthread_join(tids[t], NULL);
+    free(tids);
+    pthread_mutex_destroy(&a->lock);
+    pthread_cond_destroy(&a->cond);
+  }
+  stats_end(a->stats);
+
+  // The squares already in an orientation equivalent to the best one are left as they are
+  for (uint pos = 0; pos < size; pos++) {
+    direction* o = &g->tab_direction[pos];
+    if (e->half_edges[e->shapes[pos]][*o] != e->half_edges[e->shapes[pos]][a->best[pos]]) *o = a->best[pos];
+  }
+  *cost = a->best_cost;
+
+  for (uint t = 0; t < nb_threads; t++) {
+    free(threads[t].parent);
+    free(threads[t].csize);
+    free(threads[t].log);
+  }
+  free(threads);
+  for (uint k = 0; k < a->nb_replicas; k++) {
+    free(a->replicas[k].orient);
+    free(a->replicas[k].bad_list);
+    free(a->replicas[k].bad_at);
+  }
+  free(state);
+  free(a->free);
+  free(a->free_at);
+  free(a->base_parent);
+  free(a->base_size);
+  free(a->best);
+  free(a->replicas);
+  free(a->at_slot);
+  free(a->temps);
+  free(a->accept);
+  engine_free(e);
+  free(a);
+  return *cost == 0 ? SOLVER_SOLVED : SOLVER_ABORTED;
+}
+
+/* ************************************************************************** */
+/*                                   STRIPS                                   */
+/* ************************************************************************** */
+
+/* lines (rows or columns) of each strip */
+#define STRIP_LINES 8
+/* boards with more squares on each line are searched as a whole */
+#define STRIP_MAX_WIDTH 16
+/* patterns of a strip beyond which the board is searched as a whole */
+#define STRIP_MAX_PAIRS (1u << 18)
+
+/**
+ * @brief A search of a long board by strips. The board is cut across its
+ * longest side in strips of STRIP_LINES lines. Two consecutive strips share
+ * the edges of a boundary, whose pattern tells which of these edges link two
+ * pieces (one bit per square of a line). Each strip is searched alone for all
+ * its pairs of patterns (toward the previous strip, toward the next one) that
+ * an orientation of its squares without closed component agrees with. A join
+ * over the boundaries then chooses a chain of patterns, each strip is solved
+ * with its two patterns, and the components left apart by the strips are
+ * connected by a search of the lines around them, on a window which grows
+ * until it finds a connected solution.
+ */
+typedef struct {
+  cgame g;               // the game to solve
+  bool by_rows;          // the strips are bands of rows (the board is taller than wide)
+  uint nb_lines;         // lines along the longest side
+  uint width;            // squares of each line
+  uint nb_strips;        // number of strips
+  uint64_t** pairs;      // patterns of each strip (toward the previous one << 32 | toward the next one), sorted
+  uint* nb_pairs;        // number of patterns of each strip
+  uint32_t* chain;       // pattern of each boundary: before each strip, then after the last one
+  bool stitch;           // solve the strips with the patterns of chain (instead of collecting them)
+  direction* sol;        // orientations of the stitched strips
+  atomic_uint next;      // next strip to process
+  atomic_bool overflow;  // a strip has more than STRIP_MAX_PAIRS patterns
+  solver_shared shared;  // counters shared by all the threads
+  solver_stats* stats;   // statistics of the whole search (or NULL)
+  pthread_mutex_t lock;  // protects stats
+} solver_strips;
+
+/* ****************************** COMPARE U64 ******************************* */
+static int compare_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+/* ****************************** STRIP SQUARE ****************************** */
+/* square t of a line */
+static inline uint strip_square(const solver_strips* st, uint line, uint t) {
+  return st->by_rows ? line * st->width + t : t * st->nb_lines + line;
+}
+
+/* ****************************** STRIP LINES ******************************* */
+/* first line of strip k, and the line after its last one */
+static inline void strip_lines(const solver_strips* st, uint k, uint* first, uint* end) {
+  *first = k * STRIP_LINES;
+  *end = *first + STRIP_LINES < st->nb_lines ? *first + STRIP_LINES : st->nb_lines;
+}
+
+/* ******************************* PAIR BIT ********************************* */
+/* bit of an edge in a pair of patterns: the edges toward the previous strip,
+ * then the ones toward the next strip */
+static inline uint pair_bit(const solver_strips* st, uint64_t pair, uint edge) {
+  return edge < st->width ? (pair >> (32 + edge)) & 1 : (pair >> (edge - st->width)) & 1;
+}
+
+/* ******************************* STRIP EDGE ******************************* */
+/* keep the orientations of the square of strip k on an edge that agree with
+ * a bit of the pattern, return false if none is left */
+static bool strip_edge(const solver_strips* st, engine* e, uint k, uint edge, uint bit) {
+  uint first, end;
+  strip_lines(st, k, &first, &end);
+  direction d = st->by_rows ? NORTH : WEST;
+  uint pos = strip_square(st, first, edge % st->width);
+  if (edge >= st->width) {
+    pos = strip_square(st, end - 1, edge % st->width);
+    d = OPPOSITE(d);
+  }
+  uint8_t cell = e->cells[pos];
+  uint8_t kept = e->compat[e->shapes[pos]][d][bit];
+  if (cell & CELL_FIXED) return (kept & directions[CELL_ORIENT(cell)]) != 0;
+  if (!(cell & kept & CELL_DOM)) return false;
+  engine_set(e, pos, (cell & ~CELL_DOM) | (cell & kept & CELL_DOM));
+  return true;
+}
+
+/* ***************************** STRIP PATTERNS ***************************** */
+/* pair of patterns of strip k, whose squares are all fixed */
+static uint64_t strip_patterns(const solver_strips* st, engine* e, uint k) {
+  uint first, end;
+  strip_lines(st, k, &first, &end);
+  direction d = st->by_rows ? NORTH : WEST;
+  uint64_t in = 0, out = 0;
+  for (uint t = 0; t < st->width; t++) {
+    uint pos = strip_square(st, first, t);
+    if (e->half_edges[e->shapes[pos]][CELL_ORIENT(e->cells[pos])] & directions[d]) in |= UINT64_C(1) << t;
+    pos = strip_square(st, end - 1, t);
+    if (e->half_edges[e->shapes[pos]][CELL_ORIENT(e->cells[pos])] & directions[OPPOSITE(d)]) out |= UINT64_C(1) << t;
+  }
+  return in << 32 | out;
+}
+
+/* ***************************** STRIP WITNESS ****************************** */
+/* search an orientation of the free squares of strip k, return true if one is
+ * found: the cells are then left fixed to it (the caller undoes them) */
+static bool strip_witness(const solver_strips* st, solver_ctx* ctx, uint k) {
+  engine* e = &ctx->e;
+  uint first, end, n = 0;
+  strip_lines(st, k, &first, &end);
+  for (uint line = first; line < end; line++)
+    for (uint t = 0; t < st->width; t++) {
+      uint pos = strip_square(st, line, t);
+      if (!(e->cells[pos] & CELL_FIXED)) e->order[n++] = pos;
+    }
+  e->end = n;
+  ctx->found = 0;
+  search(ctx, 0);
+  return ctx->found > 0;
+}
+
+/* ***************************** STRIP PROJECT ****************************** */
+/* collect the patterns of strip k whose bits of the edges before edge are the
+ * ones kept in the cells; with known, pair is one of them (already collected) */
+static void strip_project(solver_strips* st, solver_ctx* ctx, uint k, uint edge, uint64_t pair, bool known,
+                          uint* cap) {
+  engine* e = &ctx->e;
+  if (!known) {
+    uint mark = e->trail_len;
+    bool found = strip_witness(st, ctx, k);
+    if (found) pair = strip_patterns(st, e, k);
+    engine_undo(e, mark);
+    if (!found) return;
+    if (st->nb_pairs[k] == STRIP_MAX_PAIRS) {
+      atomic_store(&st->overflow, true);
+      return;
+    }
+    if (st->nb_pairs[k] == *cap) {
+      *cap = *cap ? 2 * *cap : 64;
+      st->pairs[k] = (uint64_t*)realloc(st->pairs[k], *cap * sizeof(uint64_t));
+      assert(st->pairs[k]);
+    }
+    st->pairs[k][st->nb_pairs[k]++] = pair;
+  }
+  if (edge == 2 * st->width || atomic_load(&st->overflow) || atomic_load(&st->shared.stop)) return;
+
+  // The orientation found keeps its bit: only the other bit needs a new search
+  for (uint bit = 0; bit < 2; bit++) {
+    uint mark = e->trail_len;
+    if (strip_edge(st, e, k, edge, bit))
+      strip_project(st, ctx, k, edge + 1, pair, bit == pair_bit(st, pair, edge), cap);
+    engine_undo(e, mark);
+  }
+}
+
+/* ****************************** STRIP STITCH ****************************** */
+/* solve strip k with the patterns of its boundaries in the chain */
+static void strip_stitch(solver_strips* st, solver_ctx* ctx, uint k) {
+  engine* e = &ctx->e;
+  uint64_t pair = (uint64_t)st->chain[k] << 32 | st->chain[k + 1];
+  bool ok = true;
+  for (uint edge = 0; edge < 2 * st->width && ok; edge++) ok = strip_edge(st, e, k, edge, pair_bit(st, pair, edge));
+  ok = ok && strip_witness(st, ctx, k);
+
+  // The pair was collected with an orientation of the strip, which agrees with both patterns
+  assert(ok || atomic_load(&st->shared.stop));
+  if (!ok) return;
+  uint first, end;
+  strip_lines(st, k, &first, &end);
+  for (uint line = first; line < end; line++)
+    for (uint t = 0; t < st->width; t++) {
+      uint pos = strip_square(st, line, t);
+      st->sol[pos] = CELL_ORIENT(e->cells[pos]);
+    }
+}
+
+/* ****************************** STRIP WORKER ****************************** */
+static void* strip_worker(void* arg) {
+  solver_strips* st = (solver_strips*)arg;
+  solver_ctx ctx = {.limit = 1, .local_count = true, .shared = &st->shared};
+  engine_init(&ctx.e, st->g, SOLVER_ORDER_ROW);
+  solver_stats local;
+  if (st->stats) {
+    stats_init(&local, ctx.e.size);
+    ctx.stats = &local;
+  }
+
+  // Unit propagation already succeeded on the whole board
+  for (uint pos = 0; pos < ctx.e.size; pos++)
+    if (!(ctx.e.cells[pos] & CELL_FIXED) && dom_size[ctx.e.cells[pos] & CELL_DOM] <= 1) unit_fix(&ctx.e, pos);
+  uint mark = ctx.e.trail_len;
+  uint k;
+  while ((k = atomic_fetch_add(&st->next, 1)) < st->nb_strips) {
+    if (atomic_load(&st->shared.stop) || atomic_load(&st->overflow)) break;
+    engine_undo(&ctx.e, mark);
+    if (st->stitch) {
+      strip_stitch(st, &ctx, k);
+      continue;
+    }
+    uint cap = 0;
+    strip_project(st, &ctx, k, 0, 0, false, &cap);
+    qsort(st->pairs[k], st->nb_pairs[k], sizeof(uint64_t), compare_u64);
+    if (st->nb_pairs[k] == 0) atomic_store(&st->shared.stop, true);  // no solution
+  }
+  atomic_fetch_add(&st->shared.nodes, ctx.nodes);
+  if (st->stats) {
+    pthread_mutex_lock(&st->lock);
+    stats_merge(st->stats, &local);
+    pthread_mutex_unlock(&st->lock);
+    solver_stats_free(&local);
+  }
+  engine_free(&ctx.e);
+  return NULL;
+}
+
+/* ******************************* STRIP RUN ******************************** */
+/* process all the strips with some threads */
+static void strip_run(solver_strips* st, uint nb_threads) {
+  atomic_store(&st->next, 0);
+  pthread_t* threads = (pthread_t*)malloc(nb_threads * sizeof(pthread_t));
+  assert(threads);
+  for (uint t = 0; t < nb_threads; t++) pthread_create(&threads[t], NULL, strip_worker, st);
+  for (uint t = 0; t < nb_threads; t++) pthread_join(threads[t], NULL);
+  free(threads);
+}
+
+/* ****************************** PATTERN FIND ****************************** */
+/* entry of a pattern in a sorted set of entries (pattern << 32 | other), or NULL */
+static const uint64_t* pattern_find(const uint64_t* set, uint n, uint32_t pattern) {
+  uint lo = 0, hi = n;
+  while (lo < hi) {
+    uint mid = lo + (hi - lo) / 2;
+    if ((set[mid] >> 32) < pattern)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < n && (set[lo] >> 32) == pattern ? &set[lo] : NULL;
+}
+
+/* ******************************* STRIP JOIN ******************************* */
+/* choose the patterns of the chain, from a first one to the same one around a
+ * wrapping board (or to the empty pattern), return false if there is none */
+static bool strip_join(solver_strips* st, uint32_t first, bool wraps) {
+  // Patterns of each boundary reachable from the first one, with the pattern
+  // of the previous boundary they come from (pattern << 32 | previous one)
+  uint n = st->nb_strips;
+  uint64_t** reach = (uint64_t**)calloc(n + 1, sizeof(uint64_t*));
+  uint* nb_reach = (uint*)calloc(n + 1, sizeof(uint));
+  assert(reach && nb_reach);
+  reach[0] = (uint64_t*)malloc(sizeof(uint64_t));
+  assert(reach[0]);
+  reach[0][0] = (uint64_t)first << 32 | first;
+  nb_reach[0] = 1;
+  for (uint k = 0; k < n && nb_reach[k] > 0; k++) {
+    reach[k + 1] = (uint64_t*)malloc((st->nb_pairs[k] + 1) * sizeof(uint64_t));
+    assert(reach[k + 1]);
+    uint len = 0;
+    for (uint p = 0; p < st->nb_pairs[k]; p++) {
+      uint32_t in = st->pairs[k][p] >> 32, out = (uint32_t)st->pairs[k][p];
+      if (pattern_find(reach[k], nb_reach[k], in)) reach[k + 1][len++] = (uint64_t)out << 32 | in;
+    }
+    qsort(reach[k + 1], len, sizeof(uint64_t), compare_u64);
+    uint unique = 0;
+    for (uint p = 0; p < len; p++)
+      if (unique == 0 || (reach[k + 1][unique - 1] >> 32) != (reach[k + 1][p] >> 32))
+        reach[k + 1][unique++] = reach[k + 1][p];
+    nb_reach[k + 1] = unique;
+  }
+
+  uint32_t last = wraps ? first : 0;
+  bool found = pattern_find(reach[n], nb_reach[n], last) != NULL;
+  if (found) {
+    st->chain[n] = last;
+    for (uint k = n; k > 0; k--) st->chain[k - 1] = (uint32_t)*pattern_find(reach[k], nb_reach[k], st->chain[k]);
+  }
+  for (uint k = 0; k <= n; k++) free(reach[k]);
+  free(reach);
+  free(nb_reach);
+  return found;
+}
+
+/* **************************** STRIP COMPONENTS **************************** */
+/* components of the pieces of the stitched strips (NO_SQUARE for the empty
+ * squares), return their number and the smallest one with a cycle (or the
+ * smallest one if none has) */
+static uint strip_components(const solver_strips* st, engine* e, uint* comp, uint* target) {
+  uint nb_comps = 0, best = UINT_MAX;
+  for (uint pos = 0; pos < e->size; pos++) comp[pos] = NO_SQUARE;
+  for (uint pos = 0; pos < e->size; pos++) {
+    if (e->shapes[pos] == EMPTY || comp[pos] != NO_SQUARE) continue;
+    uint head = 0, tail = 0, nb_half_edges = 0;
+    e->queue[tail++] = pos;
+    comp[pos] = nb_comps;
+    while (head < tail) {
+      uint cur = e->queue[head++];
+      uint8_t half_edges = e->half_edges[e->shapes[cur]][st->sol[cur]];
+      nb_half_edges += dom_size[half_edges];
+      for (direction d = 0; d < NB_DIRS; d++) {
+        uint next = e->neighbours[NB_DIRS * cur + d];
+        if (!(half_edges & directions[d]) || comp[next] != NO_SQUARE) continue;
+        comp[next] = nb_comps;
+        e->queue[tail++] = next;
+      }
+    }
+    // The components with a cycle come first (with the edges of a tree in total, there is one)
+    uint key = nb_half_edges / 2 >= tail ? tail : UINT_MAX / 2 + tail;
+    if (key < best) {
+      best = key;
+      *target = nb_comps;
+    }
+    nb_comps++;
+  }
+  return nb_comps;
+}
+
+/* ****************************** STRIP WINDOW ****************************** */
+/* search again the squares of a window (in the order of the lines from a
+ * first one), with the other squares fixed: the components met by the window
+ * must be joined, the ones out of it stay as they are; return true if a
+ * solution is found (then it is kept in the orientations of the strips) */
+static bool strip_window(solver_strips* st, solver_ctx* ctx, const uint* comp, const bool* inside, uint from) {
+  engine* e = &ctx->e;
+  uint size = e->size, nb_pieces = e->nb_pieces, outside = 0;
+  bool* touched = (bool*)calloc(size, sizeof(bool));
+  assert(touched);
+  for (uint pos = 0; pos < size; pos++)
+    if (inside[pos] && comp[pos] != NO_SQUARE) touched[comp[pos]] = true;
+  for (uint pos = 0; pos < size; pos++) outside += comp[pos] != NO_SQUARE && !touched[comp[pos]];
+  free(touched);
+
+  // The squares out of the window keep their orientations, as the first
+  // decisions (the components closed there are no conflict)
+  engine_undo(e, 0);
+  e->nb_pieces = 0;
+  uint depth = 0, count = 0;
+  for (uint pos = 0; pos < size; pos++) {
+    if (inside[pos]) continue;
+    e->frames[depth].pos = pos;
+    e->level[pos] = depth++;
+    engine_assign(e, pos, st->sol[pos]);
+  }
+  e->nb_pieces = nb_pieces - outside;
+  for (uint k = 0; k < st->nb_lines; k++)
+    for (uint t = 0; t < st->width; t++) {
+      uint pos = strip_square(st, (from + k) % st->nb_lines, t);
+      if (inside[pos]) e->order[depth + count++] = pos;
+    }
+  e->end = depth + count;
+  ctx->found = 0;
+  search(ctx, depth);
+  e->nb_pieces = nb_pieces;
+  if (ctx->found == 0) return false;
+  for (uint k = depth; k < e->end; k++) st->sol[e->order[k]] = CELL_ORIENT(e->cells[e->order[k]]);
+  return true;
+}
+
+/* ****************************** STRIP REPAIR ****************************** */
+/* connect the components of the stitched strips, from a small component with
+ * a cycle (a cycle must be broken to join two components): it is searched
+ * again with a neighbour component, then with the lines around it, on a
+ * window which grows until the components it meets are joined; return false
+ * if the board has no solution (or the search was aborted) */
+static bool strip_repair(solver_strips* st, solver_ctx* ctx) {
+  engine* e = &ctx->e;
+  uint size = e->size, n = st->nb_lines;
+  bool wraps = game_is_wrapping(st->g);
+  uint* comp = (uint*)malloc(size * sizeof(uint));
+  uint* comp_size = (uint*)malloc(size * sizeof(uint));
+  uint* others = (uint*)malloc(size * sizeof(uint));
+  bool* inside = (bool*)malloc(size * sizeof(bool));
+  bool* used = (bool*)malloc(n * sizeof(bool));
+  assert(comp && comp_size && others && inside && used);
+  bool ok = true;
+  uint target, nb_comps;
+  while (ok && (nb_comps = strip_components(st, e, comp, &target)) > 1) {
+    // The neighbour components, the smallest first
+    memset(comp_size, 0, nb_comps * sizeof(uint));
+    for (uint pos = 0; pos < size; pos++)
+      if (comp[pos] != NO_SQUARE) comp_size[comp[pos]]++;
+    uint nb_others = 0;
+    for (uint pos = 0; pos < size; pos++) {
+      if (comp[pos] != target) continue;
+      for (direction d = 0; d < NB_DIRS; d++) {
+        uint next = e->neighbours[NB_DIRS * pos + d];
+        if (next == NO_SQUARE || comp[next] == NO_SQUARE || comp[next] == target) continue;
+        uint k = 0;
+        while (k < nb_others && others[k] != comp[next]) k++;
+        if (k == nb_others) others[nb_others++] = comp[next];
+      }
+    }
+    for (uint k = 1; k < nb_others; k++)
+      for (uint l = k; l > 0 && comp_size[others[l]] < comp_size[others[l - 1]]; l--) {
+        uint tmp = others[l];
+        others[l] = others[l - 1];
+        others[l - 1] = tmp;
+      }
+    bool joined = false;
+    for (uint k = 0; k < nb_others && !joined && !atomic_load(&st->shared.stop); k++) {
+      for (uint pos = 0; pos < size; pos++) inside[pos] = comp[pos] == target || comp[pos] == others[k];
+      joined = strip_window(st, ctx, comp, inside, 0);
+    }
+    if (joined) continue;
+
+    // Smallest arc of lines holding the component (around a wrapping board)
+    memset(used, 0, n * sizeof(bool));
+    for (uint pos = 0; pos < size; pos++)
+      if (comp[pos] == target) used[st->by_rows ? pos / st->width : pos % n] = true;
+    uint start = 0, len = n;
+    if (wraps) {
+      uint gap = 0, run = 0;
+      for (uint k = 0; k < 2 * n; k++) {
+        run = used[k % n] ? 0 : run + 1;
+        if (run > gap && run <= n) {
+          gap = run;
+          start = (k + 1) % n;
+        }
+      }
+      len = n - gap;
+    } else {
+      uint last = 0;
+      start = n;
+      for (uint line = 0; line < n; line++)
+        if (used[line]) {
+          if (start == n) start = line;
+          last = line;
+        }
+      len = last + 1 - start;
+    }
+
+    for (uint margin = STRIP_LINES; !joined; margin *= 2) {
+      uint from = start, span = len;
+      if (wraps) {
+        from = (start + n - margin % n) % n;
+        span = len + 2 * margin < n ? len + 2 * margin : n;
+      } else {
+        from = start > margin ? start - margin : 0;
+        span = (start + len + margin < n ? start + len + margin : n) - from;
+      }
+      for (uint pos = 0; pos < size; pos++)
+        inside[pos] = ((st->by_rows ? pos / st->width : pos % n) + n - from) % n < span;
+      joined = strip_window(st, ctx, comp, inside, from);
+      if (!joined && (span == n || atomic_load(&st->shared.stop))) {
+        ok = false;
+        break;
+      }
+    }
+  }
+  free(comp);
+  free(comp_size);
+  free(others);
+  free(inside);
+  free(used);
+  return ok;
+}
+
+/* ************************** SOLVER SOLVE STRIPS *************************** */
+solver_result solver_solve_strips(game g, const solver_options* opts) {
+  assert(g);
+  if (game_won(g)) return SOLVER_SOLVED;
+  uint nb_rows = game_nb_rows(g), nb_cols = game_nb_cols(g);
+  solver_strips st = {.g = g, .by_rows = nb_rows > nb_cols};
+  st.nb_lines = st.by_rows ? nb_rows : nb_cols;
+  st.width = st.by_rows ? nb_cols : nb_rows;
+  st.nb_strips = (st.nb_lines + STRIP_LINES - 1) / STRIP_LINES;
+  if (st.width > STRIP_MAX_WIDTH || st.nb_strips < 2) return solver_solve_parallel(g, opts);
+
+  atomic_init(&st.next, 0);
+  atomic_init(&st.overflow, false);
+  shared_init(&st.shared, opts);
+  solver_ctx ctx = {.limit = 1, .local_count = true, .shared = &st.shared};
+  engine_init(&ctx.e, g, SOLVER_ORDER_ROW);
+  st.stats = stats_begin(opts, &ctx.e);
+  bool ok = true;
+  for (uint pos = 0; pos < ctx.e.size && ok; pos++)
+    if (!(ctx.e.cells[pos] & CELL_FIXED) && dom_size[ctx.e.cells[pos] & CELL_DOM] <= 1) ok = unit_fix(&ctx.e, pos);
+  engine_undo(&ctx.e, 0);
+
+  st.pairs = (uint64_t**)calloc(st.nb_strips, sizeof(uint64_t*));
+  st.nb_pairs = (uint*)calloc(st.nb_strips, sizeof(uint));
+  st.chain = (uint32_t*)malloc((st.nb_strips + 1) * sizeof(uint32_t));
+  st.sol = (direction*)malloc(ctx.e.size * sizeof(direction));
+  assert(st.pairs && st.nb_pairs && st.chain && st.sol);
+  uint nb_threads = (opts && opts->nb_threads > 0) ? opts->nb_threads : solver_nb_threads();
+  if (nb_threads > st.nb_strips) nb_threads = st.nb_strips;
+  pthread_mutex_init(&st.lock, NULL);
+
+  // Patterns of each strip, then a chain of them (around a wrapping board, from
+  // each pattern of the first boundary), then the strips solved along the chain
+  if (ok) strip_run(&st, nb_threads);
+  bool wraps = game_is_wrapping(g);
+  ok = ok && !atomic_load(&st.shared.stop) && !atomic_load(&st.overflow);
+  bool chained = false;
+  for (uint p = 0; p < st.nb_pairs[0] && ok && !chained; p++) {
+    uint32_t first = st.pairs[0][p] >> 32;
+    if ((p == 0 || first != st.pairs[0][p - 1] >> 32) && (wraps || first == 0)) chained = strip_join(&st, first, wraps);
+  }
+  if (chained) {
+    st.stitch = true;
+    strip_run(&st, nb_threads);
+  }
+  ctx.stats = st.stats;
+  bool solved = chained && !atomic_load(&st.shared.stop) && strip_repair(&st, &ctx);
+  stats_end(st.stats);
+  if (solved) memcpy(g->tab_direction, st.sol, ctx.e.size * sizeof(direction));
+
+  bool overflow = atomic_load(&st.overflow);
+  pthread_mutex_destroy(&st.lock);
+  for (uint k = 0; k < st.nb_strips; k++) free(st.pairs[k]);
+  free(st.pairs);
+  free(st.nb_pairs);
+  free(st.chain);
+  free(st.sol);
+  engine_free(&ctx.e);
+
+  // Too many patterns: the board is searched as a whole, for the time left
+  if (overflow && !atomic_load(&st.shared.aborted)) {
+    solver_options rest = opts ? *opts : default_options;
+    if (rest.timeout > 0) rest.timeout = st.shared.deadline > now() ? st.shared.deadline - now() : 1e-9;
+    return solver_solve_parallel(g, &rest);
+  }
+  if (solved) return SOLVER_SOLVED;
+  return atomic_load(&st.shared.aborted) ? SOLVER_ABORTED : SOLVER_UNSOLVABLE;
+}
+
+/* ************************************************************************** */
+/*                                 PORTFOLIO                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief A race between several configurations of the search.
+ */
+typedef struct {
+  atomic_bool cancel;  // set by the winner, every other configuration stops
+  atomic_uint winner;  // index of the first configuration to finish (nb_configs until then)
+} solver_race;
+
+/**
+ * @brief One runner of a race: a configuration and its copy of the game.
+ */
+typedef struct {
+  game g;                // private copy of the game
+  solver_options opts;   // the configuration, cancelled by the race
+  uint index;            // index of the configuration
+  uint nb_configs;       // number of configurations of the race
+  solver_result result;  // result of the search of this configuration
+  solver_race* race;     // state shared by the runners
+} solver_runner;
+
+/* ****************************** RACE WORKER ******************************* */
+static void* race_worker(void* arg) {
+  solver_runner* runner = (solver_runner*)arg;
+  runner->result = solver_solve(runner->g, &runner->opts);
+  if (runner->result != SOLVER_ABORTED) {
+    uint none = runner->nb_configs;
+    if (atomic_compare_exchange_strong(&runner->race->winner, &none, runner->index))
+      atomic_store(&runner->race->cancel, true);
+  }
+  return NULL;
+}
+
+/* **************************** SOLVER PORTFOLIO **************************** */
+solver_result solver_portfolio(game g, const solver_options* configs, uint nb_configs, uint* winner) {
+  assert(g && configs && nb_configs > 0 && winner);
+  solver_race race;
+  atomic_init(&race.cancel, false);
+  atomic_init(&race.winner, nb_configs);
+
+  solver_runner* runners = (solver_runner*)malloc(nb_configs * sizeof(solver_runner));
+  pthread_t* threads = (pthread_t*)malloc(nb_configs * sizeof(pthread_t));
+  assert(runners && threads);
+  for (uint k = 0; k < nb_configs; k++) {
+    runners[k] = (solver_runner){
+        .g = game_copy(g), .opts = configs[k], .index = k, .nb_configs = nb_configs, .race = &race};
+    runners[k].opts.cancel = &race.cancel;
+    pthread_create(&threads[k], NULL, race_worker, &runners[k]);
+  }
+  for (uint k = 0; k < nb_configs; k++) pthread_join(threads[k], NULL);
+
+  *winner = atomic_load(&race.winner);
+  solver_result result = SOLVER_ABORTED;
+  if (*winner < nb_configs) {
+    result = runners[*winner].result;
+    uint size = game_nb_rows(g) * game_nb_cols(g);
+    if (result == SOLVER_SOLVED) memcpy(g->tab_direction, runners[*winner].g->tab_direction, size * sizeof(direction));
+  }
+
+  for (uint k = 0; k < nb_configs; k++) game_delete(runners[k].g);
+  free(threads);
+  free(runners);
+  return result;
+}
+
+/* **************************** SOLVER NB THREADS *************************** */
+uint solver_nb_threads(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (uint)n : 1;
+}
+
+/* **************************** SOLVER GAME HASH **************************** */
+uint64_t solver_game_hash(cgame g) {
+  assert(g);
+  // FNV-1a over the size, the wrapping option and the keys of the squares (see solver_square_key)
+  uint64_t h = 0xcbf29ce484222325ULL;
+  uint values[3] = {game_nb_rows(g), game_nb_cols(g), game_is_wrapping(g)};
+  for (uint k = 0; k < 3; k++) h = (h ^ values[k]) * 0x100000001b3ULL;
+  for (uint i = 0; i < game_nb_rows(g); i++)
+    for (uint j = 0; j < game_nb_cols(g); j++) h = (h ^ solver_square_key(g, i, j)) * 0x100000001b3ULL;
+  return h;
+}
+
+/* *************************** SOLVER SQUARE KEY **************************** */
+uint8_t solver_square_key(cgame g, uint i, uint j) {
+  assert(g);
+  uint8_t key = game_get_piece_shape(g, i, j);
+  if (game_is_piece_locked(g, i, j)) key |= 0x80 | game_get_piece_orientation(g, i, j) << 4;
+  return key;
+}
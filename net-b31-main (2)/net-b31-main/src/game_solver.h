@@ -0,0 +1,565 @@
+/**
+ * @file game_solver.h
+ * @brief Game Solver Engine.
+ * @details Backtracking search used by @ref game_solve, @ref game_nb_solutions
+ * and the random game generators. The search keeps the orientations still
+ * possible for each square: fixing a square removes the incompatible
+ * orientations of its neighbours, and backtracking restores them from a trail.
+ * The fixed pieces are grouped in components, and a closed component which
+ * does not hold all the pieces is rejected as soon as it appears. Optionally,
+ * conflicts are learned as nogoods and the search backjumps to their cause.
+ * It uses an explicit stack, so the board size is not limited by the C stack.
+ * Solutions with pieces in symmetrical
+ * positions (SEGMENT or CROSS) are counted only once, as in
+ * @ref game_nb_solutions.
+ * @copyright University of Bordeaux. All rights reserved, 2024.
+ **/
+
+#ifndef __GAME_SOLVER_H__
+#define __GAME_SOLVER_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "game_rng.h"
+
+/**
+ * @brief The result of a search.
+ **/
+typedef enum {
+  SOLVER_SOLVED = 0,  /**< a solution was found (or the count is complete) */
+  SOLVER_UNSOLVABLE,  /**< the whole search space was explored without solution */
+  SOLVER_ABORTED,     /**< the search was stopped by a limit of the options */
+  SOLVER_ERROR,       /**< the search was stopped because a file could not be written */
+} solver_result;
+
+/**
+ * @brief Function called regularly during a search to report its progress.
+ * @details It may be called from any of the threads of the search, but never
+ * by two threads at the same time for the same step.
+ * @param nb_nodes the number of nodes visited so far
+ * @param data the user data given in the options
+ * @return true to continue the search, false to abort it
+ **/
+typedef bool (*solver_progress)(uint64_t nb_nodes, void* data);
+
+/**
+ * @brief The pruning rules of the search, used to classify the pruned nodes.
+ **/
+typedef enum {
+  RULE_NONE = 0,  /**< the orientation was not pruned */
+  RULE_BORDER,    /**< a half-edge points out of a non-wrapping board */
+  RULE_NEIGHBOUR, /**< the piece does not match an already placed neighbour */
+  RULE_ENDPOINT,  /**< two endpoints are connected to each other (closed component) */
+  RULE_CLOSED,    /**< the piece closes a component which does not hold all the pieces */
+  RULE_NOGOOD,    /**< the orientations of some squares match a learned nogood */
+  NB_RULES,
+} solver_rule;
+
+/**
+ * @brief The order in which the search orients the squares.
+ **/
+typedef enum {
+  SOLVER_ORDER_DYNAMIC = 0, /**< at each node, the free square with the fewest orientations left, then with the most
+                                 fixed neighbours (or borders), then connected to a fixed neighbour */
+  SOLVER_ORDER_ROW,         /**< row-major order */
+  SOLVER_ORDER_SPIRAL,      /**< ring by ring, from the border toward the center */
+  SOLVER_ORDER_BFS,         /**< breadth-first from the most constrained corner */
+  NB_ORDERS,
+} solver_order;
+
+/**
+ * @brief When @ref solver_solve restarts its search from scratch.
+ * @details Each run is stopped after a budget of nodes, and the next one
+ * starts over with other random choices (see @ref solver_options.randomize).
+ **/
+typedef enum {
+  SOLVER_RESTART_NONE = 0,  /**< a single run, without budget */
+  SOLVER_RESTART_LUBY,      /**< run k gets restart_base * luby(k) nodes: 1, 1, 2, 1, 1, 2, 4, 1, ... */
+  SOLVER_RESTART_GEOMETRIC, /**< run k gets restart_base * restart_factor^(k-1) nodes */
+  NB_RESTARTS,
+} solver_restart;
+
+/**
+ * @brief Statistics of a search.
+ * @details Collected only when @ref solver_options.stats is set: a search
+ * without statistics runs a copy of the search loop where they are compiled
+ * out. The depth of a node is the number of squares already oriented.
+ **/
+typedef struct {
+  double time;               /**< wall-clock time of the search in seconds */
+  uint64_t nodes;            /**< number of nodes visited */
+  uint64_t tries;            /**< number of orientations tried */
+  uint64_t prunes[NB_RULES]; /**< number of orientations pruned by each rule (border: before the search) */
+  uint64_t leaves;           /**< number of nodes where all the squares are oriented */
+  uint64_t solutions;        /**< number of leaves which are solutions */
+  uint64_t backjumps;        /**< number of backtracks which skipped at least one decision (with learning) */
+  uint64_t nogoods;          /**< number of nogoods recorded (with learning) */
+  uint64_t restarts;         /**< number of runs stopped by the restart schedule */
+  uint max_depth;            /**< deepest depth reached */
+  uint depth_size;           /**< size of nodes_at_depth (number of squares + 1) */
+  uint64_t* nodes_at_depth;  /**< number of nodes visited at each depth */
+} solver_stats;
+
+/**
+ * @brief Limits and settings of a search.
+ * @details A zero-initialized structure means: no limit, one thread per
+ * processor. The limits are checked every 1024 nodes of each thread, so
+ * checking them does not slow the search down.
+ **/
+typedef struct {
+  uint nb_threads;            /**< threads used to count solutions (0 for one per processor) */
+  double timeout;             /**< wall-clock time limit in seconds (0 for none) */
+  uint64_t max_nodes;         /**< maximal number of nodes visited (0 for none) */
+  atomic_bool* cancel;        /**< the search is aborted when another thread sets it to true (or NULL) */
+  solver_progress progress;   /**< called every progress_interval nodes (or NULL) */
+  void* progress_data;        /**< user data given to progress */
+  uint64_t progress_interval; /**< number of nodes between two calls to progress */
+  solver_stats* stats;        /**< filled with the statistics of the search (or NULL) */
+  solver_order order;         /**< order in which the squares are oriented */
+  uint max_nogoods;           /**< size of the database of learned nogoods (0 to disable learning and backjumping) */
+  bool randomize;             /**< break the ties of the dynamic order and order the orientations at random */
+  uint64_t seed;              /**< seed of the random choices */
+  solver_restart restart;     /**< restart schedule of @ref solver_solve (implies randomize) */
+  uint64_t restart_base;      /**< nodes of the first run (0 for 512) */
+  double restart_factor;      /**< growth of the geometric schedule (0 for 1.5) */
+  bool keep_learned;          /**< keep the learned nogoods from one run to the next */
+  bool deterministic;         /**< (@ref solver_solve_parallel) give the lexicographically first solution */
+  bool no_decomposition;      /**< (@ref solver_count_ext) count the board as a whole, without splitting it */
+  const char* checkpoint;     /**< (@ref solver_count_ext) file where the rest of the count is saved (or NULL) */
+  double checkpoint_interval; /**< seconds between two checkpoints (0 for 5) */
+  bool resume;                /**< (@ref solver_count_ext) continue the count saved in the checkpoint file */
+  uint nb_jobs;               /**< (@ref solver_count_ext) split the search tree in nb_jobs parts (0 or 1 for none) */
+  uint job;                   /**< (@ref solver_count_ext) the part counted, less than nb_jobs */
+} solver_options;
+
+/**
+ * @brief An estimation of the cost of a count, by random probes of its search tree.
+ * @details The intervals are 95% confidence intervals (1.96 standard errors
+ * around the mean of the probes). The estimates of a probe are unbiased but
+ * their variance can be huge: an interval is only reliable with enough probes.
+ **/
+typedef struct {
+  uint probes;             /**< number of probes run */
+  bool exact;              /**< the calibration search explored the whole tree: the values below are exact */
+  double nodes;            /**< estimated number of nodes visited to count all the solutions */
+  double nodes_low;        /**< lower bound of the interval of nodes */
+  double nodes_high;       /**< upper bound of the interval of nodes */
+  double solutions;        /**< estimated number of solutions */
+  double solutions_low;    /**< lower bound of the interval of solutions */
+  double solutions_high;   /**< upper bound of the interval of solutions */
+  double nodes_per_second; /**< speed of the search on this game, measured by the calibration search */
+  double seconds;          /**< estimated time to count all the solutions on one thread */
+} solver_estimate;
+
+/**
+ * @brief The levels of the rules of a rating, from the easiest one (see @ref solver_rate).
+ **/
+typedef enum {
+  SOLVER_LEVEL_EDGES = 0, /**< local edge agreement: a half-edge (or its absence) that no orientation left to the
+                               neighbour can match */
+  SOLVER_LEVEL_CLOSED,    /**< closed-component avoidance: two endpoints or a component closed too early */
+  SOLVER_LEVEL_LOOKAHEAD, /**< one-level lookahead: an orientation whose propagation leads to a conflict */
+  SOLVER_LEVEL_SEARCH,    /**< no rule applies: the squares left must be guessed */
+  NB_LEVELS,
+} solver_level;
+
+/**
+ * @brief The label of a rating: easy with the edges alone, medium with the
+ * closed components, hard beyond.
+ **/
+typedef enum {
+  SOLVER_GRADE_EASY = 0,
+  SOLVER_GRADE_MEDIUM,
+  SOLVER_GRADE_HARD,
+  NB_GRADES,
+} solver_grade;
+
+/**
+ * @brief The rating of a game, by the rules needed to solve it (see @ref solver_rate).
+ * @details Each square is counted in the histogram at the level of the rule
+ * which fixed it (the squares forced by their shape or by the border count as
+ * edges), or at @ref SOLVER_LEVEL_SEARCH if no rule fixes it.
+ **/
+typedef struct {
+  solver_level level;        /**< hardest rule needed (SOLVER_LEVEL_SEARCH if some squares are left) */
+  solver_grade grade;        /**< easy, medium or hard */
+  uint nb_guesses;           /**< number of squares left to guess after all the rules */
+  uint histogram[NB_LEVELS]; /**< number of squares fixed at each level */
+  double difficulty;         /**< mean level of the squares, plus one: from 1 (edges only) to 4 (nothing fixed) */
+} solver_rating;
+
+/**
+ * @brief A sampler of random solutions of a game (see @ref solver_sampler_new).
+ **/
+typedef struct solver_sampler_s solver_sampler;
+
+/**
+ * @name Solver Engine
+ * @{
+ */
+
+/**
+ * @brief Function called by @ref solver_enumerate with each solution.
+ * @details The solution is given as a packed orientation vector: 2 bits per
+ * square in row-major order, square k being stored in bits 2*(k%4) and
+ * 2*(k%4)+1 of byte k/4. The buffer is only valid during the call.
+ * @param packed the packed orientations of the solution ((size + 3) / 4 bytes)
+ * @param size the number of squares
+ * @param data the user data given to @ref solver_enumerate
+ * @return true to continue the enumeration, false to stop it
+ */
+typedef bool (*solver_callback)(const uint8_t* packed, uint size, void* data);
+
+/**
+ * @brief Counts the solutions of a game, stopping after a given number.
+ * @param g the game
+ * @param limit the search stops as soon as @p limit solutions are found (0
+ * for no limit)
+ * @param sols an array of @p nb_sols * nb_rows * nb_cols orientations, filled
+ * in row-major order with the first solutions found (or NULL)
+ * @param nb_sols the number of solutions that can be stored in @p sols
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @post The game @p g is unchanged.
+ * @return the number of solutions found (at most @p limit if @p limit > 0)
+ */
+uint solver_count(cgame g, uint limit, direction* sols, uint nb_sols);
+
+/**
+ * @brief Enumerates all the solutions of a game.
+ * @details Each solution is given to @p cb as soon as it is found, without
+ * creating any game: the memory used does not depend on the number of
+ * solutions.
+ * @param g the game
+ * @param cb the function called with each solution
+ * @param data user data given to @p cb
+ * @param opts the limits of the search (or NULL for no limit), the enumeration
+ * always runs on the calling thread
+ * @param count set to the number of solutions given to @p cb
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @post The game @p g is unchanged.
+ * @return @ref SOLVER_SOLVED if all the solutions were given, @ref
+ * SOLVER_UNSOLVABLE if the game has none, @ref SOLVER_ABORTED if the
+ * enumeration was stopped by the options or by @p cb (@p count solutions were
+ * then given, not all of them)
+ */
+solver_result solver_enumerate(cgame g, solver_callback cb, void* data, const solver_options* opts, uint* count);
+
+/**
+ * @brief Searches a solution of a game, within the limits of some options.
+ * @param g the game to solve
+ * @param opts the limits of the search (or NULL for no limit)
+ * @details If a solution is found, the orientations of @p g are set to this
+ * solution. Otherwise @p g is unchanged. With a restart schedule, the search
+ * is started over after each budget of nodes: the budgets grow, so a game
+ * without solution is still proved unsolvable.
+ * @pre @p g is a valid pointer toward a game structure
+ * @return @ref SOLVER_SOLVED if a solution was found, @ref SOLVER_UNSOLVABLE if
+ * the whole search found none, @ref SOLVER_ABORTED if the search was stopped
+ * by the options before finding one
+ */
+solver_result solver_solve(game g, const solver_options* opts);
+
+/**
+ * @brief Searches a solution of a game with several threads.
+ * @details The threads share the search tree by work stealing: each one keeps
+ * a deque of subtrees. When a thread is idle, the others give it the
+ * orientations not tried yet of their shallowest decision, and it steals the
+ * oldest (largest) subtree of their deques. The first solution found stops
+ * every thread. With @p opts->deterministic, the squares are oriented in
+ * row-major order and the solution returned is the lexicographically first one
+ * (comparing the orientations in row-major order), whatever the number of
+ * threads: a thread gives up a subtree as soon as a better solution is known.
+ * The restart schedule of the options is ignored.
+ * @param g the game to solve
+ * @param opts the limits of the search and its number of threads (or NULL)
+ * @pre @p g is a valid pointer toward a game structure
+ * @return as @ref solver_solve
+ */
+solver_result solver_solve_parallel(game g, const solver_options* opts);
+
+/**
+ * @brief Counts the solutions of a game, within the limits of some options.
+ * @details The search runs on @p opts->nb_threads threads: the orientations of
+ * the first squares are enumerated and each combination is searched by the
+ * next idle thread. As soon as @p limit solutions are found or a limit of
+ * @p opts is reached, all the threads stop. Small games are searched by the
+ * calling thread only. Unless @p opts->no_decomposition is set, the forced
+ * orientations are fixed first and the free squares are split in parts which
+ * cannot interact: each part is counted on its own (in parallel) and the
+ * count is the product of the counts of the parts, saturated at UINT_MAX.
+ * With @p opts->checkpoint (and no @p limit), the count is searched as a whole
+ * by work stealing instead: every @p opts->checkpoint_interval seconds, the
+ * threads pause while the solutions counted so far and the subtrees left are
+ * written to the checkpoint file, which is replaced atomically. A complete
+ * count leaves a checkpoint without subtree, a count aborted by the limits of
+ * the options takes a last checkpoint before it stops. With @p opts->resume,
+ * the count continues from the checkpoint file if it holds a count of the same
+ * game (see @ref solver_checkpoint_matches), and @p count includes the
+ * solutions counted before.
+ * With @p opts->nb_jobs > 1, only one part of the search tree is counted: the
+ * tree is split breadth-first (at the squares the search would choose) into
+ * at least 32 subtrees per job, and job k counts the subtrees k, k + nb_jobs,
+ * k + 2 * nb_jobs... in the order they were made. The parts only depend on
+ * the game, the order and the number of jobs, so the jobs can run in separate
+ * processes (with any number of threads) and the counts of all the jobs add
+ * up to the count of the game. Such a count is neither split in independent
+ * parts nor checkpointed, and its choices are not randomized.
+ * @param g the game
+ * @param limit the search stops as soon as @p limit solutions are found (0
+ * for no limit)
+ * @param opts the limits of the search (or NULL for no limit)
+ * @param count set to the number of solutions found (at most @p limit if
+ * @p limit > 0)
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @post The game @p g is unchanged.
+ * @return @ref SOLVER_SOLVED if the count is complete (or reached @p limit),
+ * @ref SOLVER_UNSOLVABLE if the game has no solution, @ref SOLVER_ABORTED if
+ * the search was stopped by the options, @ref SOLVER_ERROR if it was stopped
+ * because the checkpoint file could not be written (in both cases @p count is
+ * then a lower bound)
+ */
+solver_result solver_count_ext(cgame g, uint limit, const solver_options* opts, uint* count);
+
+/**
+ * @brief Checks that a checkpoint file can be resumed on a game.
+ * @param g the game
+ * @param file the checkpoint file written by @ref solver_count_ext
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @return true if @p file is a valid checkpoint of a count of @p g
+ */
+bool solver_checkpoint_matches(cgame g, const char* file);
+
+/**
+ * @brief Estimates the size of the search tree of a count, and its number of solutions.
+ * @details A short count first measures the speed of the search (if it
+ * explores the whole tree, the values are exact). Then each probe follows a
+ * random path from the root (Knuth's estimator): the numbers of children met
+ * along the path give an unbiased estimate of the number of nodes and of
+ * solutions of the tree. The probes run on the calling thread, in time linear
+ * in the size of the board each. They estimate the tree of a plain count,
+ * with the order of @p opts but without learning nor random choices.
+ * @param g the game
+ * @param nb_probes the number of probes (0 for 1000)
+ * @param opts the limits of the estimation, the order of the squares and the
+ * seed of the probes (or NULL)
+ * @param est filled with the estimation
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @post The game @p g is unchanged.
+ * @return @ref SOLVER_SOLVED, or @ref SOLVER_ABORTED if the estimation was
+ * stopped by the options (@p est then holds the probes run so far, if any)
+ */
+solver_result solver_estimate_size(cgame g, uint nb_probes, const solver_options* opts, solver_estimate* est);
+
+/**
+ * @brief Creates a sampler of random solutions of a game.
+ * @details A sample goes down the search tree from the root. At each square
+ * with several orientations left, one is drawn with a probability proportional
+ * to its number of completions, counted exactly: every solution is drawn with
+ * the same probability (solutions with pieces in symmetrical positions are
+ * counted once, as in @ref solver_count). The counts of the squares met are
+ * kept by the sampler, so that the next samples only count the subtrees not
+ * visited yet. In approximate mode, a subtree whose count needs too many nodes
+ * is estimated by random probes instead (see @ref solver_estimate_size): the
+ * samples are then only close to uniform, but large boards can be sampled.
+ * @param g the game
+ * @param approximate estimate the large subtrees instead of counting them
+ * @param opts the order of the squares and the limits of each sample (or
+ * NULL), learning and random choices are ignored
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @return the sampler, to be freed with @ref solver_sampler_delete
+ */
+solver_sampler* solver_sampler_new(cgame g, bool approximate, const solver_options* opts);
+
+/**
+ * @brief Draws a random solution.
+ * @param s the sampler
+ * @param r the source of the random choices
+ * @param sol filled with the orientations of the solution (nb_rows * nb_cols
+ * orientations in row-major order)
+ * @pre @p s, @p r and @p sol are valid pointers
+ * @return @ref SOLVER_SOLVED if @p sol holds a solution, @ref SOLVER_UNSOLVABLE
+ * if the game has none, @ref SOLVER_ABORTED if the limits of the options were
+ * reached (or if the approximate mode met too many dead ends)
+ */
+solver_result solver_sample(solver_sampler* s, rng* r, direction* sol);
+
+/**
+ * @brief Frees a sampler.
+ * @param s the sampler (or NULL)
+ */
+void solver_sampler_delete(solver_sampler* s);
+
+/**
+ * @brief Races several configurations of the search on a game.
+ * @details Each configuration runs @ref solver_solve on its own thread, with
+ * its own copy of the game and within its own limits. The first one to finish
+ * (with a solution, or proving that there is none) wins and the others are
+ * cancelled. The cancel field of the configurations is ignored.
+ * @param g the game to solve
+ * @param configs the configurations
+ * @param nb_configs the number of configurations (one thread each)
+ * @param winner set to the index of the configuration which finished first
+ * (@p nb_configs if they were all aborted by their limits)
+ * @pre @p g is a valid pointer toward a game structure, @p nb_configs > 0
+ * @return the result of the winner (@ref SOLVER_ABORTED if there is none); if
+ * it is @ref SOLVER_SOLVED, the orientations of @p g are set to its solution
+ */
+solver_result solver_portfolio(game g, const solver_options* configs, uint nb_configs, uint* winner);
+
+/**
+ * @brief Frees the memory held by some statistics.
+ * @details The statistics given in the options are reset by each search, the
+ * structure must be zero-initialized before its first use.
+ * @param stats the statistics
+ * @pre @p stats is a valid pointer toward a solver_stats structure
+ */
+void solver_stats_free(solver_stats* stats);
+
+/**
+ * @brief Gets the number of threads used by default by the solver.
+ * @return the number of online processors
+ */
+uint solver_nb_threads(void);
+
+/**
+ * @brief Finds the solution of a game closest to its current orientations.
+ * @details The cost of a solution is the number of quarter turns that lead
+ * from the orientations of @p g to it, each square turned the shortest way
+ * (clockwise or not) toward the nearest of its symmetric orientations. The
+ * search is a branch and bound: the cheapest orientations are tried first,
+ * and a node is cut when the sum over all the squares of their fewest turns
+ * toward an orientation left in their domain reaches the best cost found. The
+ * order of the squares and the limits of @p opts are used (the search is
+ * sequential, without learning, randomization nor restarts).
+ * @param g the game, set to the best solution found (unchanged if none)
+ * @param opts options of the search (or NULL for the default ones)
+ * @param turns set to the cost of the best solution found (UINT_MAX if none)
+ * @pre @p g is a valid pointer toward a game structure
+ * @return @ref SOLVER_SOLVED if the solution found has the fewest quarter
+ * turns, @ref SOLVER_UNSOLVABLE if there is no solution, @ref SOLVER_ABORTED
+ * if the search was stopped by the options (the solution found, if any, may
+ * not be the best)
+ */
+solver_result solver_solve_min(game g, const solver_options* opts, uint* turns);
+
+/**
+ * @brief Looks for a solution by local search, from the current orientations.
+ * @details For the boards too large for a complete search. The squares fixed
+ * by propagation are frozen, the others are turned by parallel tempering:
+ * several replicas of the board, each one at its own temperature, accept the
+ * moves which do not add mismatched edges, and the others with a probability
+ * which decreases with the temperature; after each round, the replicas of
+ * neighbouring temperatures may exchange them. The cost of a state is its
+ * number of mismatched edges plus its number of components of pieces minus
+ * one, so it is 0 exactly when the game is won. When no better state is found
+ * for a while, every replica restarts from the best one. The replicas are
+ * shared by nb_threads threads (at least 4 replicas), the random choices
+ * depend on seed, and max_nodes limits the number of moves tried. Without a
+ * limit, the search only ends with a solution.
+ * @param g the game, set to the best state found
+ * @param opts options of the search (or NULL for the default ones)
+ * @param cost set to the cost of the best state found (UINT_MAX if
+ * propagation proves that there is no solution)
+ * @pre @p g is a valid pointer toward a game structure
+ * @return @ref SOLVER_SOLVED if @p g is won, @ref SOLVER_UNSOLVABLE if
+ * propagation proves that there is no solution (then @p g is unchanged), @ref
+ * SOLVER_ABORTED if the search was stopped by the options
+ */
+solver_result solver_anneal(game g, const solver_options* opts, uint* cost);
+
+/**
+ * @brief Searches a solution of a long board, strip by strip.
+ * @details For the boards far longer than wide (thousands of columns on a
+ * few rows, or the other way round), which are too large for a single search
+ * tree. The board is cut across its longest side in strips of 8 lines. Each
+ * strip is searched alone, in parallel, for the patterns of the edges it can
+ * share with the previous strip and with the next one. A join over the
+ * boundaries then chooses patterns that agree from one strip to the next, and
+ * each strip is solved with them. The strips may leave several components,
+ * joined one by one: a small component with a cycle is searched again (with
+ * the rest of the board fixed) together with a neighbour component, else with
+ * the lines around it, on a window which grows until the components it meets
+ * are joined. On a wrapping board, this window may grow up to the whole board
+ * (the limits of the options then apply). Boards with more than 16 squares
+ * across, with fewer than two
+ * strips, or whose strips have too many patterns are searched as a whole (see
+ * @ref solver_solve_parallel). The order and the learning of the options are
+ * ignored.
+ * @param g the game to solve, set to the solution found (unchanged otherwise)
+ * @param opts the limits of the search and its number of threads (or NULL)
+ * @pre @p g is a valid pointer toward a game structure
+ * @return @ref SOLVER_SOLVED if a solution was found, @ref SOLVER_UNSOLVABLE if
+ * the game has none, @ref SOLVER_ABORTED if the search was stopped by the
+ * options before finding one
+ */
+solver_result solver_solve_strips(game g, const solver_options* opts);
+
+/**
+ * @brief Finds the orientations forced by propagation, without any search.
+ * @details The orientations that would point a half-edge out of the board or
+ * toward a neighbour that cannot take it are removed, and the squares left
+ * with a single orientation are fixed, until nothing changes. With @p probe,
+ * each orientation left is also tried alone, and removed when this
+ * propagation leads to a conflict (failed literal): more squares are forced,
+ * for a few propagations per orientation. The squares forced this way have
+ * the same orientation in every solution. This costs much less than a search.
+ * @param g the game (its orientations are ignored)
+ * @param probe also remove the orientations whose propagation fails
+ * @param forced set to the orientation of each square (row by row), or to
+ * NB_DIRS for the squares that are not forced; as in the search, only the
+ * first of symmetric orientations is given (NORTH or EAST for a SEGMENT,
+ * NORTH for a CROSS or an EMPTY square)
+ * @pre @p forced has room for one direction per square
+ * @return @ref SOLVER_UNSOLVABLE if propagation proves that @p g has no
+ * solution (then nothing is forced), @ref SOLVER_SOLVED otherwise
+ */
+solver_result solver_forced(cgame g, bool probe, direction* forced);
+
+/**
+ * @brief Rates the difficulty of a game by the rules a player needs.
+ * @details The orientations are removed by rules of increasing strength, as a
+ * player would: local edge agreement, then closed-component avoidance, then a
+ * one-level lookahead (an orientation is tried and propagated). A stronger
+ * rule is only used when the weaker ones remove nothing, and the next removal
+ * starts again from the weakest one. The cost is the one of @ref
+ * solver_forced with probing: cheap enough for every generated game.
+ * @param g the game (its orientations are ignored)
+ * @param rating set to the rating of @p g
+ * @pre @p g and @p rating are valid pointers
+ * @return @ref SOLVER_UNSOLVABLE if the rules prove that @p g has no solution
+ * (then the rating is zeroed), @ref SOLVER_SOLVED otherwise
+ */
+solver_result solver_rate(cgame g, solver_rating* rating);
+
+/**
+ * @brief Gets a hash of what the solutions of a game depend on.
+ * @details The hash covers the size, the wrapping option and the keys of the
+ * squares (see @ref solver_square_key), but not the orientations of the
+ * unlocked pieces: it identifies the game in the files written by the solver
+ * and by game_solve.
+ * @param g the game
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @return a 64-bit hash of the game
+ */
+uint64_t solver_game_hash(cgame g);
+
+/**
+ * @brief Gets what the solutions of a game depend on in a square.
+ * @details The key is the shape of the piece, plus 0x80 and its orientation
+ * times 16 if it is locked (see @ref game_set_piece_locked).
+ * @param g the game
+ * @param i row index
+ * @param j column index
+ * @pre @p g is a valid pointer toward a cgame structure
+ * @return the key of the square (i,j)
+ */
+uint8_t solver_square_key(cgame g, uint i, uint j);
+
+/**
+ * @}
+ */
+
+#endif  // __GAME_SOLVER_H__
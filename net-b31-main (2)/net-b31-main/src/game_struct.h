@@ -1,16 +1,32 @@
 #ifndef __GAME_STRUCT_H__
 #define __GAME_STRUCT_H__
 
+#include <stdint.h>
+
 #include "queue.h"
 
+/* what the solver found for the shapes and locks of a game, kept between two
+ * solves or hints (see game_tools.c): the moves of the player do not change it;
+ * it is updated even through a cgame, without any lock */
+struct warm_s {
+  bool valid;            // key and the fields below were computed
+  uint64_t key;          // hash of the game they were computed for (see solver_game_hash)
+  bool unsolvable;       // propagation proved that the game has no solution
+  direction *forced[2];  // orientations forced by propagation, without and with failed literals (or NULL)
+  bool searched;         // the search was run: solution is its answer
+  direction *solution;   // last solution found (NULL if none)
+};
+
 struct game_s {
   uint HEIGHT;
   uint WIDTH;
   shape *tab_shape;
   direction *tab_direction;
+  bool *tab_locked;
   bool is_wrapping;
   queue *undo_mooves;
   queue *redo_mooves;
+  struct warm_s *warm;
 };
 
 #endif /*__GAME_STRUCT_H__*/
\ No newline at end of file
@@ -24,6 +24,7 @@
 void help_menu() {
   printf("- press 'c <i> <j>' to rotate piece clockwise in square (i,j)\n");
   printf("- press 'a <i> <j>' to rotate piece anti-clockwise in square (i,j)\n");
+  printf("- press 'l <i> <j>' to lock or unlock the piece in square (i,j)\n");
   printf("- press 'r' to shuffle game\n");
   printf("- press 'z' to undo\n");
   printf("- press 'y' to redo\n");
@@ -71,6 +72,14 @@ bool player_action(game g) {
       printf("> action: play move '%c' into square (%d,%d)\n", c, i, j);
       game_play_move(g, i, j, rot);
       break;
+    case 'l':
+      if (scanf("%d %d", &i, &j) != 2 || i >= game_nb_rows(g) || j >= game_nb_cols(g)) {
+        fprintf(stderr, "Error: invalid user input!\n");
+        break;
+      }
+      printf("> action: %s square (%d,%d)\n", game_is_piece_locked(g, i, j) ? "unlock" : "lock", i, j);
+      game_set_piece_locked(g, i, j, !game_is_piece_locked(g, i, j));
+      break;
     case 'z':
       printf("> action: undo\n");
       game_undo(g);
@@ -5,6 +5,7 @@
 #include "game_tools.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -12,16 +13,12 @@
 #include <string.h>
 
 #include "game_private.h"
+#include "game_rng.h"
+#include "game_solver.h"
 
 /* ************************************************************************** */
 /*                          MAPPING SHAPE AND DIRECTION                       */
 /* ************************************************************************** */
-#define NORTH_B 0b0001
-#define EAST_B 0b0010
-#define SOUTH_B 0b0100
-#define WEST_B 0b1000
-uint8_t directions[] = {NORTH_B, EAST_B, SOUTH_B, WEST_B};
-
 static shape shape_map[256] = {
     ['E'] = EMPTY, ['N'] = ENDPOINT, ['S'] = SEGMENT, ['C'] = CORNER, ['T'] = TEE, ['X'] = CROSS};
 
@@ -100,6 +97,12 @@ void game_save(cgame g, char* filename) {
 
 /* ****************************** GAME RANDOM ******************************* */
 game game_random(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint nb_extra) {
+  return game_random_ext(nb_rows, nb_cols, wrapping, nb_empty, nb_extra, rng_default());
+}
+
+/* **************************** GAME RANDOM EXT ***************************** */
+game game_random_ext(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint nb_extra, rng* r) {
+  assert(r);
   uint size = nb_rows * nb_cols;
   assert(nb_cols * nb_rows >= 2);
   assert(nb_empty <= size - 2);
@@ -112,9 +115,9 @@ game game_random(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint
 
   // Add the first 2 pieces
   do {
-    i = (((double)rand() * nb_rows) / RAND_MAX);
-    j = (((double)rand() * nb_cols) / RAND_MAX);
-    d = (((double)rand() * NB_DIRS) / RAND_MAX);
+    i = rng_bounded(r, nb_rows);
+    j = rng_bounded(r, nb_cols);
+    d = rng_bounded(r, NB_DIRS);
   } while (!_add_edge(g, i, j, d));
 
   // Add the rest
@@ -122,9 +125,9 @@ game game_random(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint
     uint i_next, j_next;
     do {
       do {
-        i = (((double)rand() * nb_rows) / RAND_MAX);
-        j = (((double)rand() * nb_cols) / RAND_MAX);
-        d = (((double)rand() * NB_DIRS) / RAND_MAX);
+        i = rng_bounded(r, nb_rows);
+        j = rng_bounded(r, nb_cols);
+        d = rng_bounded(r, NB_DIRS);
       } while (game_get_piece_shape(g, i, j) == EMPTY || !game_get_ajacent_square(g, i, j, d, &i_next, &j_next));
     } while (game_get_piece_shape(g, i_next, j_next) != EMPTY);
     _add_edge(g, i, j, d);
@@ -135,9 +138,9 @@ game game_random(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint
     uint i_next, j_next;
     do {
       do {
-        i = (((double)rand() * nb_rows) / RAND_MAX);
-        j = (((double)rand() * nb_cols) / RAND_MAX);
-        d = (((double)rand() * NB_DIRS) / RAND_MAX);
+        i = rng_bounded(r, nb_rows);
+        j = rng_bounded(r, nb_cols);
+        d = rng_bounded(r, NB_DIRS);
       } while (!game_get_ajacent_square(g, i, j, d, &i_next, &j_next) || game_check_edge(g, i, j, d) == MATCH);
     } while (game_get_piece_shape(g, i, j) == EMPTY || game_get_piece_shape(g, i_next, j_next) == EMPTY);
     _add_edge(g, i, j, d);
@@ -146,167 +149,255 @@ game game_random(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint
   return g;
 }
 
-/* ******************************* INIT ARRAY ******************************* */
-void init_Array(game g, uint8_t* t_shape) {
-  uint nb_rows = game_nb_rows(g);
-  uint nb_cols = game_nb_cols(g);
+/* ************************************************************************** */
+/*                          UNIQUE GAME GENERATION                            */
+/* ************************************************************************** */
 
-  for (uint i = 0; i < nb_rows; i++) {
-    for (uint j = 0; j < nb_cols; j++) {
-      shape s = game_get_piece_shape(g, i, j);
-      t_shape[i * nb_cols + j] = 0;
-
-      switch (s) {
-        case EMPTY:
-        case CROSS:
-          t_shape[i * nb_cols + j] |= NORTH_B;
-          break;
-        case SEGMENT:
-          t_shape[i * nb_cols + j] |= (NORTH_B | EAST_B);
-          break;
-        default:
-          t_shape[i * nb_cols + j] |= (WEST_B | EAST_B | NORTH_B | SOUTH_B);
-          break;
-      }
-    }
-  }
+/* number of half-edges of the square (i,j) */
+static uint _degree(cgame g, uint i, uint j) {
+  uint deg = 0;
+  for (direction d = 0; d < NB_DIRS; d++)
+    if (game_has_half_edge(g, i, j, d)) deg++;
+  return deg;
 }
 
-/* ****************************** IS MISMATCH ******************************* */
-bool isMismatch(game g, uint i, uint j, direction d, uint8_t* t_shape) {
-  // Optimisation function, if current game checked is not winnable, no need to continue
-  uint nb_cols = game_nb_cols(g);
-  uint nb_rows = game_nb_rows(g);
-  bool isEndpoint = (game_get_piece_shape(g, i, j) == ENDPOINT);
-
-  bool wrapping = game_is_wrapping(g);
-  if (!wrapping) {
-    // If a piece is Mismatch with the border, no need to ever test it ever again
-    if (i == 0 && game_check_edge(g, i, j, NORTH) == MISMATCH) {
-      t_shape[i * nb_cols + j] &= ~directions[d];
-      return true;
-    }
-    if (j == 0 && game_check_edge(g, i, j, WEST) == MISMATCH) {
-      t_shape[i * nb_cols + j] &= ~directions[d];
-      return true;
-    }
-    if (i == nb_rows - 1 && game_check_edge(g, i, j, SOUTH) == MISMATCH) {
-      t_shape[i * nb_cols + j] &= ~directions[d];
-      return true;
-    }
-    if (j == nb_cols - 1 && game_check_edge(g, i, j, EAST) == MISMATCH) {
-      t_shape[i * nb_cols + j] &= ~directions[d];
-      return true;
-    }
-  }
-
-  // If game is not winning so far, don't need to continue
-  if (i >= 1 && game_check_edge(g, i, j, NORTH) == MISMATCH) {
-    shape s = game_get_piece_shape(g, i - 1, j);
-    if (s == EMPTY || s == CROSS) t_shape[i * nb_cols + j] &= ~directions[d];
-    return true;
-  }
-  if (j >= 1 && game_check_edge(g, i, j, WEST) == MISMATCH) {
-    shape s = game_get_piece_shape(g, i, j - 1);
-    if (s == EMPTY || s == CROSS) t_shape[i * nb_cols + j] &= ~directions[d];
-    return true;
-  }
+/* true if the edges (i1,j1,d1) and (i2,j2,d2) link the same squares on the same side */
+static bool _same_edge(cgame g, uint i1, uint j1, direction d1, uint i2, uint j2, direction d2) {
+  if (i1 == i2 && j1 == j2 && d1 == d2) return true;
+  uint in, jn;
+  if (!game_get_ajacent_square(g, i1, j1, d1, &in, &jn)) return false;
+  return in == i2 && jn == j2 && d2 == (d1 + 2) % NB_DIRS;
+}
 
-  if (game_is_wrapping(g)) {
-    if (i == nb_rows - 1 && game_check_edge(g, i, j, SOUTH) == MISMATCH) {
-      shape s = game_get_piece_shape(g, 0, j);
-      if (s == EMPTY || s == CROSS) t_shape[i * nb_cols + j] &= ~directions[d];
-      return true;
-    }
-    if (j == nb_cols - 1 && game_check_edge(g, i, j, EAST) == MISMATCH) {
-      shape s = game_get_piece_shape(g, i, 0);
-      if (s == EMPTY || s == CROSS) t_shape[i * nb_cols + j] &= ~directions[d];
-      return true;
+/**
+ * @brief Rewires the solution g around the square (i,j).
+ * @details One edge near (i,j) is removed and another one near (i,j) is added,
+ * so that the solution stays connected with the same number of edges and of
+ * empty squares. The edges touch a square at distance <= 2 of (i,j), so only
+ * the shapes of the squares at distance <= 3 of (i,j) change.
+ * @return true if the solution was modified, false if no rewiring was possible
+ */
+static bool _perturb(game g, uint i, uint j, rng* r) {
+  // Neighbourhood of (i,j): squares at distance <= 2 (at most 13 squares)
+  uint ni[13] = {i}, nj[13] = {j}, dist[13] = {0}, nb = 1;
+  for (uint k = 0; k < nb && dist[k] < 2; k++) {
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint in, jn;
+      if (!game_get_ajacent_square(g, ni[k], nj[k], d, &in, &jn)) continue;
+      bool known = false;
+      for (uint l = 0; l < nb; l++) known |= (ni[l] == in && nj[l] == jn);
+      if (!known) {
+        ni[nb] = in;
+        nj[nb] = jn;
+        dist[nb++] = dist[k] + 1;
+      }
     }
   }
 
-  // If 2 two endpoints are looking each others can't be winnable
-  if (isEndpoint && nb_cols * nb_rows > 2 && game_check_edge(g, i, j, d) == MATCH) {
-    uint i_next = 0, j_next = 0;
-    game_get_ajacent_square(g, i, j, d, &i_next, &j_next);
-    if (game_get_piece_shape(g, i_next, j_next) == ENDPOINT) {
-      uint nb_piece = 0;
-      for (uint index = 0; index < nb_cols * nb_rows; index++) {
-        if (game_get_piece_shape(g, i, j) != EMPTY) nb_piece++;
-        if (nb_piece == 3) {
-          t_shape[i * nb_cols + j] &= ~directions[d];
-          return true;
-        }
-      }
+  // Candidate edges to remove (keeping both squares non-empty) and to add (between non-empty squares)
+  uint rem[13 * NB_DIRS], add[13 * NB_DIRS], nb_rem = 0, nb_add = 0;
+  for (uint k = 0; k < nb; k++) {
+    if (game_get_piece_shape(g, ni[k], nj[k]) == EMPTY) continue;
+    for (direction d = 0; d < NB_DIRS; d++) {
+      uint in, jn;
+      if (!game_get_ajacent_square(g, ni[k], nj[k], d, &in, &jn)) continue;
+      edge_status e = game_check_edge(g, ni[k], nj[k], d);
+      if (e == MATCH && _degree(g, ni[k], nj[k]) > 1 && _degree(g, in, jn) > 1) rem[nb_rem++] = k * NB_DIRS + d;
+      if (e == NOEDGE && game_get_piece_shape(g, in, jn) != EMPTY) add[nb_add++] = k * NB_DIRS + d;
     }
   }
+  if (nb_rem == 0 || nb_add == 0) return false;
+
+  // Try the pairs in a random order until the solution is still connected
+  uint rem_start = rng_bounded(r, nb_rem), add_start = rng_bounded(r, nb_add);
+  for (uint x = 0; x < nb_rem; x++) {
+    uint kr = rem[(rem_start + x) % nb_rem];
+    uint ir = ni[kr / NB_DIRS], jr = nj[kr / NB_DIRS];
+    direction dr = kr % NB_DIRS;
+    _remove_edge(g, ir, jr, dr);
+
+    for (uint y = 0; y < nb_add; y++) {
+      uint ka = add[(add_start + y) % nb_add];
+      uint ia = ni[ka / NB_DIRS], ja = nj[ka / NB_DIRS];
+      direction da = ka % NB_DIRS;
+      if (_same_edge(g, ir, jr, dr, ia, ja, da)) continue;
+      if (!_add_edge(g, ia, ja, da)) continue;
+      if (game_is_connected(g)) return true;
+      _remove_edge(g, ia, ja, da);
+    }
 
+    _add_edge(g, ir, jr, dr);
+  }
   return false;
 }
 
-/* ******************************* SOLVE REC ******************************** */
-bool solve_rec(game g, uint pos, uint size, uint* count, uint8_t* t_shape) {
-  // Functions used to brut-force solving games
-  // If count is NULL then return first game won
-  // Else compute the numbers of solutions in count
-  if (pos == size) {
-    bool won = game_won(g);
-    if (count && won) (*count)++;
-    return won;
-  }
-
-  uint nb_cols = game_nb_cols(g);
-  uint j = pos % game_nb_cols(g);
-  uint i = pos / game_nb_cols(g);
+/* new random games tried by game_random_unique before giving up */
+#define MAX_REGENERATIONS 64
 
-  for (int d = 0; d < 4; d++) {
-    if (t_shape[i * nb_cols + j] & directions[d]) {
-      game_set_piece_orientation(g, i, j, d);
+/* *************************** GAME RANDOM UNIQUE *************************** */
+game game_random_unique(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint nb_extra, rng* r) {
+  assert(r);
+  uint size = nb_rows * nb_cols;
+  uint max_repairs = 4 * size, nb_regenerations = 0;
+
+  game g = game_random_ext(nb_rows, nb_cols, wrapping, nb_empty, nb_extra, r);
+  direction* sols = (direction*)malloc(2 * size * sizeof(direction));
+  uint* diff = (uint*)malloc(size * sizeof(uint));
+  assert(sols && diff);
+
+  uint nb_repairs = 0;
+  while (g && solver_count(g, 2, sols, 2) > 1) {
+    // Squares where the two solutions found diverge, in the solver order
+    uint nb_diff = 0;
+    for (uint pos = 0; pos < size; pos++)
+      if (_encode_shape(g->tab_shape[pos], sols[pos]) != _encode_shape(g->tab_shape[pos], sols[size + pos]))
+        diff[nb_diff++] = pos;
+    assert(nb_diff > 0);
+
+    // Repair around the divergence point first, then around the other ambiguous squares
+    bool repaired = false;
+    uint start = rng_bounded(r, 2) ? 0 : rng_bounded(r, nb_diff);
+    for (uint k = 0; k < nb_diff && !repaired; k++) {
+      uint pos = diff[(start + k) % nb_diff];
+      repaired = _perturb(g, pos / nb_cols, pos % nb_cols, r);
+    }
 
-      if (!isMismatch(g, i, j, d, t_shape)) {
-        if (solve_rec(g, pos + 1, size, count, t_shape) && !count) return true;
-      }
+    // Last resort: start again from a new random game (these parameters may never give a unique one)
+    if (!repaired || ++nb_repairs > max_repairs) {
+      game_delete(g);
+      g = NULL;
+      if (++nb_regenerations <= MAX_REGENERATIONS)
+        g = game_random_ext(nb_rows, nb_cols, wrapping, nb_empty, nb_extra, r);
+      nb_repairs = 0;
     }
   }
 
-  return false;
+  free(sols);
+  free(diff);
+  return g;
 }
 
+/* cache of game_solve and game_nb_solutions */
+static solcache* cache = NULL;
+
+/* **************************** GAME USE CACHE ****************************** */
+void game_use_cache(solcache* c) { cache = c; }
+
 /* *************************** GAME NB SOLUTIONS **************************** */
-uint game_nb_solutions(cgame g) {
+uint game_nb_solutions(cgame g) { return game_nb_solutions_limit(g, 0, NULL); }
+
+/* ************************ GAME NB SOLUTIONS LIMIT ************************* */
+uint game_nb_solutions_limit(cgame g, uint limit, bool* exact) {
   assert(g);
-  game g_copy = game_copy(g);
+  uint64_t cached;
+  if (cache && solcache_count(cache, g, &cached)) {
+    uint nb_sols = limit > 0 && cached >= limit ? limit : cached > UINT_MAX ? UINT_MAX : (uint)cached;
+    if (exact) *exact = (limit == 0 || cached < limit);
+    return nb_sols;
+  }
   uint nb_sols = 0;
+  solver_result res = solver_count_ext(g, limit, NULL, &nb_sols);
+  if (exact) *exact = (limit == 0 || nb_sols < limit);
+  if (cache && res != SOLVER_ABORTED && (limit == 0 || nb_sols < limit)) solcache_put_count(cache, g, nb_sols);
+  return nb_sols;
+}
 
-  uint8_t* t_shape = (uint8_t*)malloc(game_nb_cols(g) * game_nb_rows(g) * sizeof(uint8_t));
-  init_Array(g_copy, t_shape);
+/* ********************************* _WARM ********************************** */
+/* the solver state of a game, emptied if the game changed since it was computed
+ * (its size, wrapping, shapes or locks: not the orientations of the pieces) */
+static struct warm_s* _warm(cgame g) {
+  struct warm_s* w = g->warm;
+  uint64_t key = solver_game_hash(g);
+  if (w->valid && w->key == key) return w;
+  for (uint k = 0; k < 2; k++) {
+    free(w->forced[k]);
+    w->forced[k] = NULL;
+  }
+  free(w->solution);
+  *w = (struct warm_s){.valid = true, .key = key};
+  return w;
+}
 
-  solve_rec(g_copy, 0, game_nb_cols(g) * game_nb_rows(g), &nb_sols, t_shape);
-  game_delete(g_copy);
-  return nb_sols;
+/* **************************** _WARM SOLUTION ****************************** */
+/* a solution of a game, searched once for its shapes and locks (NULL if none) */
+static const direction* _warm_solution(cgame g) {
+  struct warm_s* w = _warm(g);
+  if (w->searched) return w->solution;
+  game copy = game_copy(g);
+  bool solvable;
+  if (!cache || !solcache_solution(cache, copy, &solvable)) {
+    solvable = solver_solve(copy, NULL) == SOLVER_SOLVED;
+    if (cache) solcache_put_solution(cache, copy, solvable);
+  }
+  w->searched = true;
+  if (solvable) {
+    uint size = game_nb_rows(g) * game_nb_cols(g);
+    w->solution = (direction*)malloc(size * sizeof(direction));
+    assert(w->solution);
+    memcpy(w->solution, copy->tab_direction, size * sizeof(direction));
+  }
+  game_delete(copy);
+  return w->solution;
 }
 
 /* ******************************* GAME SOLVE ******************************* */
 bool game_solve(game g) {
   assert(g);
-  if (game_won(g)) {
-    return true;
-  }
-  game g_copy = game_copy(g);
+  if (game_won(g)) return true;  // the solution of the player is kept
+  const direction* solution = _warm_solution(g);
+  if (solution) memcpy(g->tab_direction, solution, game_nb_rows(g) * game_nb_cols(g) * sizeof(direction));
+  return solution != NULL;
+}
 
-  uint8_t* t_shape = (uint8_t*)malloc(game_nb_cols(g) * game_nb_rows(g) * sizeof(uint8_t));
-  init_Array(g_copy, t_shape);
+/* ********************************* _TURNS ********************************* */
+/* fewest clockwise quarter turns from an orientation of a piece to one equivalent to another */
+static int _turns(shape s, direction from, direction to) {
+  uint period = _shape_period(s);
+  for (int t = 0; t < NB_DIRS; t++)
+    if ((from + t + NB_DIRS - to) % period == 0) return t;
+  return 0;
+}
 
-  if (solve_rec(g_copy, 0, game_nb_cols(g) * game_nb_rows(g), NULL, t_shape)) {
-    for (uint i = 0; i < game_nb_rows(g); i++) {
-      for (uint j = 0; j < game_nb_cols(g); j++) {
-        // Copy the orientation and shape of piece (i,j) in game g to piece (i,j) in game new_game
-        game_set_piece_orientation(g, i, j, game_get_piece_orientation(g_copy, i, j));
-        game_set_piece_shape(g, i, j, game_get_piece_shape(g_copy, i, j));
-      }
+/* ******************************* _HINT FROM ******************************* */
+/* first square whose orientation differs from its target (NB_DIRS when it has none) */
+static bool _hint_from(cgame g, const direction* target, uint* i, uint* j, int* rotation) {
+  uint nb_cols = game_nb_cols(g), size = game_nb_rows(g) * nb_cols;
+  for (uint pos = 0; pos < size; pos++) {
+    if (target[pos] == NB_DIRS) continue;
+    uint r = pos / nb_cols, c = pos % nb_cols;
+    int t = _turns(game_get_piece_shape(g, r, c), game_get_piece_orientation(g, r, c), target[pos]);
+    if (t > 0) {
+      *i = r;
+      *j = c;
+      *rotation = t;
+      return true;
     }
   }
+  return false;
+}
 
-  game_delete(g_copy);
-  return game_won(g);
-}
\ No newline at end of file
+/* ******************************* GAME HINT ******************************** */
+bool game_hint(cgame g, uint* i, uint* j, int* rotation) {
+  assert(g && i && j && rotation);
+  if (game_won(g)) return false;
+  uint size = game_nb_rows(g) * game_nb_cols(g);
+
+  // Propagation first, then with failed literals (computed once for the shapes and locks)
+  struct warm_s* w = _warm(g);
+  bool found = false;
+  for (uint probe = 0; probe < 2 && !found && !w->unsolvable; probe++) {
+    if (!w->forced[probe]) {
+      w->forced[probe] = (direction*)malloc(size * sizeof(direction));
+      assert(w->forced[probe]);
+      w->unsolvable = solver_forced(g, probe, w->forced[probe]) == SOLVER_UNSOLVABLE;
+    }
+    found = !w->unsolvable && _hint_from(g, w->forced[probe], i, j, rotation);
+  }
+
+  // Then a solution: the last one found, else from the cache or a search
+  if (!found && !w->unsolvable) {
+    const direction* solution = _warm_solution(g);
+    if (solution) found = _hint_from(g, solution, i, j, rotation);
+  }
+  return found;
+}
@@ -13,6 +13,8 @@
 
 #include "game.h"
 #include "game_ext.h"
+#include "game_rng.h"
+#include "game_solcache.h"
 
 /**
  * @name Game Tools
@@ -50,11 +52,53 @@ void game_save(cgame g, char *filename);
  */
 game game_random(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint nb_extra);
 
+/**
+ * @brief Creates a random game solution using a given generator.
+ * @details Same as @ref game_random, but all random draws come from @p r: the
+ * generated game only depends on the parameters and on the state of @p r.
+ * @param nb_rows number of rows in game
+ * @param nb_cols number of columns in game
+ * @param wrapping wrapping option
+ * @param nb_empty number of empty squares
+ * @param nb_extra number of extra edges, that make cycles (if possible)
+ * @param r the random generator
+ * @pre same preconditions as @ref game_random
+ * @pre @p r is a valid pointer toward a seeded rng structure
+ * @return the generated random game (or NULL in case of error)
+ */
+game game_random_ext(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint nb_extra, rng* r);
+
+/**
+ * @brief Creates a random game solution that has exactly one solution.
+ * @details Solutions are counted as in @ref game_nb_solutions. The game is
+ * generated as with @ref game_random_ext, then checked with a solver that stops
+ * at the second solution. While two solutions exist, the edges around a
+ * square where they diverge are rewired, which keeps the number of empty
+ * squares and of edges. When the rewiring gets stuck, a new random game is
+ * generated; after 64 of them, the parameters are deemed to never give a game
+ * with a single solution (a wrapping 2x2 board, for instance) and NULL is
+ * returned.
+ * @param nb_rows number of rows in game
+ * @param nb_cols number of columns in game
+ * @param wrapping wrapping option
+ * @param nb_empty number of empty squares
+ * @param nb_extra number of extra edges, that make cycles (if possible)
+ * @param r the random generator
+ * @pre same preconditions as @ref game_random_ext
+ * @return the generated random game, whose orientations are its only solution,
+ * or NULL if none was found
+ */
+game game_random_unique(uint nb_rows, uint nb_cols, bool wrapping, uint nb_empty, uint nb_extra, rng* r);
+
 /**
  * @brief Computes the solution of a given game.
  * @param g the game to solve
  * @details The game @p g is updated with the first solution found. If there are
- * no solution for this game, @p g must be unchanged.
+ * no solution for this game, @p g must be unchanged. The solution is kept with
+ * the game: until its shapes, its locks or its size change, the next calls
+ * (after any moves) give it again without searching. A game already won is
+ * left as it is. As this state is updated, two threads must not solve or hint
+ * the same game at the same time.
  * @return true if a solution is found, false otherwise
  */
 bool game_solve(game g);
@@ -67,9 +111,54 @@ bool game_solve(game g);
  * @post The game @p g must be unchanged.
  * @return the number of solutions
  */
-
 uint game_nb_solutions(cgame g);
 
+/**
+ * @brief Counts the solutions of a given game, up to a given number.
+ * @param g the game
+ * @param limit the search stops as soon as @p limit solutions are found (0
+ * for no limit)
+ * @param exact if not NULL, set to true if the returned value is the exact
+ * number of solutions, and to false if it is only a lower bound (the search
+ * was stopped at @p limit)
+ * @details Solutions are counted as in @ref game_nb_solutions. The search may
+ * run on several threads, which all stop when the limit is reached. Checking
+ * that a game has a unique solution only needs a limit of 2.
+ * @post The game @p g must be unchanged.
+ * @return the number of solutions found (at most @p limit if @p limit > 0)
+ */
+uint game_nb_solutions_limit(cgame g, uint limit, bool* exact);
+
+/**
+ * @brief Finds one move toward the solution of a game.
+ * @details The move is first looked for by propagation alone: a square
+ * whose orientation is forced by its neighbours and the border (see
+ * @ref solver_forced), then by failed literals. Only when propagation forces
+ * no square to change, the move comes from a solution, as given by @ref
+ * game_solve (and its cache, see @ref game_use_cache). The forced squares and
+ * the solution are kept with the game, as in @ref game_solve: the next hints
+ * only compare them with the orientations. Although @p g is const, this state
+ * is updated: game_hint is not thread-safe on a game shared by several
+ * threads (which must then use copies of the game, or a lock).
+ * @param g the game
+ * @param i set to the row of the square to rotate
+ * @param j set to the column of the square to rotate
+ * @param rotation set to the number of clockwise quarter turns (1 to 3), as
+ * given to @ref game_play_move
+ * @return false if the game is already won or has no solution
+ */
+bool game_hint(cgame g, uint* i, uint* j, int* rotation);
+
+/**
+ * @brief Sets the solution cache of @ref game_solve and @ref game_nb_solutions.
+ * @details Before solving or counting, these functions look the game up in
+ * the cache, and they store what they compute in it. A count stopped at its
+ * limit is not stored, but an exact count in the cache answers any limit.
+ * @param c the cache (or NULL to stop using a cache); it must stay open
+ * while it is used
+ */
+void game_use_cache(solcache* c);
+
 /**
  * @}
  */
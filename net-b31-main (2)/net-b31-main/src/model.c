@@ -4,6 +4,7 @@
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,6 +13,7 @@
 #include "game_aux.h"
 #include "game_ext.h"
 #include "game_private.h"
+#include "game_solver.h"
 #include "game_struct.h"
 #include "game_tools.h"
 #include "queue.h"
@@ -33,6 +35,7 @@
 #define SPACE_BUTTONS 20
 #define SPACE_BLOCKS 15
 #define MAX_LOGS 3
+#define SOLVE_MIN_TIMEOUT 1.0
 
 /* ************************************************************************** */
 
@@ -129,7 +132,25 @@ bool button_redo(SDL_Renderer *ren, Env *env) {
 /* ****************************** BUTTON SOLVE ****************************** */
 bool button_solve(SDL_Renderer *ren, Env *env) {
   if (game_won(env->g)) return false;
-  if (game_solve(env->g)) add_log(ren, env, "> Game solved ");
+
+  // The solution closest to the board, or any solution if the closest one takes too long
+  solver_options opts = {.timeout = SOLVE_MIN_TIMEOUT};
+  uint turns;
+  solver_result res = solver_solve_min(env->g, &opts, &turns);
+  if (res == SOLVER_ABORTED && turns == UINT_MAX) res = game_solve(env->g) ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+  if (res != SOLVER_UNSOLVABLE) add_log(ren, env, "> Game solved ");
+  return false;
+}
+
+/* ****************************** BUTTON HINT ******************************* */
+bool button_hint(SDL_Renderer *ren, Env *env) {
+  uint i, j;
+  int rotation;
+  if (!game_hint(env->g, &i, &j, &rotation)) return false;
+  game_play_move(env->g, i, j, rotation);
+  char message[64];
+  sprintf(message, "> Hint: square (%u, %u) turned", i, j);
+  add_log(ren, env, message);
   return false;
 }
 
@@ -188,9 +209,11 @@ Env *init(SDL_Window *win, SDL_Renderer *ren, int argc, char *argv[]) {
   PRINT("Welcome in the game : NET\n");
   PRINT("--- HELP MENU ---\n");
   PRINT("Left click to rotate clockwise and right click anti-clockwise\n");
+  PRINT("Middle click to lock or unlock a piece\n");
   PRINT("Press 'r' to reset game\n");
   PRINT("Press 'z' to undo\n");
   PRINT("Press 'y' to redo\n");
+  PRINT("Press 'h' for a hint\n");
   PRINT("Press 's' to solve game\n");
   PRINT("Press ESC to quit\n");
   PRINT("You can also use the buttons\n");
@@ -222,12 +245,13 @@ Env *init(SDL_Window *win, SDL_Renderer *ren, int argc, char *argv[]) {
   env->color_font = color;
 
   /* Init buttons*/
-  env->nb_buttons = 5;
+  env->nb_buttons = 6;
   env->buttons = malloc(env->nb_buttons * sizeof(Button));
   assert(env->buttons);
 
-  const char *labels[] = {"Reset", "Undo", "Redo", "Solve", "Quit"};
-  bool (*actions[])(SDL_Renderer *, Env *) = {button_shuffle, button_undo, button_redo, button_solve, button_quit};
+  const char *labels[] = {"Reset", "Undo", "Redo", "Hint", "Solve", "Quit"};
+  bool (*actions[])(SDL_Renderer *, Env *) = {button_shuffle, button_undo, button_redo,
+                                              button_hint, button_solve, button_quit};
 
   uint pos_y = SPACE_BLOCKS;
   int menu_width = 0;
@@ -330,6 +354,15 @@ void render(SDL_Window *win, SDL_Renderer *ren, Env *env) {
         rect.w = rect.h = env->cell_size;
         SDL_RenderCopyEx(ren, texture, NULL, &rect, orientation, NULL, SDL_FLIP_NONE);
       }
+
+      // Locked squares are darkened
+      if (game_is_piece_locked(env->g, i, j)) {
+        SDL_Rect lock = {env->game_x + j * (env->cell_size - 1), env->game_y + i * (env->cell_size - 1), env->cell_size,
+                         env->cell_size};
+        SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(ren, 0, 0, 0, 96);
+        SDL_RenderFillRect(ren, &lock);
+      }
     }
   }
 
@@ -386,6 +419,9 @@ bool process(SDL_Window *win, SDL_Renderer *ren, Env *env, SDL_Event *e) {
       case SDLK_y:
         return button_redo(ren, env);
         break;
+      case SDLK_h:
+        return button_hint(ren, env);
+        break;
       case SDLK_s:
         return button_solve(ren, env);
         break;
@@ -458,9 +494,16 @@ bool process(SDL_Window *win, SDL_Renderer *ren, Env *env, SDL_Event *e) {
     int j = (mouse.x - env->game_x) / env->cell_size;
 
     if (i >= 0 && i < nb_rows && j >= 0 && j < nb_cols) {
-      game_play_move(env->g, i, j, 1);
       char message[256];
-      sprintf(message, "> Played moove in (%d,%d)", i, j);
+      if (e->button.button == SDL_BUTTON_MIDDLE) {
+        game_set_piece_locked(env->g, i, j, !game_is_piece_locked(env->g, i, j));
+        sprintf(message, "> Square (%d,%d) %s", i, j, game_is_piece_locked(env->g, i, j) ? "locked" : "unlocked");
+      } else if (game_is_piece_locked(env->g, i, j)) {
+        sprintf(message, "> Square (%d,%d) is locked", i, j);
+      } else {
+        game_play_move(env->g, i, j, 1);
+        sprintf(message, "> Played moove in (%d,%d)", i, j);
+      }
       add_log(ren, env, message);
     }
   }
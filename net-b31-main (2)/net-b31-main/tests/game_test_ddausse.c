@@ -13,9 +13,25 @@
  * @fn game_is_connected
  * @fn game_is_wrapping
  * @fn game_new_ext
+ * @fn game_random_ext
+ * @fn game_random_unique
+ * @fn game_nb_solutions_limit
+ * @fn solver_enumerate
+ * @fn solver_solve
+ * @fn solver_stats_free
+ * @fn solver_order
+ * @fn solcache_open
+ * @fn game_hint
+ * @fn solver_solve_min
+ * @fn game_set_piece_locked
+ * @fn solver_anneal
+ * @fn solver_solve_strips
+ * @fn solver_rate
+ * @fn game_solve
  *
  * @copyright University of Bordeaux. All rights reserved, 2024.
  **/
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +40,12 @@
 #include "game.h"
 #include "game_aux.h"
 #include "game_ext.h"
+#include "game_private.h"
+#include "game_rng.h"
+#include "game_solcache.h"
+#include "game_solfile.h"
+#include "game_solver.h"
+#include "game_tools.h"
 
 /* ************************************************************************** */
 /*                                MACRO                                       */
@@ -104,6 +126,29 @@ static direction any_ow[7 * 6] = {
     DE, DW, DE, DS, DW, DS  /* row 6 */
 };
 
+/* ****************** 5×5 GAME WITH WRAPPING AND 8 SOLUTIONS ****************** */
+static shape ambiguous_s[5 * 5] = {
+    ST, ST, SC, SC, ST, /* row 0 */
+    SC, SC, SS, SC, SC, /* row 1 */
+    SN, SN, ST, SC, SN, /* row 2 */
+    ST, SC, ST, SS, ST, /* row 3 */
+    ST, ST, SX, ST, ST  /* row 4 */
+};
+
+static direction ambiguous_o[5 * 5] = {
+    DW, DE, DN, DN, DS, /* row 0 */
+    DW, DW, DE, DW, DN, /* row 1 */
+    DN, DS, DN, DE, DN, /* row 2 */
+    DW, DW, DS, DS, DW, /* row 3 */
+    DE, DE, DW, DE, DW  /* row 4 */
+};
+
+/* ************** 2×2 GAME WITHOUT SOLUTION (A LONE ENDPOINT) *************** */
+static shape lone_endpoint_s[2 * 2] = {
+    SN, SE, /* row 0 */
+    SE, SE  /* row 1 */
+};
+
 /* ************************************************************************** */
 /*                             Test Functions                                 */
 /* ************************************************************************** */
@@ -433,6 +478,1100 @@ bool test_game_new_ext() {
   return true;
 }
 
+/* ************************** TEST GAME RANDOM EXT ************************** */
+bool test_game_random_ext() {
+  rng r1, r2;
+  rng_seed(&r1, 42);
+  rng_seed(&r2, 42);
+
+  // Bounded draws stay in range
+  for (uint k = 0; k < 1000; k++)
+    if (rng_bounded(&r1, 3) >= 3) return false;
+  rng_seed(&r1, 42);
+
+  // Same seed gives the same game, and the game is a solution
+  game g1 = game_random_ext(6, 5, true, 3, 2, &r1);
+  game g2 = game_random_ext(6, 5, true, 3, 2, &r2);
+  if (!game_equal(g1, g2, false) || !game_won(g1)) return false;
+
+  // Same seed gives the same shuffle
+  game_shuffle_orientation_ext(g1, &r1);
+  game_shuffle_orientation_ext(g2, &r2);
+  if (!game_equal(g1, g2, false)) return false;
+
+  // A jumped generator gives another stream
+  rng_seed(&r2, 42);
+  rng_jump(&r2);
+  game g3 = game_random_ext(6, 5, true, 3, 2, &r2);
+  rng_seed(&r1, 42);
+  game g4 = game_random_ext(6, 5, true, 3, 2, &r1);
+  bool same = game_equal(g3, g4, false);
+
+  game_delete(g1);
+  game_delete(g2);
+  game_delete(g3);
+  game_delete(g4);
+  return !same;
+}
+
+/* ************************* TEST GAME RANDOM UNIQUE ************************* */
+bool test_game_random_unique() {
+  rng r;
+  rng_seed(&r, 2024);
+
+  // Small wrapping games usually have several solutions, the generated ones must have only one
+  for (uint k = 0; k < 10; k++) {
+    game g = game_random_unique(2, 4, true, 0, 2, &r);
+    bool ok = g && game_won(g) && game_nb_solutions(g) == 1;
+    game_delete(g);
+    if (!ok) return false;
+  }
+
+  // A wrapping 2x2 game always has several solutions: the generation gives up
+  return game_random_unique(2, 2, true, 0, 0, &r) == NULL;
+}
+
+/* ********************** TEST GAME NB SOLUTIONS LIMIT ********************** */
+bool test_game_nb_solutions_limit() {
+  game g = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  bool exact = false, ok = true;
+
+  // Without limit or with a large limit, the count is exact
+  ok = ok && game_nb_solutions(g) == 8;
+  ok = ok && game_nb_solutions_limit(g, 100, &exact) == 8 && exact;
+  ok = ok && game_nb_solutions_limit(g, 0, &exact) == 8 && exact;
+
+  // With a small limit, the count is a lower bound
+  ok = ok && game_nb_solutions_limit(g, 2, &exact) == 2 && !exact;
+
+  // Same results with several threads
+  solver_options opts = {.nb_threads = 4};
+  uint count = 0;
+  ok = ok && solver_count_ext(g, 0, &opts, &count) == SOLVER_SOLVED && count == 8;
+  ok = ok && solver_count_ext(g, 3, &opts, &count) == SOLVER_SOLVED && count == 3;
+
+  game_delete(g);
+  return ok;
+}
+
+/* ************************* TEST SOLVER ENUMERATE ************************** */
+static bool skip_solution(const uint8_t *packed, uint size, void *data) { return true; }
+
+bool test_solver_enumerate() {
+  game g = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+
+  // Write all the solutions in a binary file
+  solfile *f = solfile_open("test_solutions.bin", g);
+  if (!f) return false;
+  uint nb_sols = 0;
+  uint64_t nb_written = 0;
+  bool ok = solver_enumerate(g, solfile_write, f, NULL, &nb_sols) == SOLVER_SOLVED;
+  ok = solfile_close(f, &nb_written) && ok && nb_written == 8 && nb_sols == 8;
+
+  // Read them back: each record is a winning orientation vector
+  FILE *in = fopen("test_solutions.bin", "rb");
+  if (!in) return false;
+  uint8_t header[SOLFILE_HEADER_SIZE], packed[(5 * 5 + 3) / 4];
+  ok = ok && fread(header, 1, SOLFILE_HEADER_SIZE, in) == SOLFILE_HEADER_SIZE;
+  ok = ok && memcmp(header, "NETS", 4) == 0 && header[5] == 1 && header[8] == 5 && header[12] == 5;
+  uint nb_read = 0;
+  while (ok && fread(packed, 1, sizeof(packed), in) == sizeof(packed)) {
+    for (uint pos = 0; pos < 5 * 5; pos++) {
+      direction d = (packed[pos / 4] >> (2 * (pos % 4))) & 3;
+      game_set_piece_orientation(g, pos / 5, pos % 5, d);
+    }
+    ok = game_won(g);
+    nb_read++;
+  }
+  fclose(in);
+  remove("test_solutions.bin");
+  game_delete(g);
+
+  // An enumeration stopped by its limits is not complete
+  rng r;
+  rng_seed(&r, 29);
+  g = game_random_ext(40, 40, true, 0, 40, &r);
+  solver_options opts = {.max_nodes = 1};
+  ok = ok && solver_enumerate(g, skip_solution, NULL, &opts, &nb_sols) == SOLVER_ABORTED;
+  game_delete(g);
+  return ok && nb_read == 8;
+}
+
+/* *************************** TEST SOLVER SOLVE **************************** */
+static bool count_progress(uint64_t nb_nodes, void *data) {
+  (*(uint *)data)++;
+  return true;
+}
+
+bool test_solver_solve() {
+  rng r;
+  rng_seed(&r, 5);
+  game g = game_random_ext(20, 20, false, 0, 2, &r);
+  game_shuffle_orientation_ext(g, &r);
+  game g0 = game_copy(g);
+  bool ok = true;
+
+  // A cancelled search is aborted and leaves the game unchanged
+  atomic_bool cancel;
+  atomic_init(&cancel, true);
+  solver_options opts = {.cancel = &cancel};
+  ok = ok && solver_solve(g, &opts) == SOLVER_ABORTED && game_equal(g, g0, false);
+
+  // Same with a node budget (row order: the search takes more than one check interval)
+  opts = (solver_options){.max_nodes = 1, .order = SOLVER_ORDER_ROW};
+  ok = ok && solver_solve(g, &opts) == SOLVER_ABORTED && game_equal(g, g0, false);
+  uint count = 0;
+  ok = ok && solver_count_ext(g, 0, &opts, &count) == SOLVER_ABORTED;
+
+  // Without limits, the game is solved and progress is reported
+  uint nb_reports = 0;
+  opts = (solver_options){
+      .progress = count_progress, .progress_data = &nb_reports, .progress_interval = 1, .order = SOLVER_ORDER_ROW};
+  ok = ok && solver_solve(g, &opts) == SOLVER_SOLVED && game_won(g) && nb_reports > 0;
+
+  // A game without solution
+  game none = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  ok = ok && solver_solve(none, NULL) == SOLVER_UNSOLVABLE;
+
+  game_delete(none);
+  game_delete(g);
+  game_delete(g0);
+  return ok;
+}
+
+/* *************************** TEST SOLVER STATS **************************** */
+static bool check_solution(const uint8_t *packed, uint size, void *data) {
+  game g = (game)data;
+  for (uint pos = 0; pos < size; pos++)
+    game_set_piece_orientation(g, pos / game_nb_cols(g), pos % game_nb_cols(g),
+                               (packed[pos / 4] >> (2 * (pos % 4))) & 3);
+  return game_won(g);
+}
+
+bool test_solver_stats() {
+  game g = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  solver_stats stats = {0};
+  solver_options opts = {.nb_threads = 1, .stats = &stats};
+  uint count = 0;
+
+  // Every node is either the root or a try that was not pruned
+  bool ok = solver_count_ext(g, 0, &opts, &count) == SOLVER_SOLVED && count == 8;
+  uint64_t pruned = 0, total = 0;
+  for (uint r = 0; r < NB_RULES; r++) pruned += stats.prunes[r];
+  for (uint d = 0; d < stats.depth_size; d++) total += stats.nodes_at_depth[d];
+  ok = ok && stats.solutions == 8 && stats.leaves >= 8 && stats.max_depth == 5 * 5 && stats.depth_size == 5 * 5 + 1;
+  ok = ok && stats.nodes == total && stats.nodes_at_depth[0] == 1 && stats.nodes == 1 + stats.tries - pruned;
+  ok = ok && stats.prunes[RULE_NONE] == 0 && stats.time >= 0;
+
+  // The statistics are reset by the next search, whatever the entry point
+  ok = ok && solver_enumerate(g, check_solution, g, &opts, &count) == SOLVER_SOLVED && count == 8;
+  ok = ok && stats.solutions == 8;
+  opts.nb_threads = 4;
+  ok = ok && solver_count_ext(g, 0, &opts, &count) == SOLVER_SOLVED && stats.solutions == 8;
+
+  solver_stats_free(&stats);
+  ok = ok && stats.nodes_at_depth == NULL;
+  game_delete(g);
+  return ok;
+}
+
+/* *************************** TEST SOLVER ORDER **************************** */
+bool test_solver_order() {
+  game g = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  rng r;
+  rng_seed(&r, 9);
+  game big = game_random_ext(12, 15, false, 3, 2, &r);
+  game_shuffle_orientation_ext(big, &r);
+  uint expected = game_nb_solutions(big);
+  bool ok = expected > 0;
+
+  // Every order finds the same solutions, sequentially and in parallel
+  for (solver_order order = 0; order < NB_ORDERS; order++) {
+    solver_options opts = {.nb_threads = 1, .order = order};
+    uint count = 0;
+    ok = ok && solver_count_ext(g, 0, &opts, &count) == SOLVER_SOLVED && count == 8;
+    opts.nb_threads = 3;
+    ok = ok && solver_count_ext(big, 0, &opts, &count) == SOLVER_SOLVED && count == expected;
+    game copy = game_copy(big);
+    ok = ok && solver_solve(copy, &opts) == SOLVER_SOLVED && game_won(copy);
+    game_delete(copy);
+  }
+
+  game_delete(big);
+  game_delete(g);
+  return ok;
+}
+
+/* ************************** TEST SOLVER LEARNING ************************** */
+bool test_solver_learning() {
+  game g = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  rng r;
+  rng_seed(&r, 11);
+  bool ok = true;
+
+  // Learning and backjumping find the same solutions, even with a tiny nogood database
+  for (uint k = 0; k < 6; k++) {
+    game other = game_random_ext(6 + k, 7, k % 2, k % 3, 4, &r);
+    game_shuffle_orientation_ext(other, &r);
+    uint expected = game_nb_solutions(other);
+    for (uint max_nogoods = 1; max_nogoods <= 1000; max_nogoods *= 10) {
+      solver_options opts = {.nb_threads = 1 + k % 3, .max_nogoods = max_nogoods, .order = k % NB_ORDERS};
+      uint count = 0;
+      ok = ok && solver_count_ext(other, 0, &opts, &count) == SOLVER_SOLVED && count == expected;
+      ok = ok && solver_count_ext(g, 0, &opts, &count) == SOLVER_SOLVED && count == 8;
+    }
+    game_delete(other);
+  }
+
+  // A large wrapping game is solved, and the conflicts are recorded
+  game big = game_random_ext(40, 40, true, 0, 0, &r);
+  game_shuffle_orientation_ext(big, &r);
+  solver_stats stats = {0};
+  solver_options opts = {.max_nogoods = 1000, .stats = &stats};
+  ok = ok && solver_solve(big, &opts) == SOLVER_SOLVED && game_won(big) && stats.nogoods > 0;
+
+  // A game without solution
+  game none = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  ok = ok && solver_solve(none, &opts) == SOLVER_UNSOLVABLE;
+  game_delete(none);
+
+  solver_stats_free(&stats);
+  game_delete(big);
+  game_delete(g);
+  return ok;
+}
+
+/* *************************** TEST SOLVER RESTART *************************** */
+bool test_solver_restart() {
+  rng r;
+  rng_seed(&r, 13);
+  game g = game_random_ext(40, 40, true, 0, 20, &r);
+  game_shuffle_orientation_ext(g, &r);
+  solver_stats stats = {0};
+  bool ok = true;
+
+  // Every schedule solves the game, restarting often with a tiny base
+  for (solver_restart restart = SOLVER_RESTART_LUBY; restart < NB_RESTARTS; restart++) {
+    solver_options opts = {.restart = restart, .restart_base = 8, .seed = 1, .stats = &stats};
+    game copy = game_copy(g);
+    ok = ok && solver_solve(copy, &opts) == SOLVER_SOLVED && game_won(copy) && stats.restarts > 0;
+
+    // Same seed, same solution; learned nogoods can be kept across the runs
+    game again = game_copy(g);
+    ok = ok && solver_solve(again, &opts) == SOLVER_SOLVED && game_equal(copy, again, false);
+    opts.max_nogoods = 100;
+    opts.keep_learned = true;
+    ok = ok && solver_solve(again, &opts) == SOLVER_SOLVED && game_won(again);
+    game_delete(copy);
+    game_delete(again);
+  }
+
+  // The randomized order does not change the number of solutions
+  game amb = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  for (uint64_t seed = 0; seed < 4; seed++) {
+    solver_options opts = {.nb_threads = 1 + seed % 2, .randomize = true, .seed = seed};
+    uint count = 0;
+    ok = ok && solver_count_ext(amb, 0, &opts, &count) == SOLVER_SOLVED && count == 8;
+  }
+
+  // The budgets grow: a game without solution is still proved unsolvable
+  game none = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  solver_options opts = {.restart = SOLVER_RESTART_LUBY, .restart_base = 1};
+  ok = ok && solver_solve(none, &opts) == SOLVER_UNSOLVABLE;
+
+  solver_stats_free(&stats);
+  game_delete(none);
+  game_delete(amb);
+  game_delete(g);
+  return ok;
+}
+
+/* ************************** TEST SOLVER PORTFOLIO ************************* */
+bool test_solver_portfolio() {
+  rng r;
+  rng_seed(&r, 17);
+  game g = game_random_ext(30, 30, true, 0, 10, &r);
+  game_shuffle_orientation_ext(g, &r);
+  game g0 = game_copy(g);
+  solver_options configs[] = {
+      {.order = SOLVER_ORDER_ROW, .max_nodes = 1},
+      {.order = SOLVER_ORDER_DYNAMIC},
+      {.order = SOLVER_ORDER_BFS, .max_nogoods = 100},
+      {.restart = SOLVER_RESTART_LUBY, .seed = 5},
+  };
+  uint winner = 0;
+
+  // The winner is a configuration which was not aborted, and its solution is copied
+  bool ok = solver_portfolio(g, configs, 4, &winner) == SOLVER_SOLVED && winner >= 1 && winner < 4 && game_won(g);
+
+  // When every configuration is aborted, there is no winner and the game is unchanged
+  ok = ok && solver_portfolio(g0, configs, 1, &winner) == SOLVER_ABORTED && winner == 1;
+  ok = ok && !game_won(g0);
+
+  // A game without solution
+  game none = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  ok = ok && solver_portfolio(none, configs + 1, 3, &winner) == SOLVER_UNSOLVABLE && winner < 3;
+
+  game_delete(none);
+  game_delete(g0);
+  game_delete(g);
+  return ok;
+}
+
+/* ************************** TEST SOLVER PARALLEL ************************** */
+static bool keep_first(const uint8_t *packed, uint size, void *data) {
+  memcpy(data, packed, (size + 3) / 4);
+  return false;
+}
+
+bool test_solver_parallel() {
+  rng r;
+  rng_seed(&r, 19);
+  game amb = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  game many = game_random_ext(8, 8, true, 0, 12, &r);
+  game_shuffle_orientation_ext(many, &r);
+  game big = game_random_ext(40, 40, true, 0, 20, &r);
+  game_shuffle_orientation_ext(big, &r);
+  game games[] = {amb, many};
+  bool ok = true;
+
+  // Deterministic mode: the first solution of a sequential search in row-major order, whatever the threads
+  for (uint k = 0; k < 2; k++) {
+    uint size = game_nb_rows(games[k]) * game_nb_cols(games[k]);
+    uint8_t first[(8 * 8 + 3) / 4];
+    solver_options seq = {.order = SOLVER_ORDER_ROW};
+    uint count = 0;
+    ok = ok && solver_enumerate(games[k], keep_first, first, &seq, &count) == SOLVER_ABORTED && count == 1;
+    for (uint nb_threads = 1; nb_threads <= 4; nb_threads++) {
+      solver_options opts = {.nb_threads = nb_threads, .deterministic = true, .max_nogoods = k * 100};
+      game copy = game_copy(games[k]);
+      ok = ok && solver_solve_parallel(copy, &opts) == SOLVER_SOLVED && game_won(copy);
+      for (uint pos = 0; pos < size; pos++) {
+        direction d = game_get_piece_orientation(copy, pos / game_nb_cols(copy), pos % game_nb_cols(copy));
+        ok = ok && d == ((first[pos / 4] >> (2 * (pos % 4))) & 3);
+      }
+      game_delete(copy);
+    }
+  }
+
+  // First solution found by any thread
+  solver_stats stats = {0};
+  solver_options opts = {.nb_threads = 4, .stats = &stats};
+  game copy = game_copy(big);
+  ok = ok && solver_solve_parallel(copy, &opts) == SOLVER_SOLVED && game_won(copy) && stats.solutions >= 1;
+  game_delete(copy);
+
+  // A game without solution, with and without the deterministic mode
+  game none = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  ok = ok && solver_solve_parallel(none, &opts) == SOLVER_UNSOLVABLE;
+  opts.deterministic = true;
+  ok = ok && solver_solve_parallel(none, &opts) == SOLVER_UNSOLVABLE;
+
+  solver_stats_free(&stats);
+  game_delete(none);
+  game_delete(big);
+  game_delete(many);
+  game_delete(amb);
+  return ok;
+}
+
+/* *********************** TEST SOLVER DECOMPOSITION *********************** */
+bool test_solver_decomposition() {
+  rng r;
+  rng_seed(&r, 23);
+  bool ok = true;
+
+  // Boards with many empty squares and extra edges, counted as a whole and in independent parts
+  for (uint k = 0; k < 12; k++) {
+    game g = game_random_ext(12 + k % 3, 12 + k % 4, k % 2, 8 + 4 * (k % 3), 40 + 10 * (k % 5), &r);
+    game_shuffle_orientation_ext(g, &r);
+    uint whole, split;
+    solver_options opts = {.nb_threads = 1 + k % 3, .no_decomposition = true};
+    ok = ok && solver_count_ext(g, 0, &opts, &whole) == SOLVER_SOLVED && whole >= 1;
+    opts.no_decomposition = false;
+    ok = ok && solver_count_ext(g, 0, &opts, &split) == SOLVER_SOLVED && split == whole;
+    opts.order = SOLVER_ORDER_ROW;
+    opts.max_nogoods = 100;
+    ok = ok && solver_count_ext(g, 0, &opts, &split) == SOLVER_SOLVED && split == whole;
+    // The product of the parts stops at the limit
+    ok = ok && solver_count_ext(g, 2, &opts, &split) == SOLVER_SOLVED && split == (whole < 2 ? whole : 2);
+    game_delete(g);
+  }
+  return ok;
+}
+
+/* ************************** TEST SOLVER ESTIMATE ************************** */
+bool test_solver_estimate() {
+  rng r;
+  rng_seed(&r, 29);
+  bool ok = true;
+
+  // A small tree is explored by the calibration: exact values
+  game small = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  solver_estimate est;
+  solver_stats stats = {0};
+  solver_options opts = {.nb_threads = 1, .no_decomposition = true, .stats = &stats};
+  uint count;
+  solver_count_ext(small, 0, &opts, &count);
+  ok = ok && solver_estimate_size(small, 10, NULL, &est) == SOLVER_SOLVED && est.exact;
+  ok = ok && est.solutions == count && est.nodes == stats.nodes && est.nodes_low == est.nodes_high;
+
+  // A large tree: the probes give intervals around their estimates, the same ones for the same seed
+  game big = game_random_ext(32, 32, true, 0, 480, &r);
+  game_shuffle_orientation_ext(big, &r);
+  solver_options seeded = {.seed = 5};
+  solver_estimate again;
+  ok = ok && solver_estimate_size(big, 200, &seeded, &est) == SOLVER_SOLVED && !est.exact && est.probes == 200;
+  ok = ok && est.nodes_low <= est.nodes && est.nodes <= est.nodes_high && est.nodes >= 100000;
+  ok = ok && est.solutions_low <= est.solutions && est.solutions <= est.solutions_high;
+  ok = ok && est.nodes_per_second > 0 && est.seconds > 0;
+  ok = ok && solver_estimate_size(big, 200, &seeded, &again) == SOLVER_SOLVED && again.nodes_high == est.nodes_high;
+
+  // The limits of the options stop the estimation
+  solver_options limited = {.max_nodes = 1000};
+  ok = ok && solver_estimate_size(big, 200, &limited, &est) == SOLVER_ABORTED;
+
+  solver_stats_free(&stats);
+  game_delete(big);
+  game_delete(small);
+  return ok;
+}
+
+/* *************************** TEST SOLVER SAMPLE *************************** */
+bool test_solver_sample() {
+  game g = game_new_ext(5, 5, ambiguous_s, ambiguous_o, true);
+  direction all[8][5 * 5], sol[12 * 12];
+  uint hits[8] = {0};
+  rng r;
+  rng_seed(&r, 31);
+  bool ok = solver_count(g, 0, &all[0][0], 8) == 8;
+
+  // Each of the 8 solutions is drawn about 1000 times out of 8000
+  solver_sampler *s = solver_sampler_new(g, false, NULL);
+  for (uint k = 0; k < 8000 && ok; k++) {
+    ok = solver_sample(s, &r, sol) == SOLVER_SOLVED;
+    uint match = 8;
+    for (uint k2 = 0; k2 < 8; k2++)
+      if (memcmp(all[k2], sol, sizeof(all[k2])) == 0) match = k2;
+    ok = ok && match < 8;
+    if (match < 8) hits[match]++;
+  }
+  for (uint k = 0; k < 8; k++) ok = ok && hits[k] > 850 && hits[k] < 1150;
+  solver_sampler_delete(s);
+
+  // Both modes give solutions of a larger game
+  game big = game_random_ext(12, 12, true, 4, 30, &r);
+  game_shuffle_orientation_ext(big, &r);
+  for (uint approximate = 0; approximate < 2; approximate++) {
+    s = solver_sampler_new(big, approximate, NULL);
+    for (uint k = 0; k < 50 && ok; k++) {
+      ok = solver_sample(s, &r, sol) == SOLVER_SOLVED;
+      game copy = game_copy(big);
+      for (uint pos = 0; pos < 12 * 12; pos++) game_set_piece_orientation(copy, pos / 12, pos % 12, sol[pos]);
+      ok = ok && game_won(copy);
+      game_delete(copy);
+    }
+    solver_sampler_delete(s);
+  }
+
+  // A game without solution
+  game none = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  s = solver_sampler_new(none, false, NULL);
+  ok = ok && game_nb_solutions(none) == 0 && solver_sample(s, &r, sol) == SOLVER_UNSOLVABLE;
+  solver_sampler_delete(s);
+
+  game_delete(none);
+  game_delete(big);
+  game_delete(g);
+  return ok;
+}
+
+/* ************************* TEST SOLVER CHECKPOINT ************************* */
+bool test_solver_checkpoint() {
+  rng r;
+  rng_seed(&r, 37);
+  game g = game_random_ext(32, 32, true, 0, 300, &r);
+  game_shuffle_orientation_ext(g, &r);
+  remove("test_checkpoint.bin");
+  uint whole, count = 0;
+  solver_options plain = {.nb_threads = 2, .no_decomposition = true};
+  bool ok = solver_count_ext(g, 0, &plain, &whole) == SOLVER_SOLVED;
+
+  // Short runs, each one resuming the checkpoint of the previous one, end with the same count
+  solver_options opts = {.nb_threads = 2, .checkpoint = "test_checkpoint.bin", .max_nodes = 20000};
+  uint nb_runs = 0;
+  solver_result res = SOLVER_ABORTED;
+  while (ok && res == SOLVER_ABORTED && nb_runs++ < 10000) {
+    opts.nb_threads = 1 + nb_runs % 3;
+    res = solver_count_ext(g, 0, &opts, &count);
+    opts.resume = solver_checkpoint_matches(g, opts.checkpoint);
+  }
+  ok = ok && res == SOLVER_SOLVED && count == whole && nb_runs > 1;
+
+  // A complete checkpoint gives the count at once, it cannot be resumed on another game
+  opts.max_nodes = 0;
+  ok = ok && solver_count_ext(g, 0, &opts, &count) == SOLVER_SOLVED && count == whole;
+  game_set_piece_shape(g, 0, 0, game_get_piece_shape(g, 0, 0) == CROSS ? SEGMENT : CROSS);
+  ok = ok && !solver_checkpoint_matches(g, opts.checkpoint);
+  ok = ok && !solver_checkpoint_matches(g, "no_checkpoint.bin");
+
+  // A checkpoint which cannot be written stops the count
+  solver_options unwritable = {.nb_threads = 2, .checkpoint = "no_directory/test_checkpoint.bin"};
+  ok = ok && solver_count_ext(g, 0, &unwritable, &count) == SOLVER_ERROR;
+
+  remove("test_checkpoint.bin");
+  game_delete(g);
+  return ok;
+}
+
+/* ************************* TEST SOLVER PARTITION ************************** */
+bool test_solver_partition() {
+  rng r;
+  rng_seed(&r, 41);
+  bool ok = true;
+
+  // The counts of the jobs add up to the count of the game, whatever the threads of each job
+  for (uint k = 0; k < 6 && ok; k++) {
+    game g = game_random_ext(10 + k, 12, k % 2, 4 * (k % 3), 30 + 10 * k, &r);
+    game_shuffle_orientation_ext(g, &r);
+    uint whole, part, again;
+    ok = solver_count_ext(g, 0, NULL, &whole) == SOLVER_SOLVED;
+    for (uint nb_jobs = 2; nb_jobs <= 8 && ok; nb_jobs += 3) {
+      uint64_t total = 0;
+      for (uint job = 0; job < nb_jobs && ok; job++) {
+        solver_options opts = {.nb_threads = 1 + job % 3, .nb_jobs = nb_jobs, .job = job, .order = k % NB_ORDERS};
+        ok = solver_count_ext(g, 0, &opts, &part) != SOLVER_ABORTED;
+        opts.nb_threads = 2;
+        ok = ok && solver_count_ext(g, 0, &opts, &again) != SOLVER_ABORTED && again == part;
+        total += part;
+      }
+      ok = ok && total == whole;
+    }
+    game_delete(g);
+  }
+  return ok;
+}
+
+/* ***************************** TEST SOLCACHE ****************************** */
+bool test_solcache() {
+  rng r;
+  rng_seed(&r, 43);
+  remove("test_cache.bin");
+  solcache *c = solcache_open("test_cache.bin");
+  solcache *other = solcache_open("test_cache.bin");
+  bool ok = c && other;
+  if (!ok) return false;
+
+  // More games than the first index can hold: the file is rewritten, the other handle follows it
+  uint nb_games = SOLCACHE_INITIAL_SLOTS;
+  game *games = (game *)malloc(nb_games * sizeof(game));
+  for (uint k = 0; k < nb_games; k++) {
+    games[k] = game_random_ext(4 + k % 5, 4 + k / 5 % 7, k % 2, k % 3, k % 4, &r);
+    if (k % 2 == 0) ok = ok && solcache_put_solution(c, games[k], true);
+    ok = ok && solcache_put_count(k % 3 ? c : other, games[k], k + 1);
+  }
+  for (uint pass = 0; pass < 3 && ok; pass++) {
+    for (uint k = 0; k < nb_games && ok; k++) {
+      uint64_t nb_sols;
+      bool solvable;
+      game g = game_copy(games[k]);
+      game_shuffle_orientation_ext(g, &r);
+      ok = solcache_count(k % 2 ? c : other, g, &nb_sols) && nb_sols == k + 1;
+      if (k % 2 == 0) ok = ok && solcache_solution(other, g, &solvable) && solvable && game_won(g);
+      if (k % 2 == 1) ok = ok && !solcache_solution(c, g, &solvable);
+      game_delete(g);
+    }
+
+    // The cache survives a restart
+    solcache_close(c);
+    solcache_close(other);
+    c = solcache_open("test_cache.bin");
+    other = solcache_open("test_cache.bin");
+    ok = ok && c && other;
+  }
+
+  // The wrapping option is part of the key, a game without solution is remembered as such
+  game g = game_new_empty_ext(4, 4, true);
+  uint64_t nb_sols;
+  bool solvable = true;
+  ok = ok && !solcache_count(c, g, &nb_sols) && solcache_put_count(c, g, 0);
+  ok = ok && solcache_solution(other, g, &solvable) && !solvable;
+  game_delete(g);
+  g = game_new_empty_ext(4, 4, false);
+  ok = ok && !solcache_count(other, g, &nb_sols);
+
+  // game_nb_solutions answers from the cache
+  bool exact;
+  game_use_cache(c);
+  ok = ok && solcache_put_count(c, g, 12345) && game_nb_solutions(g) == 12345;
+  ok = ok && game_nb_solutions_limit(g, 10, &exact) == 10 && !exact;
+  game_use_cache(NULL);
+  ok = ok && game_nb_solutions(g) != 12345;
+  game_delete(g);
+
+  for (uint k = 0; k < nb_games; k++) game_delete(games[k]);
+  free(games);
+  solcache_close(c);
+  solcache_close(other);
+  remove("test_cache.bin");
+  return ok;
+}
+
+/* ***************************** TEST GAME HINT ***************************** */
+bool test_game_hint() {
+  rng r;
+  rng_seed(&r, 44);
+  bool ok = true;
+  direction *forced = (direction *)malloc(64 * sizeof(direction));
+  direction *sols = (direction *)malloc(64 * 64 * sizeof(direction));
+
+  for (uint k = 0; k < 24 && ok; k++) {
+    uint nb_rows = 3 + k % 6, nb_cols = 8, size = nb_rows * nb_cols;
+    game g = game_random_ext(nb_rows, nb_cols, k % 2, k % 3, 2 * (k % 5), &r);
+    game_shuffle_orientation_ext(g, &r);
+
+    // The forced orientations are the ones of every solution
+    uint nb_sols = solver_count(g, 64, sols, 64);
+    for (uint probe = 0; probe < 2 && ok; probe++) {
+      ok = solver_forced(g, probe, forced) == SOLVER_SOLVED;
+      for (uint s = 0; s < nb_sols && ok; s++)
+        for (uint pos = 0; pos < size && ok; pos++) ok = forced[pos] == NB_DIRS || forced[pos] == sols[s * size + pos];
+    }
+
+    // Following the hints wins the game
+    uint i, j, nb_hints = 0;
+    int rotation;
+    while (ok && game_hint(g, &i, &j, &rotation)) {
+      ok = i < nb_rows && j < nb_cols && rotation >= 1 && rotation <= 3 && ++nb_hints <= 3 * size;
+      game_play_move(g, i, j, rotation);
+    }
+    ok = ok && game_won(g);
+    game_delete(g);
+  }
+
+  // A game without solution has no hint
+  game g = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  uint i, j;
+  int rotation;
+  ok = ok && game_won(g) == false && !game_hint(g, &i, &j, &rotation);
+  ok = ok && solver_forced(g, false, forced) == SOLVER_UNSOLVABLE;
+  game_delete(g);
+
+  free(forced);
+  free(sols);
+  return ok;
+}
+
+/* ************************* TEST SOLVER SOLVE MIN ************************** */
+/* fewest quarter turns, either way, from one orientation of a piece to one equivalent to another */
+static uint turns_between(shape s, direction from, direction to) {
+  uint period = _shape_period(s);
+  uint fewest = NB_DIRS;
+  for (uint t = 0; t < NB_DIRS; t++)
+    if ((from + t + NB_DIRS - to) % period == 0 && (t <= NB_DIRS - t ? t : NB_DIRS - t) < fewest)
+      fewest = t <= NB_DIRS - t ? t : NB_DIRS - t;
+  return fewest;
+}
+
+bool test_solver_solve_min() {
+  rng r;
+  rng_seed(&r, 45);
+  bool ok = true;
+  uint max_sols = 4096;
+  direction *sols = (direction *)malloc(max_sols * 30 * sizeof(direction));
+
+  // The cost found is the fewest turns over all the solutions, and the game is set to such a solution
+  for (uint k = 0; k < 60 && ok; k++) {
+    uint nb_rows = 2 + k % 4, nb_cols = 3 + k % 3, size = nb_rows * nb_cols;
+    game g = game_random_ext(nb_rows, nb_cols, k % 2, k % 3, k % 4, &r);
+    game_shuffle_orientation_ext(g, &r);
+    uint nb_sols = solver_count(g, max_sols, sols, max_sols);
+    if (nb_sols == max_sols) {
+      game_delete(g);
+      continue;
+    }
+    uint fewest = UINT_MAX;
+    for (uint s = 0; s < nb_sols; s++) {
+      uint cost = 0;
+      for (uint pos = 0; pos < size; pos++) {
+        uint i = pos / nb_cols, j = pos % nb_cols;
+        cost += turns_between(game_get_piece_shape(g, i, j), game_get_piece_orientation(g, i, j), sols[s * size + pos]);
+      }
+      if (cost < fewest) fewest = cost;
+    }
+
+    game h = game_copy(g);
+    uint turns, moved = 0;
+    ok = solver_solve_min(h, NULL, &turns) == SOLVER_SOLVED && turns == fewest && game_won(h);
+    for (uint pos = 0; pos < size; pos++) {
+      uint i = pos / nb_cols, j = pos % nb_cols;
+      uint t = (game_get_piece_orientation(h, i, j) + NB_DIRS - game_get_piece_orientation(g, i, j)) % NB_DIRS;
+      moved += t <= NB_DIRS - t ? t : NB_DIRS - t;
+    }
+    ok = ok && moved == fewest;
+    game_delete(h);
+    game_delete(g);
+  }
+
+  // A cancelled search or a game without solution leave the game unchanged
+  atomic_bool cancel;
+  atomic_init(&cancel, true);
+  solver_options opts = {.cancel = &cancel};
+  game g = game_default();
+  game h = game_copy(g);
+  uint turns;
+  ok = ok && solver_solve_min(h, &opts, &turns) == SOLVER_ABORTED && turns == UINT_MAX && game_equal(g, h, false);
+  game_delete(h);
+  game_delete(g);
+  g = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  h = game_copy(g);
+  ok = ok && solver_solve_min(h, NULL, &turns) == SOLVER_UNSOLVABLE && turns == UINT_MAX && game_equal(g, h, false);
+  game_delete(h);
+  game_delete(g);
+
+  free(sols);
+  return ok;
+}
+
+/* *************************** TEST SOLVER ANNEAL *************************** */
+/* do the locked pieces of g have the same orientation in h? */
+static bool keeps_locked(cgame g, cgame h) {
+  for (uint i = 0; i < game_nb_rows(g); i++)
+    for (uint j = 0; j < game_nb_cols(g); j++)
+      if (game_is_piece_locked(g, i, j) && game_get_piece_orientation(h, i, j) != game_get_piece_orientation(g, i, j))
+        return false;
+  return true;
+}
+
+bool test_solver_anneal() {
+  rng r;
+  rng_seed(&r, 47);
+  bool ok = true;
+
+  // Shuffled random boards are solved, with or without wrapping, and the locked pieces are kept
+  for (uint k = 0; k < 12 && ok; k++) {
+    uint nb_rows = 4 + 3 * k, nb_cols = nb_rows + k % 3;
+    game g = game_random_ext(nb_rows, nb_cols, k % 2, 0, 0, &r);
+    if (k % 3 == 2)
+      for (uint pos = 0; pos < nb_rows * nb_cols; pos++)
+        if (rng_bounded(&r, 4) == 0) game_set_piece_locked(g, pos / nb_cols, pos % nb_cols, true);
+    game_shuffle_orientation_ext(g, &r);
+    game h = game_copy(g);
+    solver_options opts = {.nb_threads = 1 + k % 2, .seed = k};
+    uint cost = UINT_MAX;
+    ok = solver_anneal(h, &opts, &cost) == SOLVER_SOLVED && cost == 0 && game_won(h) && keeps_locked(g, h);
+    game_delete(h);
+    game_delete(g);
+  }
+
+  // A won game is kept as it is
+  game g = game_default_solution();
+  game h = game_copy(g);
+  uint cost = UINT_MAX;
+  ok = ok && solver_anneal(h, NULL, &cost) == SOLVER_SOLVED && cost == 0 && game_equal(g, h, false);
+  game_delete(h);
+  game_delete(g);
+
+  // A limit of moves gives the best state found, with its cost
+  g = game_random_ext(40, 40, false, 0, 0, &r);
+  game_shuffle_orientation_ext(g, &r);
+  h = game_copy(g);
+  solver_options opts = {.nb_threads = 1, .max_nodes = 1000};
+  solver_result res = solver_anneal(h, &opts, &cost);
+  ok = ok && (res == SOLVER_ABORTED || res == SOLVER_SOLVED) && (cost == 0) == (res == SOLVER_SOLVED);
+  ok = ok && (cost == 0) == game_won(h) && cost < 40 * 40 * NB_DIRS;
+  game_delete(h);
+  game_delete(g);
+
+  // A game without solution is found by propagation, and kept as it is
+  g = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  h = game_copy(g);
+  ok = ok && solver_anneal(h, NULL, &cost) == SOLVER_UNSOLVABLE && cost == UINT_MAX && game_equal(g, h, false);
+  game_delete(h);
+  game_delete(g);
+  return ok;
+}
+
+/* ************************ TEST SOLVER SOLVE STRIPS ************************ */
+bool test_solver_solve_strips() {
+  rng r;
+  rng_seed(&r, 48);
+  bool ok = true;
+
+  // Long boards, in rows or in columns, with or without wrapping, are solved and the locked pieces are kept
+  uint sizes[][2] = {{6, 400}, {400, 5}, {16, 100}, {3, 60}, {40, 2}, {5, 17}};
+  for (uint k = 0; k < 12 && ok; k++) {
+    uint nb_rows = sizes[k % 6][0], nb_cols = sizes[k % 6][1];
+    bool wrapping = k >= 6 && nb_rows * nb_cols < 1000;
+    game g = game_random_ext(nb_rows, nb_cols, wrapping, 0, 0, &r);
+    if (k % 4 == 1)
+      for (uint pos = 0; pos < nb_rows * nb_cols; pos++)
+        if (rng_bounded(&r, 5) == 0) game_set_piece_locked(g, pos / nb_cols, pos % nb_cols, true);
+    game_shuffle_orientation_ext(g, &r);
+    game h = game_copy(g);
+    solver_options opts = {.nb_threads = 1 + k % 2};
+    ok = solver_solve_strips(h, &opts) == SOLVER_SOLVED && game_won(h) && keeps_locked(g, h);
+    game_delete(h);
+    game_delete(g);
+  }
+
+  // A square board is left to the other solvers
+  game g = game_default();
+  ok = ok && solver_solve_strips(g, NULL) == SOLVER_SOLVED && game_won(g);
+  game_delete(g);
+
+  // A game without solution is kept as it is, found by the strips or by propagation
+  g = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  game h = game_copy(g);
+  ok = ok && solver_solve_strips(h, NULL) == SOLVER_UNSOLVABLE && game_equal(g, h, false);
+  game_delete(h);
+  game_delete(g);
+  g = game_new_empty_ext(4, 40, false);
+  for (uint j = 0; j < 40; j++) game_set_piece_shape(g, 0, j, j % 20 == 0 || j % 20 == 19 ? ENDPOINT : SEGMENT);
+  ok = ok && solver_solve_strips(g, NULL) == SOLVER_UNSOLVABLE;
+  game_delete(g);
+  return ok;
+}
+
+/* **************************** TEST SOLVER RATE **************************** */
+bool test_solver_rate() {
+  rng r;
+  rng_seed(&r, 49);
+  bool ok = true;
+
+  // Every square is counted once, the grade follows the level, and a game solved by the rules has one solution
+  bool seen[NB_GRADES] = {false};
+  for (uint k = 0; k < 40 && ok; k++) {
+    uint nb_rows = 3 + k % 4, nb_cols = 3 + k % 5;
+    game g = game_random_ext(nb_rows, nb_cols, k % 2, 0, k % 3, &r);
+    game_shuffle_orientation_ext(g, &r);
+    solver_rating rating;
+    ok = solver_rate(g, &rating) == SOLVER_SOLVED;
+    uint sum = 0;
+    for (uint l = 0; l < NB_LEVELS; l++) sum += rating.histogram[l];
+    ok = ok && sum == nb_rows * nb_cols && rating.histogram[SOLVER_LEVEL_SEARCH] == rating.nb_guesses;
+    ok = ok && (rating.nb_guesses > 0) == (rating.level == SOLVER_LEVEL_SEARCH);
+    ok = ok && rating.grade == (rating.level == SOLVER_LEVEL_EDGES    ? SOLVER_GRADE_EASY
+                                : rating.level == SOLVER_LEVEL_CLOSED ? SOLVER_GRADE_MEDIUM
+                                                                      : SOLVER_GRADE_HARD);
+    ok = ok && rating.difficulty >= 1.0 && rating.difficulty <= 4.0;
+    ok = ok && (rating.nb_guesses > 0 || solver_count(g, 2, NULL, 0) == 1);
+    seen[rating.grade] = true;
+    game_delete(g);
+  }
+  ok = ok && seen[SOLVER_GRADE_EASY] && seen[SOLVER_GRADE_MEDIUM] && seen[SOLVER_GRADE_HARD];
+
+  // Two endpoints side by side are fixed by the border alone
+  game g = game_new_empty_ext(1, 2, false);
+  game_set_piece_shape(g, 0, 0, ENDPOINT);
+  game_set_piece_shape(g, 0, 1, ENDPOINT);
+  solver_rating rating;
+  ok = ok && solver_rate(g, &rating) == SOLVER_SOLVED && rating.grade == SOLVER_GRADE_EASY;
+  ok = ok && rating.histogram[SOLVER_LEVEL_EDGES] == 2 && rating.nb_guesses == 0 && rating.difficulty == 1.0;
+  game_delete(g);
+
+  // A game without solution has no rating
+  g = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  ok = ok && solver_rate(g, &rating) == SOLVER_UNSOLVABLE && rating.histogram[SOLVER_LEVEL_EDGES] == 0;
+  game_delete(g);
+  return ok;
+}
+
+/* ************************** TEST GAME SOLVE WARM ************************** */
+/* does a game solve as a copy of it, which has no solver state yet? */
+static bool solves_as_copy(game g) {
+  game fresh = game_copy(g);
+  bool solvable = game_solve(fresh);
+  bool ok = game_solve(g) == solvable && (!solvable || (game_won(g) && game_equal(g, fresh, false)));
+  game_delete(fresh);
+  return ok;
+}
+
+bool test_game_solve_warm() {
+  rng r;
+  rng_seed(&r, 50);
+  bool ok = true;
+
+  for (uint k = 0; k < 12 && ok; k++) {
+    uint nb_rows = 3 + k, nb_cols = 5 + k % 3, size = nb_rows * nb_cols;
+    game g = game_random_ext(nb_rows, nb_cols, k % 2, 0, k % 3, &r);
+    game_shuffle_orientation_ext(g, &r);
+
+    // After moves, the solution found first is given again
+    ok = game_solve(g) && game_won(g);
+    game sol = game_copy(g);
+    game_shuffle_orientation_ext(g, &r);
+    game_play_move(g, 0, 0, 1);
+    ok = ok && game_solve(g) && game_equal(g, sol, false);
+
+    // The hints follow the moves of the player
+    game_shuffle_orientation_ext(g, &r);
+    uint i, j, nb_hints = 0;
+    int rotation;
+    while (ok && game_hint(g, &i, &j, &rotation)) {
+      ok = i < nb_rows && j < nb_cols && rotation >= 1 && rotation <= 3 && ++nb_hints <= 3 * size;
+      game_play_move(g, i, j, rotation);
+      if (nb_hints % 3 == 0) game_play_move(g, rng_bounded(&r, nb_rows), rng_bounded(&r, nb_cols), 1);
+    }
+    ok = ok && game_won(g);
+
+    // A new lock or a new shape is searched again
+    game_set_piece_orientation(g, nb_rows - 1, 0, (game_get_piece_orientation(g, nb_rows - 1, 0) + 1) % NB_DIRS);
+    game_set_piece_locked(g, nb_rows - 1, 0, true);
+    direction locked = game_get_piece_orientation(g, nb_rows - 1, 0);
+    ok = ok && solves_as_copy(g) && game_get_piece_orientation(g, nb_rows - 1, 0) == locked;
+    game_set_piece_locked(g, nb_rows - 1, 0, false);
+    game_set_piece_shape(g, 0, 0, (game_get_piece_shape(g, 0, 0) + 1) % NB_SHAPES);
+    ok = ok && solves_as_copy(g);
+    game_delete(sol);
+    game_delete(g);
+  }
+
+  // A game won by the player is kept, even with another solution stored
+  direction sols[2 * 9];
+  bool tested = false;
+  for (uint k = 0; k < 50 && ok && !tested; k++) {
+    game g = game_random_ext(3, 3, true, 0, 2, &r);
+    if (solver_count(g, 2, sols, 2) < 2) {
+      game_delete(g);
+      continue;
+    }
+    game_shuffle_orientation_ext(g, &r);
+    ok = game_solve(g);
+    bool first = true;  // the solution stored is the first one counted
+    for (uint pos = 0; pos < 9; pos++) first = first && game_get_piece_orientation(g, pos / 3, pos % 3) == sols[pos];
+    uint other = first ? 1 : 0;
+    for (uint pos = 0; pos < 9; pos++) game_set_piece_orientation(g, pos / 3, pos % 3, sols[9 * other + pos]);
+    ok = ok && game_won(g) && game_solve(g);
+    for (uint pos = 0; pos < 9 && ok; pos++)
+      ok = game_get_piece_orientation(g, pos / 3, pos % 3) == sols[9 * other + pos];
+    tested = true;
+    game_delete(g);
+  }
+  ok = ok && tested;
+
+  // A game without solution stays so, until its shapes change
+  game g = game_new_ext(2, 2, lone_endpoint_s, NULL, false);
+  uint i, j;
+  int rotation;
+  ok = ok && !game_solve(g) && !game_hint(g, &i, &j, &rotation) && !game_solve(g);
+  game_set_piece_shape(g, 0, 1, ENDPOINT);
+  game_set_piece_orientation(g, 0, 1, NORTH);
+  ok = ok && game_hint(g, &i, &j, &rotation) && game_solve(g) && game_won(g);
+  game_delete(g);
+  return ok;
+}
+
+/* ***************************** TEST GAME LOCK ***************************** */
+/* an orientation of a piece is equivalent to the one of a solution */
+static bool same_position(shape s, direction o, direction sol) {
+  return (o + NB_DIRS - sol) % _shape_period(s) == 0;
+}
+
+bool test_game_lock() {
+  rng r;
+  rng_seed(&r, 46);
+
+  // A locked piece is not turned by the moves, the history, the shuffle or the reset
+  game g = game_default();
+  game d = game_default();
+  bool ok = !game_is_piece_locked(g, 1, 1);
+  direction o = game_get_piece_orientation(g, 1, 1);
+  direction o00 = game_get_piece_orientation(g, 0, 0);
+  game_play_move(g, 0, 0, 1);
+  game_play_move(g, 1, 1, 1);
+  game_play_move(g, 0, 0, 1);
+  game_undo(g);
+  game_set_piece_locked(g, 1, 1, true);
+  game_play_move(g, 1, 1, 1);
+  ok = ok && game_is_piece_locked(g, 1, 1) && game_get_piece_orientation(g, 1, 1) == (o + 1) % NB_DIRS;
+
+  // Its moves leave the history, the older and newer moves of the other pieces stay in it
+  game_redo(g);
+  ok = ok && game_get_piece_orientation(g, 0, 0) == (o00 + 2) % NB_DIRS;
+  game_undo(g);
+  game_undo(g);
+  ok = ok && game_get_piece_orientation(g, 0, 0) == o00 && game_get_piece_orientation(g, 1, 1) == (o + 1) % NB_DIRS;
+  game_undo(g);
+  ok = ok && game_get_piece_orientation(g, 0, 0) == o00 && game_get_piece_orientation(g, 1, 1) == (o + 1) % NB_DIRS;
+  game_shuffle_orientation_ext(g, &r);
+  game_reset_orientation(g);
+  ok = ok && game_get_piece_orientation(g, 1, 1) == (o + 1) % NB_DIRS && game_get_piece_orientation(g, 0, 0) == NORTH;
+  game copy = game_copy(g);
+  ok = ok && game_is_piece_locked(copy, 1, 1) && !game_is_piece_locked(copy, 0, 0) && game_equal(g, copy, false);
+  ok = ok && solver_game_hash(g) != solver_game_hash(d);
+  game_set_piece_locked(copy, 1, 1, false);
+  game_play_move(copy, 1, 1, 1);
+  ok = ok && game_get_piece_orientation(copy, 1, 1) == (o + 2) % NB_DIRS;
+  game_delete(copy);
+  game_delete(d);
+  game_delete(g);
+
+  // The solutions with locked pieces are the ones where these pieces are in place
+  uint max_sols = 1024;
+  direction *all = (direction *)malloc(max_sols * 25 * sizeof(direction));
+  direction *sols = (direction *)malloc(max_sols * 25 * sizeof(direction));
+  for (uint k = 0; k < 40 && ok; k++) {
+    uint nb_rows = 2 + k % 4, nb_cols = 3 + k % 3, size = nb_rows * nb_cols;
+    g = game_random_ext(nb_rows, nb_cols, k % 2, k % 3, 2 + k % 4, &r);
+    uint nb_all = solver_count(g, max_sols, all, max_sols);
+    game_shuffle_orientation_ext(g, &r);
+    for (uint pos = 0; pos < size; pos++)
+      if (rng_bounded(&r, 3) == 0) game_set_piece_locked(g, pos / nb_cols, pos % nb_cols, true);
+
+    uint expected = 0;
+    for (uint s = 0; s < nb_all; s++) {
+      bool matches = true;
+      for (uint pos = 0; pos < size && matches; pos++) {
+        uint i = pos / nb_cols, j = pos % nb_cols;
+        direction sol = all[s * size + pos];
+        if (game_is_piece_locked(g, i, j))
+          matches = same_position(game_get_piece_shape(g, i, j), game_get_piece_orientation(g, i, j), sol);
+      }
+      expected += matches;
+    }
+    uint nb_sols = solver_count(g, max_sols, sols, max_sols);
+    ok = nb_all < max_sols && nb_sols == expected;
+    for (uint s = 0; s < nb_sols && ok; s++)
+      for (uint pos = 0; pos < size && ok; pos++)
+        ok = !game_is_piece_locked(g, pos / nb_cols, pos % nb_cols) ||
+             sols[s * size + pos] == game_get_piece_orientation(g, pos / nb_cols, pos % nb_cols);
+    ok = ok && game_solve(g) == (expected > 0) && (expected == 0 || game_won(g));
+    game_delete(g);
+  }
+  free(all);
+  free(sols);
+
+  // A board locked but for a corner is solved by a search of the corner only
+  uint n = 60, corner = 6;
+  g = game_random_ext(n, n, false, 0, 0, &r);
+  game_shuffle_orientation_ext(g, &r);
+  game solution = game_copy(g);
+  ok = ok && game_solve(solution);
+  for (uint i = 0; i < n; i++)
+    for (uint j = 0; j < n; j++)
+      if (i >= corner || j >= corner) {
+        game_set_piece_orientation(g, i, j, game_get_piece_orientation(solution, i, j));
+        game_set_piece_locked(g, i, j, true);
+      }
+  solver_order orders[] = {SOLVER_ORDER_ROW, SOLVER_ORDER_SPIRAL, SOLVER_ORDER_BFS, SOLVER_ORDER_DYNAMIC};
+  for (uint k = 0; k < 4 && ok; k++) {
+    solver_stats stats = {0};
+    solver_options opts = {.nb_threads = 1, .stats = &stats, .order = orders[k]};
+    game copy = game_copy(g);
+    ok = solver_solve(copy, &opts) == SOLVER_SOLVED && game_won(copy);
+    ok = ok && stats.nodes < n * n + corner * corner * NB_DIRS * NB_DIRS;
+    for (uint pos = 0; pos < n * n && ok; pos++)
+      ok = !game_is_piece_locked(g, pos / n, pos % n) ||
+           game_get_piece_orientation(copy, pos / n, pos % n) == game_get_piece_orientation(g, pos / n, pos % n);
+    solver_stats_free(&stats);
+    game_delete(copy);
+  }
+  game_delete(solution);
+  game_delete(g);
+  return ok;
+}
+
 /* ************************************************************************** */
 /*                             Test Function Mapping                          */
 /* ************************************************************************** */
@@ -452,6 +1591,30 @@ TestEntry test_functions[] = {
     {"game_is_connected", test_game_is_connected},
     {"game_is_wrapping", test_game_is_wrapping},
     {"game_new_ext", test_game_new_ext},
+    {"game_random_ext", test_game_random_ext},
+    {"game_random_unique", test_game_random_unique},
+    {"game_nb_solutions_limit", test_game_nb_solutions_limit},
+    {"solver_enumerate", test_solver_enumerate},
+    {"solver_solve", test_solver_solve},
+    {"solver_stats", test_solver_stats},
+    {"solver_order", test_solver_order},
+    {"solver_learning", test_solver_learning},
+    {"solver_restart", test_solver_restart},
+    {"solver_portfolio", test_solver_portfolio},
+    {"solver_parallel", test_solver_parallel},
+    {"solver_decomposition", test_solver_decomposition},
+    {"solver_estimate", test_solver_estimate},
+    {"solver_sample", test_solver_sample},
+    {"solver_checkpoint", test_solver_checkpoint},
+    {"solver_partition", test_solver_partition},
+    {"solcache", test_solcache},
+    {"game_hint", test_game_hint},
+    {"solver_solve_min", test_solver_solve_min},
+    {"game_lock", test_game_lock},
+    {"solver_anneal", test_solver_anneal},
+    {"solver_solve_strips", test_solver_solve_strips},
+    {"solver_rate", test_solver_rate},
+    {"game_solve_warm", test_game_solve_warm},
 };
 
 #define NUM_TESTS (sizeof(test_functions) / sizeof(TestEntry))